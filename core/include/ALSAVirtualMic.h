@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <poll.h>
+#include "SpscRing.h"
+
+// Negotiated PCM parameters. Sizes are in frames (one sample per channel).
+struct PcmConfig {
+    unsigned sampleRate = 48000;
+    unsigned channels = 2;
+    unsigned periodFrames = 480; // 10 ms at 48 kHz
+    unsigned periods = 2;
+};
+
+// The few PCM operations the mic needs, so the refill logic can run
+// against a fake device in tests. Interleaved S16 only.
+class PcmBackend {
+public:
+    virtual ~PcmBackend() = default;
+    // Opens non-blocking; `config` is updated with what the device accepted.
+    virtual bool Open(PcmConfig& config) = 0;
+    virtual void Close() = 0;
+    virtual int PollDescriptors(pollfd* fds, int max) = 0;
+    // Interprets poll results; true if the device wants more frames.
+    virtual bool Writable(pollfd* fds, int count) = 0;
+    // Frames the device can take now, or a negative errno (-EPIPE on xrun).
+    virtual long Available() = 0;
+    // Returns frames written or a negative errno.
+    virtual long WriteFrames(const int16_t* data, unsigned long frames) = 0;
+    // Recovers from an xrun or suspend; false if the device is gone.
+    virtual bool Recover(int err) = 0;
+};
+
+std::unique_ptr<PcmBackend> createAlsaPcmBackend(const std::string& device);
+
+// Feeds a playback PCM (typically the sink side of snd-aloop) that other
+// applications see as a microphone. Write() never blocks: frames go into a
+// lock-free ring and a refill thread moves them to the device whenever
+// poll() says there is room. If the producer falls behind, a period of
+// silence is written instead so the device never runs dry; the backlog
+// that leaves behind once the producer catches up is trimmed back to
+// `targetMillis` so every underrun doesn't add latency for good.
+class ALSAVirtualMic {
+public:
+    struct Params {
+        unsigned sampleRate = 48000;
+        unsigned channels = 2;
+        unsigned periodMicros = 10000;
+        unsigned periods = 2;     // buffer = periods * period
+        unsigned ringMillis = 60; // how far Write() may run ahead
+        unsigned targetMillis = 20; // ring depth kept once the device is full
+    };
+
+    struct Stats {
+        uint64_t framesPlayed;
+        uint64_t silenceFrames; // inserted because the ring was empty
+        uint64_t droppedFrames; // rejected by Write() because the ring was full
+        uint64_t trimmedFrames; // oldest frames dropped to get back to the target depth
+        uint64_t xruns;
+    };
+
+    explicit ALSAVirtualMic(const std::string& device);
+    explicit ALSAVirtualMic(std::unique_ptr<PcmBackend> backend);
+    ~ALSAVirtualMic();
+
+    bool Open() { return Open(Params{}); }
+    bool Open(const Params& params);
+    // Queues interleaved frames; returns how many were accepted.
+    size_t Write(const int16_t* buffer, size_t frames);
+    void Close();
+
+    Stats GetStats() const;
+    const PcmConfig& Config() const { return config_; }
+
+private:
+    std::unique_ptr<PcmBackend> backend_;
+    PcmConfig config_;
+    std::unique_ptr<stream::SpscRing<int16_t>> ring_;
+    size_t targetFrames_ = 0;
+    int wakeFd_ = -1;
+    std::thread thread_;
+
+    std::atomic<uint64_t> frames_played_{0};
+    std::atomic<uint64_t> silence_frames_{0};
+    std::atomic<uint64_t> dropped_frames_{0};
+    std::atomic<uint64_t> trimmed_frames_{0};
+    std::atomic<uint64_t> xruns_{0};
+
+    void RefillLoop();
+    bool Refill();
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// 10 ms of interleaved S16 audio at 48 kHz, the unit WebRTC consumes.
+struct AudioFrame {
+    const int16_t* data;
+    size_t frames;
+    int sampleRate;
+    int channels;
+    uint64_t timestamp; // microseconds, capture time of the first sample
+};
+
+class AudioCapture {
+public:
+    using AudioCallback = std::function<void(const AudioFrame&)>;
+
+    static constexpr int kOutputRate = 48000;
+    static constexpr int kFrameMillis = 10;
+
+    virtual ~AudioCapture() = default;
+    // The callback runs on the capture thread; keep it short.
+    virtual bool Start(AudioCallback callback) = 0;
+    virtual void Stop() = 0;
+    // Capture-to-callback delay of the most recent frame.
+    virtual uint64_t LatencyMicros() const { return 0; }
+};
+
+// `device` is an ALSA PCM name; a PulseAudio/PipeWire monitor source is
+// reachable through the "pulse" plugin (e.g. set PULSE_SOURCE).
+std::unique_ptr<AudioCapture> createPlatformAudioCapture(const std::string& device);
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace stream {
+
+// 16-bit PCM audio files that can outgrow 4 GB.
+//
+// WAV is written with a reserved JUNK chunk; if the file crosses the 32-bit
+// limit it is turned into RF64 (EBU Tech 3306) on close by rewriting that
+// chunk as ds64. Sony Wave64 is available for tools that prefer it. The
+// reader walks the chunk list instead of assuming a 44-byte header.
+
+struct AudioFormat {
+    uint32_t sampleRate = 48000;
+    uint16_t channels = 2;
+    uint16_t bitsPerSample = 16;
+
+    uint32_t bytesPerFrame() const { return uint32_t(channels) * bitsPerSample / 8; }
+};
+
+enum class AudioContainer { Wav, RF64, W64 };
+
+class AudioFileWriter {
+public:
+    ~AudioFileWriter() { close(); }
+
+    // Wav upgrades itself to RF64 when needed; RF64 and W64 are explicit.
+    bool open(const std::string& path, const AudioFormat& format, AudioContainer container = AudioContainer::Wav);
+    bool write(const int16_t* samples, size_t frames);
+    // Patches the sizes into the header. Safe to call twice.
+    bool close();
+
+    bool isOpen() const { return file_.is_open(); }
+    uint64_t frames() const { return dataBytes_ / format_.bytesPerFrame(); }
+
+private:
+    std::ofstream file_;
+    AudioFormat format_;
+    AudioContainer container_ = AudioContainer::Wav;
+    uint64_t dataBytes_ = 0;
+    uint64_t dataSizeOffset_ = 0; // where the data chunk's size field lives
+    uint64_t ds64Offset_ = 0;     // JUNK/ds64 chunk (Wav/RF64 only)
+
+    void writeRiffHeader(bool rf64);
+    void writeW64Header();
+    void finalizeRiff();
+    void finalizeW64();
+};
+
+// Memory-mapped reader; read() hands out pointers into the mapping, so
+// playback never copies and seeking is just moving an index.
+class AudioFileReader {
+public:
+    AudioFileReader() = default;
+    ~AudioFileReader() { close(); }
+    AudioFileReader(const AudioFileReader&) = delete;
+    AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const AudioFormat& format() const { return format_; }
+    AudioContainer container() const { return container_; }
+    uint64_t totalFrames() const { return totalFrames_; }
+    uint64_t position() const { return position_; }
+
+    bool seek(uint64_t frame);
+    // Points `data` at up to `frames` frames from the current position and
+    // advances; returns the number of frames available (0 at end).
+    size_t read(const int16_t*& data, size_t frames);
+
+private:
+    const uint8_t* map_ = nullptr;
+    size_t mapBytes_ = 0;
+    std::string owned_; // fallback buffer where mmap is unavailable
+    AudioFormat format_;
+    AudioContainer container_ = AudioContainer::Wav;
+    const uint8_t* data_ = nullptr;
+    uint64_t totalFrames_ = 0;
+    uint64_t position_ = 0;
+
+    bool parseRiff(bool rf64);
+    bool parseW64();
+    bool parseFmt(const uint8_t* p, uint64_t size);
+};
+
+}
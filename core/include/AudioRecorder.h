@@ -1,92 +1,68 @@
 #pragma once
 #include <string>
-#include <fstream>
 #include <vector>
 #include <functional>
-#include <thread>
-#include <chrono>
 #include <cstdint>
+#include "AudioFile.h"
+#include "Logger.h"
+#include "ReplayScheduler.h"
 
 class AudioRecorder {
 public:
     using AudioFrameCallback = std::function<void(const std::vector<int16_t>&, uint64_t timestamp)>;
 
     AudioRecorder(int sampleRate, int channels)
-        : sampleRate_(sampleRate), channels_(channels), recording_(false) {}
+        : sampleRate_(sampleRate), channels_(channels) {}
 
+    // Written as WAV, switching to RF64 on close if the session passed 4 GB.
     void startRecording(const std::string& filename) {
         stopRecording();
-        file_.open(filename, std::ios::binary);
-        if (file_.is_open()) {
-            writeWavHeader();
-            recording_ = true;
-            dataBytes_ = 0;
-        }
+        stream::AudioFormat format;
+        format.sampleRate = uint32_t(sampleRate_);
+        format.channels = uint16_t(channels_);
+        writer_.open(filename, format);
     }
 
+    // `samples` counts individual samples across all channels.
     void recordFrame(const int16_t* data, size_t samples, uint64_t timestamp) {
-        if (recording_ && file_.is_open()) {
-            file_.write(reinterpret_cast<const char*>(data), samples * sizeof(int16_t));
-            dataBytes_ += samples * sizeof(int16_t);
-        }
+        (void)timestamp;
+        if (writer_.isOpen())
+            writer_.write(data, samples / size_t(channels_));
     }
 
-    void stopRecording() {
-        if (recording_ && file_.is_open()) {
-            finalizeWavHeader();
-            file_.close();
-        }
-        recording_ = false;
-    }
+    void stopRecording() { writer_.close(); }
 
-    bool isRecording() const { return recording_; }
+    bool isRecording() const { return writer_.isOpen(); }
 
-    static void playRecording(const std::string& filename, AudioFrameCallback callback, int sampleRate, int channels, int frameMs = 10) {
-        std::ifstream file(filename, std::ios::binary);
-        if (!file.is_open()) return;
-        // Skip WAV header (44 bytes)
-        file.seekg(44, std::ios::beg);
-        size_t samplesPerFrame = sampleRate * channels * frameMs / 1000;
-        std::vector<int16_t> buffer(samplesPerFrame);
-        uint64_t timestamp = 0;
-        while (file.read(reinterpret_cast<char*>(buffer.data()), samplesPerFrame * sizeof(int16_t))) {
-            callback(buffer, timestamp);
-            std::this_thread::sleep_for(std::chrono::milliseconds(frameMs));
-            timestamp += frameMs;
+    // Replays a WAV/RF64/W64 file in `frameMs` chunks. Rate and channel
+    // count come from the file header; the arguments are only checked
+    // against it. `pacing` controls speed and what happens when the
+    // callback falls behind (see ReplayScheduler). Timestamps are in
+    // milliseconds from the start of the file.
+    static void playRecording(const std::string& filename, AudioFrameCallback callback, int sampleRate, int channels,
+                              int frameMs = 10, uint64_t startMs = 0,
+                              const stream::ReplayScheduler::Options& pacing = {}) {
+        stream::AudioFileReader reader;
+        if (!reader.open(filename)) return;
+        const stream::AudioFormat& format = reader.format();
+        if (int(format.sampleRate) != sampleRate || int(format.channels) != channels)
+            stream::log_info("Replaying " + filename + " at its native " + std::to_string(format.sampleRate) +
+                             " Hz / " + std::to_string(format.channels) + " ch");
+        reader.seek(startMs * format.sampleRate / 1000);
+        size_t framesPerChunk = size_t(format.sampleRate) * size_t(frameMs) / 1000;
+        stream::ReplayScheduler scheduler(pacing);
+        std::vector<int16_t> buffer;
+        const int16_t* data = nullptr;
+        while (size_t n = reader.read(data, framesPerChunk)) {
+            uint64_t chunkStart = reader.position() - n;
+            if (!scheduler.wait(chunkStart * 1000000 / format.sampleRate)) continue;
+            buffer.assign(data, data + n * format.channels);
+            callback(buffer, chunkStart * 1000 / format.sampleRate);
         }
     }
 
 private:
     int sampleRate_;
     int channels_;
-    bool recording_;
-    std::ofstream file_;
-    size_t dataBytes_ = 0;
-
-    void writeWavHeader() {
-        // Write a placeholder WAV header (will update sizes on finalize)
-        uint32_t byteRate = sampleRate_ * channels_ * 2;
-        uint16_t blockAlign = channels_ * 2;
-        file_.write("RIFF", 4);
-        uint32_t chunkSize = 0; file_.write(reinterpret_cast<const char*>(&chunkSize), 4); // to be filled
-        file_.write("WAVEfmt ", 8);
-        uint32_t subchunk1Size = 16; file_.write(reinterpret_cast<const char*>(&subchunk1Size), 4);
-        uint16_t audioFormat = 1; file_.write(reinterpret_cast<const char*>(&audioFormat), 2);
-        file_.write(reinterpret_cast<const char*>(&channels_), 2);
-        file_.write(reinterpret_cast<const char*>(&sampleRate_), 4);
-        file_.write(reinterpret_cast<const char*>(&byteRate), 4);
-        file_.write(reinterpret_cast<const char*>(&blockAlign), 2);
-        uint16_t bitsPerSample = 16; file_.write(reinterpret_cast<const char*>(&bitsPerSample), 2);
-        file_.write("data", 4);
-        uint32_t dataChunkSize = 0; file_.write(reinterpret_cast<const char*>(&dataChunkSize), 4); // to be filled
-    }
-    void finalizeWavHeader() {
-        if (!file_.is_open()) return;
-        file_.seekp(4, std::ios::beg);
-        uint32_t chunkSize = 36 + dataBytes_;
-        file_.write(reinterpret_cast<const char*>(&chunkSize), 4);
-        file_.seekp(40, std::ios::beg);
-        uint32_t dataChunkSize = dataBytes_;
-        file_.write(reinterpret_cast<const char*>(&dataChunkSize), 4);
-    }
-}; 
\ No newline at end of file
+    stream::AudioFileWriter writer_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace stream {
+
+struct StreamConfig;
+
+struct ProbeResult {
+    std::string name;
+    bool available = false;
+    std::string detail; // what was found, or why not
+    std::chrono::microseconds elapsed{0};
+};
+
+// Lightweight checks for what the host can do (X display, XShm, PipeWire,
+// VAAPI, ALSA, v4l2loopback) that don't construct the subsystems themselves.
+// Each probe runs at most once: run() starts every pending probe on its
+// own thread and later lookups return the cached result, so startup pays
+// for each check once and the slowest probe bounds the total.
+class CapabilityProbes {
+public:
+    // Fills `detail` and returns whether the capability is usable.
+    using Probe = std::function<bool(std::string& detail)>;
+
+    // Replaces a probe that hasn't run yet; ignored once it has.
+    void add(const std::string& name, Probe probe);
+    // Starts all probes that haven't started and waits for them.
+    void run();
+
+    // Runs the probe if needed. Unknown names report unavailable.
+    ProbeResult result(const std::string& name);
+    bool available(const std::string& name) { return result(name).available; }
+    // Every registered probe, in registration order.
+    std::vector<ProbeResult> results();
+
+private:
+    struct Entry {
+        std::string name;
+        Probe probe;
+        std::shared_future<ProbeResult> future; // valid once started
+    };
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+
+    // Caller holds mutex_.
+    void startLocked(Entry& entry);
+};
+
+// Process-wide probe set used by the health check and main.
+CapabilityProbes& capabilities();
+
+// Registers this platform's probes; the ALSA probe opens config.audio.device.
+void addPlatformProbes(CapabilityProbes& probes, const StreamConfig& config);
+
+}
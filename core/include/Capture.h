@@ -4,7 +4,10 @@
 #include <vector>
 #include <cstdint>
 #include <functional>
+#include <string>
 
+// `data` is only valid for the duration of the frame callback; it may
+// point straight into a backend buffer (XShm segment, PipeWire buffer).
 struct FrameData {
     uint8_t* data;
     int width;
@@ -12,16 +15,99 @@ struct FrameData {
     int stride;
     size_t size;
     uint64_t timestamp; // microseconds
+    // Bumped by the backend whenever width, height or stride change (screen
+    // resize, monitor hotplug, resized window), so consumers can rebuild
+    // their state from the frame itself instead of a side channel.
+    uint32_t generation = 0;
+    // What changed since the previous frame, in 64x64 tiles: row-major, bit
+    // (i % 64) of word i / 64 for tile i. Valid like `data`. Null means
+    // unknown, i.e. treat everything as changed.
+    const uint64_t* dirtyTiles = nullptr;
+    int tileColumns = 0;
+    int tileRows = 0;
+    size_t dirtyTileCount = 0;
+    // Set when the frame lives in a DMA-BUF, so a hardware encoder can
+    // import it instead of reading `data` (a CPU mapping of the same
+    // buffer). Pixel (x, y) is at offset + y * stride + x * 4 in the fd.
+    int dmabufFd = -1;
+    uint32_t drmFormat = 0; // DRM fourcc, e.g. XR24
+    uint64_t drmModifier = 0;
+    uint32_t dmabufOffset = 0;
+};
+
+// Sub-rectangle of the screen to capture; empty means the whole screen.
+struct CaptureRegion {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    bool empty() const { return width <= 0 || height <= 0; }
+};
+
+// What to capture. Backends that can only grab the whole screen or a
+// rectangle of it reject monitor and window targets.
+struct CaptureTarget {
+    enum class Kind { Screen, Region, Monitor, Window };
+    Kind kind = Kind::Screen;
+    CaptureRegion region;  // Kind::Region, in screen coordinates
+    std::string monitor;   // Kind::Monitor: output name, e.g. "DP-1"; "" is the primary
+    uint64_t window = 0;   // Kind::Window: native window id
+
+    static CaptureTarget fromRegion(const CaptureRegion& region) {
+        CaptureTarget t;
+        t.kind = region.empty() ? Kind::Screen : Kind::Region;
+        t.region = region;
+        return t;
+    }
+    bool operator==(const CaptureTarget& o) const {
+        return kind == o.kind && region.x == o.region.x && region.y == o.region.y &&
+               region.width == o.region.width && region.height == o.region.height && monitor == o.monitor &&
+               window == o.window;
+    }
+};
+
+// Cursor state captured separately from the frame so the viewer can
+// composite it locally. `pixels` is only set when the shape changed.
+struct CursorData {
+    int x;
+    int y;
+    int hotspotX;
+    int hotspotY;
+    int width;
+    int height;
+    const uint32_t* pixels; // premultiplied ARGB, width * height, or nullptr
+    uint32_t serial;        // changes whenever the cursor shape changes
+    uint64_t timestamp;     // microseconds
 };
 
 class Capture {
 public:
     using FrameCallback = std::function<void(const FrameData&)>;
+    using CursorCallback = std::function<void(const CursorData&)>;
 
     virtual ~Capture() = default;
     virtual bool Start(FrameCallback callback) = 0;
     virtual void Stop() = 0;
+    // Optional cursor overlay stream; set before Start().
+    virtual void SetCursorCallback(CursorCallback callback) { (void)callback; }
+    // Live reconfiguration; safe to call while running. Backends that can't
+    // honour a change ignore it (SetRegion/SetTarget return false). Frame
+    // dimensions follow the target, including when a window is resized.
+    virtual void SetFrameRate(int fps) { (void)fps; }
+    virtual bool SetRegion(const CaptureRegion& region) { (void)region; return false; }
+    virtual bool SetTarget(const CaptureTarget& target) {
+        if (target.kind == CaptureTarget::Kind::Monitor || target.kind == CaptureTarget::Kind::Window)
+            return false;
+        return SetRegion(target.kind == CaptureTarget::Kind::Region ? target.region : CaptureRegion{});
+    }
+};
+
+// Backend selection; platforms with a single backend ignore it.
+struct CaptureBackendOptions {
+    std::string backend = "auto"; // "auto", "x11" or "pipewire"
+    // PipeWire node to connect to directly; 0 asks xdg-desktop-portal.
+    uint32_t pipewireNode = 0;
 };
 
 // Factory function for platform capture
-std::unique_ptr<Capture> createPlatformCapture();
+std::unique_ptr<Capture> createPlatformCapture(const CaptureBackendOptions& options = {});
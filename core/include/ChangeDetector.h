@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Capture.h"
+
+namespace stream {
+
+// Damage tracking for sources that don't report it: compares each frame
+// with the previous one in 64x64 tiles and fills FrameData's dirty-tile
+// bitmap.
+//
+// Nothing but a hash per tile row is kept, so a frame is read once and no
+// copy of the previous one is needed. Hashing runs near memory bandwidth,
+// which at 4K60 is still a third of a core, so by default only every 8th
+// row is hashed per frame, rotating so every row is seen within 8 frames;
+// a tile found dirty is rehashed in full. Changes at least rowStride rows
+// tall are caught on the frame they happen, thinner ones within rowStride
+// frames. rowStride 1 checks every row.
+class TileChangeDetector {
+public:
+    static constexpr int kTileSize = 64;
+
+    struct Options {
+        int rowStride = 8;
+    };
+
+    TileChangeDetector() : TileChangeDetector(Options{}) {}
+    explicit TileChangeDetector(const Options& options);
+
+    // Fills frame.dirtyTiles and friends; the bitmap lives in the detector
+    // and stays valid until the next call. A frame with a new size or
+    // generation, and the first frame, are dirty everywhere. Returns the
+    // number of dirty tiles.
+    size_t process(FrameData& frame);
+    // Makes the next frame dirty everywhere, e.g. after a keyframe request.
+    void reset() { hashes_.clear(); }
+
+    // Hash of one tile row of pixels: up to 256 bytes from `p`.
+    static uint64_t hashSpan(const uint8_t* p, size_t bytes);
+    // hashSpan() of every 256-byte span of a pixel row, into out[0..].
+    static void hashRow(const uint8_t* row, size_t bytes, uint64_t* out);
+
+    // hashRow() forced onto one implementation, so tests can check that
+    // they agree. False if it isn't built in or the CPU lacks it.
+    enum class HashImpl { Scalar, Sse2, Avx2 };
+    static bool hashRowWith(HashImpl impl, const uint8_t* row, size_t bytes, uint64_t* out);
+
+private:
+    int rowStride_;
+    int phase_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    uint32_t generation_ = 0;
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<uint64_t> hashes_; // [y * columns_ + tileX]
+    std::vector<uint64_t> bitmap_;
+    std::vector<uint64_t> row_;
+
+    void hashTile(const FrameData& frame, int tx, int ty);
+};
+
+}
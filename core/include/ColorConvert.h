@@ -11,3 +11,11 @@ void ConvertBGRAtoI420(const uint8_t* src, int width, int height,
                        uint8_t* dst_y, int stride_y,
                        uint8_t* dst_u, int stride_u,
                        uint8_t* dst_v, int stride_v);
+
+// Strided BGRA to the packed/semi-planar layouts v4l2 consumers expect.
+// Width and height must be even.
+void ConvertBGRAtoNV12(const uint8_t* src, int src_stride, int width, int height,
+                       uint8_t* dst_y, int stride_y,
+                       uint8_t* dst_uv, int stride_uv);
+void ConvertBGRAtoYUYV(const uint8_t* src, int src_stride, int width, int height,
+                       uint8_t* dst, int dst_stride);
@@ -0,0 +1,121 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "Capture.h"
+#include "ThreadTopology.h"
+
+namespace stream {
+
+// Typed view of config.json. Every field has a default, so a missing file
+// or key simply means "use the default".
+struct StreamConfig {
+    std::string signalingUrl = "ws://localhost:8080";
+    std::string stunServer = "stun:stun.l.google.com:19302";
+    std::string logLevel = "info";
+    std::string statsSocket = "/tmp/stream-core-stats.sock";
+    // Local consumers (preview, virtual camera) attach here; "" disables.
+    std::string frameBusSocket = "/tmp/stream-core-frames.sock";
+
+    struct Capture {
+        int framerate = 60;
+        int width = 1920;  // "resolution": "WxH"
+        int height = 1080;
+        CaptureRegion region; // "region": {"x","y","width","height"}
+        std::string monitor;  // "monitor": output name or "primary"; "" is off
+        int window = 0;       // "window": X window id; 0 is off
+        CaptureBackendOptions backend; // "backend", "pipewire_node"
+
+        // At most one of region, monitor and window is set.
+        CaptureTarget target() const {
+            CaptureTarget t = CaptureTarget::fromRegion(region);
+            if (!monitor.empty()) {
+                t.kind = CaptureTarget::Kind::Monitor;
+                t.monitor = monitor == "primary" ? "" : monitor;
+            } else if (window) {
+                t.kind = CaptureTarget::Kind::Window;
+                t.window = uint64_t(window);
+            }
+            return t;
+        }
+    } capture;
+
+    struct Audio {
+        bool enabled = true;
+        std::string device = "default"; // ALSA PCM name
+    } audio;
+
+    struct Encode {
+        int bitrate = 8000000;
+        bool hardware = true;
+        bool vfr = true; // skip static frames, see FramePacer
+    } encode;
+
+    // "threads": {"capture": {"cpus": "2-3", "scheduler": "fifo",
+    // "priority": 20}, ...}; see ThreadTopology.
+    struct Threads {
+        ThreadPolicy capture;
+        ThreadPolicy audio{{}, "fifo", 10};
+        ThreadPolicy network;
+        ThreadPolicy control;
+
+        const ThreadPolicy& forRole(ThreadRole role) const {
+            switch (role) {
+            case ThreadRole::Capture: return capture;
+            case ThreadRole::Audio: return audio;
+            case ThreadRole::Network: return network;
+            case ThreadRole::Control: break;
+            }
+            return control;
+        }
+    } threads;
+};
+
+// Validates `j` against the schema. On failure `errors` lists every
+// problem and `out` is left untouched.
+bool parseConfig(const nlohmann::json& j, StreamConfig& out, std::vector<std::string>& errors);
+bool loadConfig(const std::string& path, StreamConfig& out, std::vector<std::string>& errors);
+
+// Keys whose new value can be applied to a running pipeline; anything else
+// that changes is reported as needing a restart.
+struct ConfigDiff {
+    bool framerate = false;
+    bool bitrate = false;
+    bool vfr = false;
+    bool threads = false; // any role's policy
+    bool target = false; // capture region, monitor or window
+    std::vector<std::string> restartRequired;
+};
+ConfigDiff diffConfig(const StreamConfig& before, const StreamConfig& after);
+
+// Reloads the file when it changes on disk (inotify on the parent
+// directory, so editors that save via rename are caught) and hands valid
+// new configs to the callback. Invalid edits are logged and ignored.
+class ConfigWatcher {
+public:
+    using Callback = std::function<void(const StreamConfig& previous, const StreamConfig& current)>;
+
+    ConfigWatcher(std::string path, StreamConfig initial, Callback callback);
+    ~ConfigWatcher();
+
+    bool start();
+    void stop();
+    StreamConfig current() const;
+
+private:
+    std::string path_;
+    Callback callback_;
+    mutable std::mutex mutex_;
+    StreamConfig current_;
+    int inotifyFd_ = -1;
+    int wakeFd_ = -1;
+    std::thread thread_;
+
+    void run();
+    void reload();
+};
+
+}
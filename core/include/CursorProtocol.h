@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Capture.h"
+#include "WireFormat.h"
+
+// Wire format for the cursor overlay data channels. All fields are
+// little-endian.
+//
+//   position (9 bytes, "cursor" channel, unreliable/unordered):
+//     u8 type = 1, i16 x, i16 y, u32 serial
+//   shape ("cursor-shape" channel, reliable/ordered):
+//     u8 type = 2, u32 serial, u16 width, u16 height, u16 hotspotX,
+//     u16 hotspotY, then width * height premultiplied ARGB u32 pixels
+//
+// The viewer draws the shape whose serial matches the latest position.
+namespace stream {
+
+enum class CursorMessageType : uint8_t {
+    Position = 1,
+    Shape = 2,
+};
+
+constexpr size_t kCursorPositionSize = 9;
+constexpr size_t kCursorShapeHeaderSize = 13;
+
+inline void encodeCursorPosition(const CursorData& cursor, std::vector<uint8_t>& out) {
+    out.resize(kCursorPositionSize);
+    out[0] = uint8_t(CursorMessageType::Position);
+    wire::putLE16(&out[1], uint16_t(int16_t(cursor.x)));
+    wire::putLE16(&out[3], uint16_t(int16_t(cursor.y)));
+    wire::putLE32(&out[5], cursor.serial);
+}
+
+inline bool encodeCursorShape(const CursorData& cursor, std::vector<uint8_t>& out) {
+    if (!cursor.pixels || cursor.width <= 0 || cursor.height <= 0) return false;
+    size_t pixelCount = size_t(cursor.width) * size_t(cursor.height);
+    out.resize(kCursorShapeHeaderSize + pixelCount * 4);
+    uint8_t* p = out.data();
+    p[0] = uint8_t(CursorMessageType::Shape);
+    wire::putLE32(p + 1, cursor.serial);
+    wire::putLE16(p + 5, uint16_t(cursor.width));
+    wire::putLE16(p + 7, uint16_t(cursor.height));
+    wire::putLE16(p + 9, uint16_t(cursor.hotspotX));
+    wire::putLE16(p + 11, uint16_t(cursor.hotspotY));
+    p += kCursorShapeHeaderSize;
+    for (size_t i = 0; i < pixelCount; ++i, p += 4)
+        wire::putLE32(p, cursor.pixels[i]);
+    return true;
+}
+
+} // namespace stream
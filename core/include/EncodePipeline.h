@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "Capture.h"
+#include "Encoder.h"
+#include "FramePacer.h"
+
+namespace stream {
+
+// What runs on the capture thread between a captured frame and the
+// encoder, shared by main and WebRTCSession: follows capture size changes
+// (in place, or by restarting the encoder), drops static frames through
+// the FramePacer, passes damage on and counts what was encoded.
+//
+// The encoder is only ever touched from the capture thread. Rate changes
+// from elsewhere (a config reload) are stored and applied before the next
+// frame, so they can't race a restart or an encode in progress.
+class EncodePipeline {
+public:
+    struct Settings {
+        int width = 0;
+        int height = 0;
+        int framerate = 30;
+        int bitrate = 0;
+        bool vfr = true;
+    };
+
+    // Starts `encoder` at settings' size and rates; `onEncoded` gets every
+    // encoded frame, also after a restart. Call before capture starts.
+    bool start(Encoder& encoder, const Settings& settings, Encoder::EncodedCallback onEncoded);
+
+    // Capture thread.
+    void onFrame(const FrameData& frame);
+
+    // Any thread; applied before the next frame.
+    void setBitrate(int bitrate) { bitrate_.store(bitrate, std::memory_order_relaxed); }
+    void setFramerate(int fps) { framerate_.store(fps, std::memory_order_relaxed); }
+    void setVfr(bool enabled) { pacer_.setEnabled(enabled); }
+
+    // Size the encoder is configured for; follows the capture size.
+    int width() const { return width_.load(std::memory_order_relaxed); }
+    int height() const { return height_.load(std::memory_order_relaxed); }
+
+private:
+    Encoder* encoder_ = nullptr;
+    Encoder::EncodedCallback onEncoded_;
+    FramePacer pacer_;
+    std::atomic<int> width_{0};
+    std::atomic<int> height_{0};
+    std::atomic<int> bitrate_{0};
+    std::atomic<int> framerate_{0};
+    // Capture thread only.
+    uint32_t generation_ = 0;
+    int appliedBitrate_ = 0;
+    int appliedFramerate_ = 0;
+
+    void applyRates();
+    void resize(int width, int height);
+};
+
+}
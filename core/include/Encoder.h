@@ -5,9 +5,8 @@
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <thread>
-#include <chrono>
 #include <fstream>
+#include "ReplayScheduler.h"
 
 struct EncodedFrame {
     std::vector<uint8_t> data;
@@ -23,16 +22,40 @@ public:
     virtual bool Start(int width, int height, int fps, EncodedCallback callback) = 0;
     virtual void EncodeFrame(const uint8_t* data, int stride) = 0;
     virtual void Stop() = 0;
+    // Live rate control; returns false if the backend needs a restart.
+    virtual bool SetBitrate(int bitsPerSecond) { (void)bitsPerSecond; return false; }
+    virtual bool SetFramerate(int fps) { (void)fps; return false; }
+    // New input size on a running encoder. The session is kept and the next
+    // frame is a keyframe carrying new parameter sets, so a decoder follows
+    // without renegotiation. False if the backend needs Stop()/Start().
+    virtual bool Reconfigure(int width, int height) { (void)width; (void)height; return false; }
+    // Damage of the next frame as FrameData's dirty-tile bitmap (null: all
+    // changed). Encoders with ROI or QP maps spend bits on changed tiles and
+    // code the rest as skip; others ignore it.
+    virtual void SetDirtyTiles(const uint64_t* bitmap, int columns, int rows) {
+        (void)bitmap; (void)columns; (void)rows;
+    }
+    // The next frame repeats the previous picture (the screen went static).
+    // Encode it at a lower QP so detail lost to motion comes back; encoders
+    // without per-frame quality control encode it as usual.
+    virtual void RefineNextFrame() {}
     // Session recording API
     virtual void startRecording(const std::string& filename) { (void)filename; }
     virtual void stopRecording() {}
     virtual bool isRecording() const { return false; }
-    // Session playback API
-    static void playRecording(const std::string& filename, EncodedCallback callback, int fps = 30) {
+    // Session playback API. Replays a raw Annex B .h264 file at `fps`,
+    // one picture per VCL NAL; parameter sets and SEI are passed through as
+    // soon as they are reached. Timestamps are media time in microseconds. With
+    // the Drop policy a late picture is skipped along with everything up
+    // to the next IDR, so the stream stays decodable.
+    static void playRecording(const std::string& filename, EncodedCallback callback, int fps = 30,
+                              const stream::ReplayScheduler::Options& pacing = {}) {
         std::ifstream file(filename, std::ios::binary);
-        if (!file.is_open()) return;
-        // NOTE: This is a simple demo for raw .h264 files with one NAL per frame.
+        if (!file.is_open() || fps <= 0) return;
         std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        stream::ReplayScheduler scheduler(pacing);
+        uint64_t picture = 0;
+        bool skipping = false;
         size_t pos = 0;
         while (pos < buffer.size()) {
             // Find next NAL start code (0x00000001)
@@ -43,12 +66,22 @@ public:
                     break;
                 }
             }
-            EncodedFrame frame;
-            frame.data.assign(buffer.begin() + pos, buffer.begin() + next);
-            frame.isKeyFrame = (frame.data.size() > 4 && (frame.data[4] & 0x1F) == 5); // IDR NAL
-            frame.timestamp = pos;
-            callback(frame);
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000 / fps));
+            int nalType = next - pos > 4 ? (buffer[pos + 4] & 0x1F) : 0;
+            bool vcl = nalType >= 1 && nalType <= 5;
+            bool idr = nalType == 5;
+            uint64_t mediaMicros = picture * 1000000 / uint64_t(fps);
+            if (idr) skipping = false;
+            if (vcl) {
+                ++picture;
+                if (!skipping && !scheduler.wait(mediaMicros, !idr)) skipping = true;
+            }
+            if (!vcl || !skipping) {
+                EncodedFrame frame;
+                frame.data.assign(buffer.begin() + pos, buffer.begin() + next);
+                frame.isKeyFrame = idr;
+                frame.timestamp = mediaMicros;
+                callback(frame);
+            }
             pos = next;
         }
     }
@@ -0,0 +1,71 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace stream {
+
+// Single-threaded reactor. run() dispatches posted tasks, due timers and
+// readable file descriptors on the calling thread, and in between blocks
+// in epoll_wait until the next timer, or indefinitely when there is none,
+// so an idle loop costs no wakeups at all. Every call but run() is safe
+// from any thread; they wake the loop through an eventfd.
+// Handlers run one at a time, in the order their events were seen.
+class EventLoop {
+public:
+    using Task = std::function<void()>;
+    using TimerId = uint64_t;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Runs until stop(). Tasks still queued when it returns are dropped.
+    void run();
+    void stop();
+
+    void post(Task task);
+
+    // Calls `task` after `delay` and then every `interval`, if non-zero.
+    TimerId addTimer(std::chrono::milliseconds delay, Task task,
+                     std::chrono::milliseconds interval = std::chrono::milliseconds(0));
+    void cancelTimer(TimerId id);
+
+    // Calls `onReadable` whenever `fd` is readable (level-triggered), until
+    // unwatch(). The handler has to consume what made the fd readable.
+    // Linux only; returns false elsewhere.
+    bool watch(int fd, Task onReadable);
+    void unwatch(int fd);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        Clock::time_point due;
+        std::chrono::milliseconds interval;
+        std::shared_ptr<Task> task;
+    };
+
+    std::mutex mutex_;
+    std::vector<Task> tasks_;
+    std::map<TimerId, Timer> timers_;
+    std::map<int, std::shared_ptr<Task>> watches_;
+    TimerId nextTimer_ = 1;
+    bool stop_ = false;
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+    std::condition_variable cv_; // instead of the eventfd outside Linux
+
+    void wake();
+    // Caller holds mutex_. Time until the next timer; negative if none.
+    std::chrono::milliseconds nextTimeoutLocked(Clock::time_point now) const;
+    void runDue();
+};
+
+}
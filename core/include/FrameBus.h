@@ -0,0 +1,144 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stream {
+
+// Shared-memory frame transport for local consumers (UI preview, virtual
+// camera). The producer owns a memfd holding a small ring of frame slots;
+// consumers connect to a Unix socket, receive the memfd plus a private
+// eventfd over SCM_RIGHTS, and map the ring read-only. Frames are never
+// copied per consumer: a reader looks at the slot in place and then checks
+// the slot's sequence counter to see whether the producer lapped it.
+
+enum class FramePixelFormat : uint32_t { BGRA = 1, I420 = 2, NV12 = 3, YUYV = 4 };
+
+struct FrameBusInfo {
+    uint64_t index;     // monotonically increasing frame number, from 1
+    uint64_t timestamp; // microseconds
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t size;
+    FramePixelFormat format;
+};
+
+// Layout of the shared region; both sides are the same binary, so plain
+// structs with lock-free atomics are enough.
+namespace framebus {
+constexpr uint32_t kMagic = 0x53464231; // "SFB1"
+constexpr uint32_t kVersion = 1;
+
+struct SlotHeader {
+    std::atomic<uint64_t> seq; // odd while the producer is writing
+    FrameBusInfo info;
+    uint64_t dataOffset;
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotBytes;
+    std::atomic<uint64_t> latest; // index of the newest complete frame
+    SlotHeader slots[1];          // slotCount entries
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "frame bus needs lock-free 64-bit atomics");
+} // namespace framebus
+
+class FrameBusWriter {
+public:
+    ~FrameBusWriter();
+
+    // Creates the ring and listens for consumers on `socketPath`.
+    static std::unique_ptr<FrameBusWriter> create(const std::string& socketPath, uint32_t slotCount,
+                                                  uint32_t slotBytes);
+
+    // Zero-copy publish: fill the returned buffer (slotBytes long), then
+    // commit. Only one frame may be in flight at a time.
+    uint8_t* beginFrame();
+    void commitFrame(const FrameBusInfo& info);
+
+    // Copying publish for producers that already own a buffer. Frames larger
+    // than a slot are dropped and counted.
+    bool publish(const uint8_t* data, const FrameBusInfo& info);
+
+    uint32_t slotBytes() const { return slotBytes_; }
+    size_t consumers() const;
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    FrameBusWriter() = default;
+
+    std::string path_;
+    int memFd_ = -1;
+    int listenFd_ = -1;
+    int wakeFd_ = -1;
+    framebus::Header* header_ = nullptr;
+    uint8_t* base_ = nullptr;
+    size_t mappedBytes_ = 0;
+    uint32_t slotCount_ = 0;
+    uint32_t slotBytes_ = 0;
+    uint64_t nextIndex_ = 1;
+    std::atomic<uint64_t> dropped_{0};
+
+    struct Consumer {
+        int socketFd;
+        int eventFd;
+    };
+    mutable std::mutex consumersMutex_;
+    std::vector<Consumer> consumers_;
+    std::thread thread_;
+
+    void run();
+    void notify();
+};
+
+// One consumer's view of the ring.
+class FrameBusReader {
+public:
+    ~FrameBusReader();
+
+    static std::unique_ptr<FrameBusReader> connect(const std::string& socketPath);
+
+    // Blocks until a new frame is published or the timeout (ms, -1 for
+    // none) expires. Returns false on timeout or if the producer went away
+    // (closed() then reports true).
+    bool wait(int timeoutMs);
+    bool closed() const { return closed_; }
+
+    // Borrow the newest frame in place. `data` stays valid to read until the
+    // producer laps the ring; call stillValid() afterwards and discard the
+    // result if it returns false.
+    struct View {
+        const uint8_t* data = nullptr;
+        FrameBusInfo info{};
+        uint32_t slot = 0;
+        uint64_t seq = 0;
+    };
+    bool acquireLatest(View& view) const;
+    bool stillValid(const View& view) const;
+
+    // Descriptor that becomes readable when a frame is published, for
+    // callers running their own poll loop.
+    int eventFd() const { return eventFd_; }
+
+private:
+    FrameBusReader() = default;
+
+    int socketFd_ = -1;
+    int eventFd_ = -1;
+    const framebus::Header* header_ = nullptr;
+    const uint8_t* base_ = nullptr;
+    size_t mappedBytes_ = 0;
+    bool closed_ = false;
+};
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "Capture.h"
+
+namespace stream {
+
+// Variable frame rate between capture and encoder. Frames whose dirty-tile
+// bitmap says nothing changed are dropped instead of being encoded as
+// identical pictures. When motion stops a few refine frames follow, sent at
+// higher quality so text that scrolling left blurry sharpens; one-frame
+// changes (a cursor blink, a keystroke) are small enough not to need them.
+// After that a refresh goes out every `refreshInterval` so the receiver's
+// jitter buffer and freeze detection stay happy. The first frame with
+// damage is encoded at once, which puts the stream back at the capture
+// rate without any ramp.
+//
+// Frames without a bitmap are always encoded, so backends that can't tell
+// what changed behave exactly as before. Decisions use the frame's own
+// timestamp, so the policy runs the same on live and synthetic input.
+class FramePacer {
+public:
+    enum class Decision {
+        Encode,  // changed (or unknown) content
+        Refine,  // static, re-encode at higher quality
+        Refresh, // static, keepalive
+        Drop,
+    };
+
+    struct Options {
+        bool enabled = true;
+        int refineFrames = 2;      // after motion stops
+        int refineAfterFrames = 2; // consecutive changed frames that count as motion
+        std::chrono::microseconds refineInterval{100000};
+        std::chrono::microseconds refreshInterval{1000000};
+    };
+
+    struct Stats {
+        uint64_t encoded = 0;
+        uint64_t refined = 0;
+        uint64_t refreshed = 0;
+        uint64_t dropped = 0;
+    };
+
+    FramePacer() : FramePacer(Options{}) {}
+    explicit FramePacer(const Options& options) : options_(options), enabled_(options.enabled) {}
+
+    Decision decide(const FrameData& frame);
+
+    // The next frame is encoded whatever its damage, e.g. after the encoder
+    // restarted or the viewer asked for a keyframe.
+    void forceNext() { force_ = true; }
+    // Safe from any thread (config reload); disabled encodes every frame.
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    const Stats& stats() const { return stats_; }
+
+private:
+    Decision sent(Decision decision, uint64_t timestamp);
+
+    Options options_;
+    std::atomic<bool> enabled_;
+    bool force_ = true;
+    int burst_ = 0; // consecutive changed frames
+    int refinesLeft_ = 0;
+    uint64_t lastSent_ = 0; // frame timestamp, microseconds
+    Stats stats_;
+};
+
+}
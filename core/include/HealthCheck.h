@@ -1,4 +1,9 @@
 #pragma once
 namespace stream {
-bool health_check();
+struct StreamConfig;
+
+// Runs the platform capability probes in parallel and logs each result
+// with its timing. Fails only if something the pipeline cannot start
+// without is missing; optional features are reported and skipped later.
+bool health_check(const StreamConfig& config);
 }
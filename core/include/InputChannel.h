@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "InputInjector.h"
+
+namespace stream {
+// Receives raw messages from the input data channel and turns them into
+// InputInjector calls on a dedicated thread, so the WebRTC network thread
+// only ever copies bytes. See InputProtocol.h for the wire format.
+class InputChannel {
+public:
+    struct Stats {
+        uint64_t messages;
+        uint64_t malformed;
+        uint64_t events;
+        uint64_t injected;
+        uint64_t coalescedMoves;
+        uint64_t duplicates;
+        uint64_t staleMoves;
+        uint64_t staleKeys; // key and button events overtaken by a newer one
+        uint64_t meanLatencyMicros; // message receive -> inject done
+        uint64_t maxLatencyMicros;
+    };
+
+    explicit InputChannel(InputInjector& injector);
+    ~InputChannel();
+
+    void start();
+    void stop();
+
+    // Thread-safe; called from the WebRTC network thread.
+    void onMessage(const uint8_t* data, size_t size);
+    // A new viewer or input channel: its sequence numbers start over, so
+    // the replay window and per-key state are forgotten and anything still
+    // queued from the old one is dropped. Thread-safe.
+    void reset();
+
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Pending {
+        std::vector<uint8_t> bytes;
+        Clock::time_point received;
+    };
+
+    InputInjector& injector_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Pending> pending_;
+    std::thread thread_;
+    bool running_ = false;
+    bool resetPending_ = false;
+
+    // Owned by the worker thread.
+    bool anySeen_ = false;
+    uint32_t highestSeq_ = 0;
+    uint64_t seenWindow_ = 0;
+    bool anyMove_ = false;
+    uint32_t lastMoveSeq_ = 0;
+    // Last applied seq per key or button, keyed by type << 16 | code, so a
+    // late press can't undo the release that overtook it.
+    std::unordered_map<uint32_t, uint32_t> lastKeySeq_;
+    int lastX_ = 0;
+    int lastY_ = 0;
+
+    std::atomic<uint64_t> messages_{0};
+    std::atomic<uint64_t> malformed_{0};
+    std::atomic<uint64_t> events_{0};
+    std::atomic<uint64_t> injected_{0};
+    std::atomic<uint64_t> coalescedMoves_{0};
+    std::atomic<uint64_t> duplicates_{0};
+    std::atomic<uint64_t> staleMoves_{0};
+    std::atomic<uint64_t> staleKeys_{0};
+    std::atomic<uint64_t> latencySumMicros_{0};
+    std::atomic<uint64_t> latencySamples_{0};
+    std::atomic<uint64_t> latencyMaxMicros_{0};
+
+    void run();
+    void clearSequenceState();
+    bool markSeen(uint32_t seq);
+    void process(std::vector<Pending>& batch, std::vector<InputEvent>& decoded, std::vector<InputEvent>& coalesced);
+};
+}
@@ -1,12 +1,35 @@
 #pragma once
 #include <memory>
+#include <cstdint>
+#include <span>
 
 namespace stream {
+// A single remote input event as decoded from the input data channel.
+struct InputEvent {
+    enum class Type : uint8_t { MouseMove = 1, MouseButton = 2, Key = 3 };
+    Type type;
+    uint32_t seq;
+    int x;       // pointer position; for MouseButton, where the click lands
+    int y;
+    int code;    // button number or key code
+    bool down;   // MouseButton / Key
+};
+
 class InputInjector {
 public:
     virtual ~InputInjector() = default;
     virtual void injectMouse(int x, int y, int button, bool down) = 0;
     virtual void injectKeyboard(int key, bool down) = 0;
+    // Injects a batch in order. Backends override this to coalesce motion
+    // and flush once; the default falls back to the single-event calls.
+    virtual void injectBatch(std::span<const InputEvent> events) {
+        for (const InputEvent& ev : events) {
+            if (ev.type == InputEvent::Type::Key)
+                injectKeyboard(ev.code, ev.down);
+            else
+                injectMouse(ev.x, ev.y, ev.type == InputEvent::Type::MouseButton ? ev.code : 0, ev.down);
+        }
+    }
 };
 std::unique_ptr<InputInjector> createPlatformInputInjector();
 }
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "InputInjector.h"
+#include "WireFormat.h"
+
+// Wire format for the "input" data channel (unordered, no retransmits).
+// All fields are little-endian. One message carries a batch of events
+// with consecutive sequence numbers:
+//
+//   u8 version = 1, u32 firstSeq, u8 count, then `count` records:
+//     MouseMove   : u8 type = 1, i16 x, i16 y
+//     MouseButton : u8 type = 2, u8 button, u8 down
+//     Key         : u8 type = 3, u16 key, u8 down
+//
+// Because the channel may drop or reorder messages, the viewer should
+// repeat button and key events in its next few batches; the receiver drops
+// duplicates by sequence number, ignores moves older than the newest one it
+// has applied, and ignores a key or button event older than the last one
+// applied for the same key or button.
+namespace stream {
+
+constexpr uint8_t kInputProtocolVersion = 1;
+constexpr size_t kInputHeaderSize = 6;
+
+inline size_t inputRecordSize(InputEvent::Type type) {
+    switch (type) {
+    case InputEvent::Type::MouseMove: return 5;
+    case InputEvent::Type::MouseButton: return 3;
+    case InputEvent::Type::Key: return 4;
+    }
+    return 0;
+}
+
+// Writes `events` as one message, seq fields assigned from firstSeq, and
+// returns how many fit: at most kMaxInputBatch. Callers send the rest in
+// further messages starting at firstSeq plus that count.
+constexpr size_t kMaxInputBatch = 255;
+inline size_t encodeInputBatch(uint32_t firstSeq, std::span<const InputEvent> events, std::vector<uint8_t>& out) {
+    size_t count = events.size() > kMaxInputBatch ? kMaxInputBatch : events.size();
+    size_t size = kInputHeaderSize;
+    for (size_t i = 0; i < count; ++i) size += inputRecordSize(events[i].type);
+    out.resize(size);
+    uint8_t* p = out.data();
+    p[0] = kInputProtocolVersion;
+    wire::putLE32(p + 1, firstSeq);
+    p[5] = uint8_t(count);
+    p += kInputHeaderSize;
+    for (size_t i = 0; i < count; ++i) {
+        const InputEvent& ev = events[i];
+        p[0] = uint8_t(ev.type);
+        switch (ev.type) {
+        case InputEvent::Type::MouseMove:
+            wire::putLE16(p + 1, uint16_t(int16_t(ev.x)));
+            wire::putLE16(p + 3, uint16_t(int16_t(ev.y)));
+            break;
+        case InputEvent::Type::MouseButton:
+            p[1] = uint8_t(ev.code);
+            p[2] = ev.down ? 1 : 0;
+            break;
+        case InputEvent::Type::Key:
+            wire::putLE16(p + 1, uint16_t(ev.code));
+            p[3] = ev.down ? 1 : 0;
+            break;
+        }
+        p += inputRecordSize(ev.type);
+    }
+    return count;
+}
+
+// Appends the decoded events to `out`. Returns false on a malformed or
+// unknown-version message, in which case nothing is appended.
+inline bool decodeInputBatch(const uint8_t* data, size_t size, std::vector<InputEvent>& out) {
+    if (size < kInputHeaderSize || data[0] != kInputProtocolVersion) return false;
+    uint32_t seq = wire::getLE32(data + 1);
+    size_t count = data[5];
+    size_t start = out.size();
+    const uint8_t* p = data + kInputHeaderSize;
+    const uint8_t* end = data + size;
+    for (size_t i = 0; i < count; ++i) {
+        if (p >= end) break;
+        InputEvent ev{};
+        ev.type = InputEvent::Type(p[0]);
+        ev.seq = seq + uint32_t(i);
+        size_t recordSize = inputRecordSize(ev.type);
+        if (recordSize == 0 || size_t(end - p) < recordSize) {
+            out.resize(start);
+            return false;
+        }
+        switch (ev.type) {
+        case InputEvent::Type::MouseMove:
+            ev.x = int16_t(wire::getLE16(p + 1));
+            ev.y = int16_t(wire::getLE16(p + 3));
+            break;
+        case InputEvent::Type::MouseButton:
+            ev.code = p[1];
+            ev.down = p[2] != 0;
+            break;
+        case InputEvent::Type::Key:
+            ev.code = wire::getLE16(p + 1);
+            ev.down = p[3] != 0;
+            break;
+        }
+        out.push_back(ev);
+        p += recordSize;
+    }
+    if (out.size() - start != count) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+} // namespace stream
@@ -1,6 +1,196 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <type_traits>
+
+// Asynchronous logger. A log call copies its format string pointer and raw
+// arguments into a per-thread lock-free ring; a background thread formats
+// and writes them in batches. Nothing on the calling thread allocates,
+// formats or makes a syscall.
+//
+//   STREAM_LOG_INFO("encoder started {}x{} @ {} fps", w, h, fps);
+//   STREAM_LOG_EVERY_MS(stream::LogLevel::Info, 1000, "frame {}", ts);
+//
+// The format must be a string literal; "{}" is replaced by the next
+// argument. Levels below STREAM_LOG_MIN_LEVEL are compiled out entirely;
+// setLogLevel() raises the threshold further at runtime.
+#ifndef STREAM_LOG_MIN_LEVEL
+#define STREAM_LOG_MIN_LEVEL 0
+#endif
+
 namespace stream {
+
+enum class LogLevel : uint8_t { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
 void log_info(const std::string& msg);
 void log_error(const std::string& msg);
+
+void setLogLevel(LogLevel level);
+LogLevel parseLogLevel(std::string_view name, LogLevel fallback = LogLevel::Info);
+// Blocks until everything logged so far has been written.
+void flushLogs();
+
+namespace logdetail {
+
+extern std::atomic<uint8_t> runtimeLevel;
+
+constexpr bool compiledIn(int level) { return level >= STREAM_LOG_MIN_LEVEL; }
+
+inline bool enabled(LogLevel level) {
+    return uint8_t(level) >= runtimeLevel.load(std::memory_order_relaxed);
 }
+
+// Reserves `bytes` (a multiple of 8) in the calling thread's ring. Returns
+// nullptr if the ring is full; the record is then dropped and counted.
+uint8_t* beginRecord(size_t bytes);
+void commitRecord(LogLevel level);
+
+// Record layout after the 8-byte ring header:
+//   u64 timestamp (ns, steady clock), const char* format, u8 level,
+//   u8 argument count, then tagged arguments.
+constexpr size_t kRecordHeader = 8 + 8 + sizeof(const char*) + 2;
+constexpr size_t kMaxStringArg = 4096;
+
+template <typename T>
+using Decayed = std::remove_cv_t<std::remove_reference_t<T>>;
+
+template <typename T>
+constexpr bool isString = std::is_same_v<Decayed<T>, std::string> ||
+                          std::is_same_v<Decayed<T>, std::string_view> ||
+                          std::is_same_v<std::decay_t<T>, const char*> ||
+                          std::is_same_v<std::decay_t<T>, char*>;
+
+template <typename T>
+inline std::string_view asView(const T& v) {
+    if constexpr (std::is_pointer_v<Decayed<T>>)
+        return v ? std::string_view(v) : std::string_view("(null)");
+    else
+        return std::string_view(v);
+}
+
+template <typename T>
+inline size_t argSize(const T& v) {
+    if constexpr (isString<T>) {
+        size_t n = asView(v).size();
+        return 1 + 4 + (n > kMaxStringArg ? kMaxStringArg : n);
+    } else if constexpr (std::is_same_v<Decayed<T>, bool> || std::is_same_v<Decayed<T>, char>) {
+        return 2;
+    } else {
+        static_assert(std::is_arithmetic_v<Decayed<T>> || std::is_enum_v<Decayed<T>> ||
+                      std::is_pointer_v<Decayed<T>>, "unsupported log argument type");
+        return 1 + 8;
+    }
+}
+
+template <typename T>
+inline void argWrite(uint8_t*& p, const T& v) {
+    using D = Decayed<T>;
+    if constexpr (isString<T>) {
+        std::string_view s = asView(v);
+        uint32_t n = uint32_t(s.size() > kMaxStringArg ? kMaxStringArg : s.size());
+        *p++ = 's';
+        memcpy(p, &n, 4);
+        memcpy(p + 4, s.data(), n);
+        p += 4 + n;
+    } else if constexpr (std::is_same_v<D, bool>) {
+        *p++ = 'b';
+        *p++ = v ? 1 : 0;
+    } else if constexpr (std::is_same_v<D, char>) {
+        *p++ = 'c';
+        *p++ = uint8_t(v);
+    } else if constexpr (std::is_enum_v<D>) {
+        int64_t x = int64_t(v);
+        *p++ = 'i';
+        memcpy(p, &x, 8);
+        p += 8;
+    } else if constexpr (std::is_floating_point_v<D>) {
+        double x = double(v);
+        *p++ = 'd';
+        memcpy(p, &x, 8);
+        p += 8;
+    } else if constexpr (std::is_pointer_v<D>) {
+        uint64_t x = uint64_t(reinterpret_cast<uintptr_t>(v));
+        *p++ = 'p';
+        memcpy(p, &x, 8);
+        p += 8;
+    } else if constexpr (std::is_signed_v<D>) {
+        int64_t x = int64_t(v);
+        *p++ = 'i';
+        memcpy(p, &x, 8);
+        p += 8;
+    } else {
+        uint64_t x = uint64_t(v);
+        *p++ = 'u';
+        memcpy(p, &x, 8);
+        p += 8;
+    }
+}
+
+template <typename... Args>
+inline void enqueue(LogLevel level, const char* format, const Args&... args) {
+    size_t size = kRecordHeader + (size_t(0) + ... + argSize(args));
+    size = (size + 7) & ~size_t(7);
+    uint8_t* p = beginRecord(size);
+    if (!p) return;
+    uint8_t* q = p + 8;
+    uint64_t ts = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    memcpy(q, &ts, 8);
+    memcpy(q + 8, &format, sizeof(format));
+    q += 8 + sizeof(format);
+    *q++ = uint8_t(level);
+    *q++ = uint8_t(sizeof...(Args));
+    (argWrite(q, args), ...);
+    commitRecord(level);
+}
+
+// Per-call-site limiter for hot paths. Returns true at most once per
+// interval and reports how many calls were suppressed since the last one.
+inline bool rateLimit(std::atomic<int64_t>& last, std::atomic<uint64_t>& suppressed,
+                      int64_t intervalMs, uint64_t& suppressedOut) {
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t prev = last.load(std::memory_order_relaxed);
+    if (now - prev < intervalMs || !last.compare_exchange_strong(prev, now, std::memory_order_relaxed)) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressedOut = suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace logdetail
+} // namespace stream
+
+#define STREAM_LOG(level, fmt, ...)                                                   \
+    do {                                                                              \
+        if constexpr (::stream::logdetail::compiledIn(int(level))) {                 \
+            if (::stream::logdetail::enabled(level))                                  \
+                ::stream::logdetail::enqueue(level, fmt __VA_OPT__(, ) __VA_ARGS__);  \
+        }                                                                             \
+    } while (0)
+
+#define STREAM_LOG_DEBUG(fmt, ...) STREAM_LOG(::stream::LogLevel::Debug, fmt __VA_OPT__(, ) __VA_ARGS__)
+#define STREAM_LOG_INFO(fmt, ...) STREAM_LOG(::stream::LogLevel::Info, fmt __VA_OPT__(, ) __VA_ARGS__)
+#define STREAM_LOG_WARN(fmt, ...) STREAM_LOG(::stream::LogLevel::Warn, fmt __VA_OPT__(, ) __VA_ARGS__)
+#define STREAM_LOG_ERROR(fmt, ...) STREAM_LOG(::stream::LogLevel::Error, fmt __VA_OPT__(, ) __VA_ARGS__)
+
+// At most one message per `intervalMs` from this call site; the next one
+// that gets through carries the number of suppressed calls.
+#define STREAM_LOG_EVERY_MS(level, intervalMs, fmt, ...)                                         \
+    do {                                                                                         \
+        if constexpr (::stream::logdetail::compiledIn(int(level))) {                            \
+            static std::atomic<int64_t> streamLogLast_{INT64_MIN / 2};                           \
+            static std::atomic<uint64_t> streamLogSuppressed_{0};                                \
+            uint64_t streamLogDropped_ = 0;                                                      \
+            if (::stream::logdetail::enabled(level) &&                                           \
+                ::stream::logdetail::rateLimit(streamLogLast_, streamLogSuppressed_, intervalMs, \
+                                               streamLogDropped_))                               \
+                ::stream::logdetail::enqueue(level, fmt " ({} suppressed)" __VA_OPT__(, )        \
+                                             __VA_ARGS__, streamLogDropped_);                    \
+        }                                                                                        \
+    } while (0)
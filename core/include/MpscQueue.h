@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace stream {
+// Unbounded multi-producer / single-consumer queue (Vyukov's intrusive
+// design). push() is wait-free and may be called from any thread; pop()
+// must only be called from one consumer thread. A producer that has
+// swapped the tail but not yet linked its node makes pop() briefly report
+// empty, so consumers should treat empty as "try again after a wakeup".
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    ~MpscQueue() {
+        while (pop()) {}
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        size_.fetch_add(1, std::memory_order_relaxed);
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> pop() {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) return std::nullopt;
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return take(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire))
+            return std::nullopt; // producer mid-push
+        // Last real node: park the stub behind it so it can be detached.
+        stub_.next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = head_.exchange(&stub_, std::memory_order_acq_rel);
+        prev->next.store(&stub_, std::memory_order_release);
+        next = tail->next.load(std::memory_order_acquire);
+        if (!next) return std::nullopt;
+        tail_ = next;
+        return take(tail);
+    }
+
+    // Approximate; exact only when no push/pop is in flight.
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    struct Node {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value;
+    };
+
+    std::optional<T> take(Node* node) {
+        std::optional<T> value = std::move(node->value);
+        delete node;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return value;
+    }
+
+    std::atomic<Node*> head_;
+    Node* tail_;
+    Node stub_;
+    std::atomic<size_t> size_{0};
+};
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ThreadTopology.h"
+
+namespace stream {
+
+// Hot-path counters bumped by capture/encode; relaxed atomics only.
+struct PipelineCounters {
+    std::atomic<uint64_t> framesCaptured{0};
+    std::atomic<uint64_t> framesEncoded{0};
+    std::atomic<uint64_t> framesSkipped{0}; // static, dropped before the encoder
+    std::atomic<uint64_t> keyFramesEncoded{0};
+    std::atomic<uint64_t> bytesEncoded{0};
+    std::atomic<uint64_t> encodeMicros{0};
+    std::atomic<uint64_t> grabMicros{0}; // capture thread blocked on the grab
+    std::atomic<int> iceConnectionState{0};
+    std::atomic<int> signalingState{0};
+    std::atomic<uint64_t> timeToFirstFrameMicros{0}; // set once by startup
+};
+
+PipelineCounters& pipelineCounters();
+
+// One merged view of internal counters and WebRTC getStats().
+struct StatsSnapshot {
+    uint64_t timestampMicros;
+    double captureFps;
+    double encodeFps;
+    double skippedFps;
+    double encodeMsAvg;
+    double grabMsAvg;
+    double encodedKbps;
+    uint64_t keyFrames;
+    // From the peer connection; zero until the first report arrives.
+    double rttMs;
+    int64_t packetsLost;
+    double fractionLost;
+    double jitterMs;
+    double jitterBufferDelayMs;
+    double availableOutgoingKbps;
+    uint64_t framesSent;
+    int iceConnectionState;
+    int signalingState;
+    double timeToFirstFrameMs; // zero until the first frame was encoded
+};
+
+// `threads` becomes a "threads" array of name, role, tid and cpu_ms.
+std::string statsToJson(const StatsSnapshot& snapshot, const std::vector<ThreadUsage>& threads = {});
+
+// Single-writer, many-reader snapshot slot. Each of the two buffers has its
+// own sequence counter, so readers never block the writer and retry only if
+// a publish lands on the buffer they are copying.
+class StatsPublisher {
+public:
+    void publish(const StatsSnapshot& snapshot);
+    StatsSnapshot latest() const;
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq{0};
+        StatsSnapshot data{};
+    };
+    Slot slots_[2];
+    std::atomic<uint32_t> current_{0};
+};
+
+// Serves the latest snapshot as JSON to anyone who connects to a Unix
+// socket, e.g. `socat - UNIX-CONNECT:/tmp/stream-stats.sock`.
+class StatsServer {
+public:
+    explicit StatsServer(const StatsPublisher& publisher) : publisher_(publisher) {}
+    ~StatsServer();
+
+    bool start(const std::string& socketPath);
+    void stop();
+
+private:
+    const StatsPublisher& publisher_;
+    std::string path_;
+    int listenFd_ = -1;
+    int wakeFd_ = -1;
+    std::thread thread_;
+
+    void run();
+};
+
+}
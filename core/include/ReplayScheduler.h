@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace stream {
+
+// Paces recorded media against the steady clock. Every item is due at
+// start + mediaTime / speed, an absolute deadline, so time spent in the
+// consumer never shifts later items and a long replay ends on time.
+//
+// When the consumer falls behind, CatchUp releases the overdue items
+// back-to-back until the schedule is met again; Drop skips droppable items
+// that are more than `lateTolerance` overdue. Speed 0 replays as fast as
+// possible, which turns recordings into deterministic load generators.
+class ReplayScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class LatePolicy { CatchUp, Drop };
+
+    struct Options {
+        double speed = 1.0; // clamped to [kMinSpeed, kMaxSpeed]; 0 = unthrottled
+        LatePolicy late = LatePolicy::CatchUp;
+        std::chrono::microseconds lateTolerance{50000};
+    };
+
+    struct Stats {
+        uint64_t delivered = 0;
+        uint64_t dropped = 0;
+        uint64_t late = 0;           // delivered after their deadline
+        int64_t maxLateMicros = 0;
+    };
+
+    static constexpr double kMinSpeed = 0.5;
+    static constexpr double kMaxSpeed = 16.0;
+
+    ReplayScheduler() : ReplayScheduler(Options{}) {}
+    explicit ReplayScheduler(const Options& options);
+
+    // Blocks until the item at `mediaMicros` is due. Returns false if it
+    // should be skipped instead. The first call anchors the schedule, so
+    // replays may start at any media offset.
+    bool wait(uint64_t mediaMicros, bool droppable = true);
+
+    // Restarts the schedule at the next wait(), e.g. after a seek.
+    void reset() { started_ = false; }
+
+    double speed() const { return speed_; }
+    bool unthrottled() const { return speed_ == 0.0; }
+    const Stats& stats() const { return stats_; }
+
+private:
+    double speed_;
+    LatePolicy late_;
+    std::chrono::microseconds lateTolerance_;
+    bool started_ = false;
+    Clock::time_point start_;
+    uint64_t startMedia_ = 0;
+    Stats stats_;
+};
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace stream {
+
+// Streaming polyphase FIR resampler for interleaved S16 audio. The ratio is
+// reduced to L/M and a Kaiser-windowed sinc prototype is split into L
+// phases, so each output sample is one `tapsPerPhase`-long dot product
+// (SSE/NEON where available). History is kept between calls, so blocks of
+// any size can be fed. Equal rates pass straight through.
+class Resampler {
+public:
+    Resampler(int inputRate, int outputRate, int channels, int tapsPerPhase = 32);
+
+    // Appends the resampled frames to `out`.
+    void process(const int16_t* in, size_t frames, std::vector<int16_t>& out);
+    void reset();
+
+    int inputRate() const { return inputRate_; }
+    int outputRate() const { return outputRate_; }
+    // Group delay of the filter, in input frames.
+    int delayFrames() const { return taps_ / 2; }
+
+private:
+    int inputRate_;
+    int outputRate_;
+    int channels_;
+    int taps_;
+    int up_ = 1;   // L
+    int down_ = 1; // M
+    std::vector<float> coeffs_;                // up_ phases x taps_, each reversed
+    std::vector<std::vector<float>> history_;  // per channel, planar
+    size_t position_ = 0;                      // window start within history_
+    int phase_ = 0;
+};
+
+}
@@ -1,14 +1,31 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <functional>
 
 namespace stream {
+class EventLoop;
+
+struct SignalingMetrics {
+    size_t inboundQueueDepth;   // received, not yet dispatched
+    size_t outboundQueueDepth;  // sent by the app, not yet written
+    uint64_t messagesReceived;
+    uint64_t messagesSent;
+    uint64_t reconnects;
+    bool connected;
+};
+
 class SignalingClient {
 public:
     virtual ~SignalingClient() = default;
     virtual void connect(const std::string& url) = 0;
     virtual void send(const std::string& msg) = 0;
     virtual void onMessage(std::function<void(const std::string&)> cb) = 0;
+    // Runs onMessage callbacks on `loop` as soon as messages arrive, rather
+    // than on a thread of the client's own. Call before connect().
+    virtual void attach(EventLoop& loop) { (void)loop; }
+    virtual SignalingMetrics metrics() const { return {}; }
 };
 SignalingClient* createWebSocketSignalingClient();
 }
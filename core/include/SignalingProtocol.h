@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Versioned signaling envelope. Every message is one JSON object:
+//
+//   {"v":1, "type":"offer"|"answer"|"candidates"|"bye", "session":"<id>",
+//    "sdp":"...",                                  // offer / answer
+//    "candidates":[{"c":"candidate:...", "mid":"0", "idx":0}, ...]}
+//
+// Trickled ICE candidates are batched so a gathering burst costs one
+// WebSocket frame per batch window instead of one per candidate. Messages
+// with the old "offer:", "answer:" and "candidate:" text prefixes are still
+// accepted from peers that haven't been updated.
+namespace stream {
+
+constexpr int kSignalingProtocolVersion = 1;
+
+struct IceCandidateInfo {
+    std::string candidate;
+    std::string mid;
+    int mlineIndex = 0;
+};
+
+struct SignalingMessage {
+    enum class Type { Unknown, Offer, Answer, Candidates, Bye };
+    Type type = Type::Unknown;
+    int version = kSignalingProtocolVersion;
+    std::string session;
+    std::string sdp;
+    std::vector<IceCandidateInfo> candidates;
+};
+
+std::string encodeSignalingMessage(const SignalingMessage& msg);
+
+// Parses either the JSON envelope or a legacy prefixed text message.
+// Returns false if the message is malformed or from a newer major version.
+bool parseSignalingMessage(std::string_view text, SignalingMessage& out);
+
+// Collects local ICE candidates and hands them out in batches, at most one
+// batch per window. flush() sends whatever is pending immediately, e.g.
+// when gathering completes.
+class CandidateBatcher {
+public:
+    using FlushCallback = std::function<void(std::vector<IceCandidateInfo>&&)>;
+
+    CandidateBatcher(std::chrono::milliseconds window, FlushCallback callback);
+    ~CandidateBatcher();
+
+    void add(IceCandidateInfo candidate);
+    void flush();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::chrono::milliseconds window_;
+    FlushCallback callback_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<IceCandidateInfo> pending_;
+    Clock::time_point deadline_;
+    bool stop_ = false;
+    std::thread thread_;
+
+    void run();
+};
+
+}
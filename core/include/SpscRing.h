@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace stream {
+// Bounded single-producer / single-consumer ring of trivially copyable
+// elements. write() is only called from the producer thread and
+// read()/readable()/consume() only from the consumer thread; neither side
+// blocks or allocates. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing holds raw samples/bytes");
+
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        buffer_.resize(n);
+        mask_ = n - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return buffer_.size(); }
+    // Approximate from any thread; exact from producer (lower bound) or
+    // consumer (lower bound of what it can read).
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // Copies up to `count` elements in; returns how many fit.
+    size_t write(const T* data, size_t count) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        count = std::min(count, capacity() - (head - tail));
+        size_t offset = head & mask_;
+        size_t first = std::min(count, capacity() - offset);
+        memcpy(&buffer_[offset], data, first * sizeof(T));
+        memcpy(&buffer_[0], data + first, (count - first) * sizeof(T));
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Copies up to `count` elements out; returns how many were read.
+    size_t read(T* out, size_t count) {
+        std::span<const T> first = readable();
+        size_t n = std::min(count, first.size());
+        memcpy(out, first.data(), n * sizeof(T));
+        consume(n);
+        if (n < count) {
+            std::span<const T> second = readable();
+            size_t m = std::min(count - n, second.size());
+            memcpy(out + n, second.data(), m * sizeof(T));
+            consume(m);
+            n += m;
+        }
+        return n;
+    }
+
+    // Zero-copy read: the contiguous run of elements starting at the read
+    // position (may be shorter than size() when the data wraps).
+    std::span<const T> readable() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t offset = tail & mask_;
+        return {&buffer_[offset], std::min(head - tail, capacity() - offset)};
+    }
+
+    void consume(size_t count) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0}; // producer
+    alignas(64) std::atomic<size_t> tail_{0}; // consumer
+};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace stream {
+
+// Brings subsystems up concurrently. Each step runs on its own thread as
+// soon as the steps it depends on have succeeded; a failed step skips its
+// dependents. run() may be called repeatedly: only steps added since the
+// previous call run, so startup can be split into phases with cheap serial
+// wiring in between.
+//
+// The orchestrator's construction is the zero point for the startup
+// timeline and for time-to-first-frame.
+class StartupOrchestrator {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Step = std::function<bool()>;
+
+    struct StepResult {
+        std::string name;
+        bool ok = false;
+        bool skipped = false;       // a dependency failed
+        bool required = true;
+        std::chrono::microseconds startedAt{0}; // since construction
+        std::chrono::microseconds elapsed{0};
+    };
+
+    StartupOrchestrator() : start_(Clock::now()) {}
+
+    // `after` names steps that must succeed first; they must already have
+    // been added. Optional steps may fail without failing run().
+    void add(const std::string& name, Step step, std::vector<std::string> after = {}, bool required = true);
+    // Runs pending steps; false if a required one failed or was skipped.
+    bool run();
+
+    // Call from the encoder callback; only the first call is recorded.
+    // Returns true for that first call.
+    bool markFirstFrame();
+    // Zero until the first frame was marked.
+    std::chrono::microseconds timeToFirstFrame() const {
+        return std::chrono::microseconds(first_frame_us_.load(std::memory_order_relaxed));
+    }
+    std::chrono::microseconds sinceStart() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_);
+    }
+
+    const std::vector<StepResult>& results() const { return results_; }
+    // One log line per step with its start offset and duration.
+    void logTimeline() const;
+
+private:
+    struct Pending {
+        std::string name;
+        Step step;
+        std::vector<std::string> after;
+        bool required;
+    };
+
+    Clock::time_point start_;
+    std::vector<Pending> pending_;
+    std::vector<StepResult> results_;
+    std::atomic<bool> first_frame_seen_{false};
+    std::atomic<int64_t> first_frame_us_{0};
+};
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace stream {
+
+// What a thread does, which decides where and how it is scheduled.
+// Encoding runs inline on the capture thread, so Capture covers both.
+enum class ThreadRole {
+    Capture, // screen grab, cursor, change detection, encode
+    Audio,   // audio capture and playback
+    Network, // WebRTC and WebSocket threads
+    Control, // signaling pump, stats, config, local consumers
+};
+constexpr int kThreadRoleCount = 4;
+const char* threadRoleName(ThreadRole role);
+
+struct ThreadPolicy {
+    std::vector<int> cpus;           // allowed CPUs; empty leaves affinity alone
+    std::string scheduler = "other"; // "other", "fifo" or "rr"
+    int priority = 0;                // 1-99, for fifo and rr
+
+    bool operator==(const ThreadPolicy& o) const {
+        return cpus == o.cpus && scheduler == o.scheduler && priority == o.priority;
+    }
+};
+
+struct ThreadUsage {
+    std::string name;
+    ThreadRole role;
+    int tid;
+    uint64_t cpuMicros; // user + system since the thread started
+};
+
+// Parses a kernel-style CPU list ("0-3,8,10-11") into sorted, unique ids.
+bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+
+// Process-wide registry of pipeline threads. Each thread registers itself
+// once it starts; it is named, gets its role's affinity and scheduler and
+// is then visible in usage(). Policies can change at any time and are
+// reapplied to threads already running. Realtime scheduling needs
+// CAP_SYS_NICE or an RLIMIT_RTPRIO grant; without it the thread keeps
+// running under SCHED_OTHER and a warning is logged.
+//
+// Everything is a no-op but the bookkeeping outside Linux.
+class ThreadTopology {
+public:
+    void setPolicy(ThreadRole role, const ThreadPolicy& policy);
+    ThreadPolicy policy(ThreadRole role) const;
+
+    // Registers the calling thread. Names longer than 15 characters are
+    // cut, as the kernel keeps no more.
+    void enter(ThreadRole role, const std::string& name);
+    // Unregisters the calling thread. Threads that exit without it are
+    // dropped by the next usage() call.
+    void leave();
+
+    std::vector<ThreadUsage> usage();
+
+    // NUMA node of the role's CPUs, or -1 when the role isn't pinned to a
+    // single node or the host has only one.
+    int numaNode(ThreadRole role) const;
+    // Prefers the role's node for pages of [addr, addr + bytes) that
+    // haven't been touched yet. Call it on fresh mappings before the first
+    // write. False if nothing was bound.
+    bool bindToNode(void* addr, size_t bytes, ThreadRole role) const;
+
+private:
+    struct Entry {
+        std::string name;
+        ThreadRole role;
+        int tid;
+    };
+
+    mutable std::mutex mutex_;
+    ThreadPolicy policies_[kThreadRoleCount];
+    std::vector<Entry> threads_;
+
+    // Caller holds mutex_.
+    void applyLocked(const Entry& entry) const;
+};
+
+ThreadTopology& threadTopology();
+
+// Registers the current thread for the lifetime of the scope:
+//   stream::ThreadScope scope(stream::ThreadRole::Capture, "capture-x11");
+class ThreadScope {
+public:
+    ThreadScope(ThreadRole role, const std::string& name) { threadTopology().enter(role, name); }
+    ~ThreadScope() { threadTopology().leave(); }
+    ThreadScope(const ThreadScope&) = delete;
+    ThreadScope& operator=(const ThreadScope&) = delete;
+};
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "InputInjector.h"
+#include <linux/input.h>
+#include <memory>
+#include <vector>
+
+namespace stream {
+// InputInjector backed by /dev/uinput, for Wayland and headless hosts
+// where XTest isn't available. Creates an absolute pointer and a keyboard
+// device; key codes are X keycodes (evdev + 8) as on the X11 backend.
+class UInputInjector : public InputInjector {
+public:
+    // Creates both virtual devices sized to a width x height screen.
+    // Returns nullptr if /dev/uinput can't be opened or configured.
+    static std::unique_ptr<UInputInjector> create(int width, int height);
+
+    // Takes ownership of already-configured device fds. Tests pass the
+    // write ends of pipes here.
+    UInputInjector(int pointerFd, int keyboardFd);
+    ~UInputInjector() override;
+
+    void injectMouse(int x, int y, int button, bool down) override;
+    void injectKeyboard(int key, bool down) override;
+    void injectBatch(std::span<const InputEvent> events) override;
+
+private:
+    int pointerFd_;
+    int keyboardFd_;
+    std::vector<input_event> pending_;
+    int pendingFd_ = -1;
+    int lastX_ = -1, lastY_ = -1; // pointer position last written
+
+    void emit(int fd, uint16_t type, uint16_t code, int32_t value);
+    void sync(int fd);
+    void moveTo(int x, int y);
+    void append(const InputEvent& ev);
+    bool flush();
+};
+}
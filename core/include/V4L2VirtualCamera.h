@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameBus.h"
+
+// Exposes frames as a webcam through a v4l2loopback device.
+//
+// After Configure() the device runs in mmap streaming mode: frames are
+// converted straight into driver buffers and handed over with QBUF, so
+// there is no intermediate copy. Devices that refuse REQBUFS fall back to
+// write().
+class V4L2VirtualCamera {
+public:
+    explicit V4L2VirtualCamera(const std::string& devicePath);
+    ~V4L2VirtualCamera();
+
+    // False with a reason if the v4l2loopback module isn't loaded.
+    static bool LoopbackAvailable(std::string* reason = nullptr);
+
+    bool Open();
+    // Negotiates the output format (YUYV, NV12 or I420) and sets up
+    // `bufferCount` mmap buffers.
+    bool Configure(int width, int height, stream::FramePixelFormat format, int bufferCount = 4);
+    void Close();
+
+    // Converts a BGRA frame into the next free driver buffer and queues it.
+    bool WriteFrameBGRA(const uint8_t* bgra, int stride, uint64_t timestampMicros);
+    // Already in the negotiated format; copied into the next buffer.
+    bool WriteFrame(const uint8_t* data, size_t size);
+
+    // Lower level: fill the returned buffer (Capacity() bytes) and queue it.
+    uint8_t* AcquireBuffer();
+    bool QueueBuffer(size_t bytesUsed, uint64_t timestampMicros);
+    size_t Capacity() const { return frame_bytes_; }
+    bool Streaming() const { return streaming_; }
+
+    // Feed the device straight from the core's frame bus instead of having
+    // frames pushed to us. Runs on its own thread until DetachFrameBus().
+    bool AttachFrameBus(const std::string& busSocketPath);
+    void DetachFrameBus();
+    // Frames the producer overwrote while we were still writing them out.
+    uint64_t TornFrames() const { return torn_frames_.load(std::memory_order_relaxed); }
+
+private:
+    struct MappedBuffer {
+        uint8_t* data;
+        size_t length;
+    };
+
+    std::string devicePath_;
+    int fd_;
+    int width_ = 0;
+    int height_ = 0;
+    stream::FramePixelFormat format_ = stream::FramePixelFormat::YUYV;
+    int bytes_per_line_ = 0;
+    size_t frame_bytes_ = 0;
+    std::vector<MappedBuffer> buffers_;
+    std::vector<uint8_t> write_buffer_; // write() fallback only
+    int free_index_ = -1;               // buffer owned by us, ready to fill
+    size_t queued_ = 0;
+    bool streaming_ = false;
+
+    std::unique_ptr<stream::FrameBusReader> bus_; // bus thread only once running
+    std::string bus_socket_;
+    std::thread bus_thread_;
+    std::atomic<bool> bus_running_{false};
+    std::atomic<uint64_t> torn_frames_{0};
+
+    void ReleaseBuffers();
+    void BusLoop();
+    bool ReconnectFrameBus();
+};
@@ -3,12 +3,17 @@
 #include <memory>
 #include <string>
 #include <functional>
+#include "AudioCapture.h"
+#include "Capture.h"
+#include "Config.h"
+#include "EncodePipeline.h"
+#include "EventLoop.h"
+#include "PipelineStats.h"
 
 #ifdef USE_WEBRTC
 #include <thread>
 #include <mutex>
 #include <queue>
-#include "Capture.h"
 #include "Encoder.h"
 #include "SignalingClient.h"
 #include <api/peer_connection_interface.h>
@@ -16,19 +21,27 @@
 #include "api/media_stream_interface.h"
 #include "api/video_track_source_proxy.h"
 #include "api/audio_options.h"
+#include "api/data_channel_interface.h"
 #include "rtc_base/thread.h"
 #include "rtc_base/logging.h"
 #include "FrameVideoSource.h"
+#include "CapturedAudioSource.h"
+#include "StatsCollector.h"
 
 class WebRTCSession : public webrtc::PeerConnectionObserver,
                       public webrtc::CreateSessionDescriptionObserver {
 public:
     using OnOfferCreated = std::function<void(const std::string&)>;
-    using OnIceCandidate = std::function<void(const std::string&)>;
+    using OnIceCandidate = std::function<void(const std::string& candidate, const std::string& mid, int mlineIndex)>;
+    using OnIceGatheringDone = std::function<void()>;
+    using OnInputMessage = std::function<void(const uint8_t*, size_t)>;
+    using OnInputReset = std::function<void()>;
 
     WebRTCSession();
     ~WebRTCSession();
 
+    // Applies STUN server and capture/encode settings; call before Init().
+    void Configure(const stream::StreamConfig& config);
     bool Init();
     void Close();
 
@@ -37,16 +50,32 @@ public:
 
     void CreateOffer();
     void SetRemoteDescription(const std::string& sdp);
-    void AddRemoteIceCandidate(const std::string& candidate);
+    void AddRemoteIceCandidate(const std::string& candidate, const std::string& mid = "0", int mlineIndex = 0);
 
     void SetOnOfferCreated(OnOfferCreated callback);
     void SetOnIceCandidate(OnIceCandidate callback);
-
-    // Connect Capture + Encoder Output
+    void SetOnIceGatheringDone(OnIceGatheringDone callback);
+    // Raw messages from the "input" data channel, on the network thread.
+    void SetOnInputMessage(OnInputMessage callback);
+    // A new input data channel was attached, e.g. a viewer reconnected;
+    // its messages start a new sequence.
+    void SetOnInputReset(OnInputReset callback);
+
+    // Connect Capture + Encoder Output. Tracks are attached when the peer
+    // connection is created, on the first CreateOffer() or remote
+    // description/candidate.
     void AddVideoSource(rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> source) override;
     void AddAudioSource(rtc::scoped_refptr<webrtc::AudioSourceInterface> source);
 
     void PushEncodedFrame(const EncodedFrame& frame);
+    // 10 ms of 48 kHz PCM for the audio track; WebRTC encodes it as Opus.
+    void PushAudioFrame(const AudioFrame& frame);
+
+    // Cursor overlay: positions go out unreliable/unordered, shapes reliable.
+    void SendCursorUpdate(const CursorData& cursor);
+
+    // Latest merged getStats() + pipeline counters, refreshed every second.
+    const stream::StatsPublisher& Stats() const { return stats_publisher_; }
 
 private:
     rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> peer_connection_factory_;
@@ -54,6 +83,15 @@ private:
 
     rtc::scoped_refptr<webrtc::AudioTrackInterface> audio_track_;
     rtc::scoped_refptr<webrtc::VideoTrackInterface> video_track_;
+    rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> video_track_source_;
+    rtc::scoped_refptr<webrtc::AudioSourceInterface> audio_track_source_;
+    std::mutex factory_mutex_; // guards lazy factory/peer connection setup
+
+    std::mutex cursor_mutex_; // guards the two channels below
+    rtc::scoped_refptr<webrtc::DataChannelInterface> cursor_channel_;
+    rtc::scoped_refptr<webrtc::DataChannelInterface> cursor_shape_channel_;
+    std::vector<uint8_t> cursor_shape_payload_; // cursor thread only
+    uint32_t last_cursor_shape_serial_ = 0;
 
     rtc::Thread* signaling_thread_;
     rtc::Thread* worker_thread_;
@@ -62,6 +100,20 @@ private:
     std::mutex mutex_;
     OnOfferCreated on_offer_created_;
     OnIceCandidate on_ice_candidate_;
+    OnIceGatheringDone on_ice_gathering_done_;
+    OnInputMessage on_input_message_;
+    OnInputReset on_input_reset_;
+
+    class InputChannelObserver : public webrtc::DataChannelObserver {
+    public:
+        explicit InputChannelObserver(WebRTCSession* session) : session_(session) {}
+        void OnStateChange() override {}
+        void OnMessage(const webrtc::DataBuffer& buffer) override;
+    private:
+        WebRTCSession* session_;
+    };
+    InputChannelObserver input_observer_{this};
+    rtc::scoped_refptr<webrtc::DataChannelInterface> input_channel_;
 
     // PeerConnectionObserver
     void OnSignalingChange(webrtc::PeerConnectionInterface::SignalingState new_state) override;
@@ -75,11 +127,21 @@ private:
     void OnSuccess(webrtc::SessionDescriptionInterface* desc) override;
     void OnFailure(webrtc::RTCError error) override;
 
+    // Creates the factory and peer connection on first use.
+    bool EnsurePeerConnection();
+    void StartStats();
     bool CreatePeerConnection();
+    void AttachVideoTrack();
+    void AttachAudioTrack();
+    void CreateCursorChannels();
+    void AttachInputChannel(rtc::scoped_refptr<webrtc::DataChannelInterface> channel);
 
+    stream::StreamConfig config_;
     std::unique_ptr<Capture> capture_;
     std::unique_ptr<Encoder> encoder_;
+    stream::EventLoop loop_; // signaling dispatch; outlives signaling_
     std::unique_ptr<SignalingClient> signaling_;
+    stream::EncodePipeline encode_pipeline_; // capture thread and encoder
     
     std::atomic<bool> running_;
     std::thread processingThread_;
@@ -89,6 +151,11 @@ private:
     void OnEncodedFrame(const EncodedFrame& frame);
 
     rtc::scoped_refptr<FrameVideoSource> video_source_;
+    rtc::scoped_refptr<CapturedAudioSource> audio_source_;
+    std::unique_ptr<AudioCapture> audio_capture_;
+
+    stream::StatsPublisher stats_publisher_;
+    std::unique_ptr<StatsCollector> stats_collector_;
 
 };
 #else
@@ -97,10 +164,17 @@ class WebRTCSession {
 public:
     WebRTCSession() {}
     ~WebRTCSession() {}
+    void Configure(const stream::StreamConfig&) {}
     bool Init() { return false; }
     void Close() {}
     bool Start(const std::string&, const std::string&) { return false; }
     void Stop() {}
+    void SendCursorUpdate(const CursorData&) {}
+    void PushAudioFrame(const AudioFrame&) {}
+    void SetOnInputMessage(std::function<void(const uint8_t*, size_t)>) {}
+    const stream::StatsPublisher& Stats() const { return stats_publisher_; }
+private:
+    stream::StatsPublisher stats_publisher_;
 };
 #endif
 
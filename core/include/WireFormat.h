@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+// Little-endian helpers shared by the data channel protocols and file formats.
+namespace stream::wire {
+
+inline void putLE16(uint8_t* p, uint16_t v) {
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+}
+
+inline void putLE32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+}
+
+inline void putLE64(uint8_t* p, uint64_t v) {
+    putLE32(p, uint32_t(v));
+    putLE32(p + 4, uint32_t(v >> 32));
+}
+
+inline uint16_t getLE16(const uint8_t* p) {
+    return uint16_t(p[0] | (p[1] << 8));
+}
+
+inline uint32_t getLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t getLE64(const uint8_t* p) {
+    return uint64_t(getLE32(p)) | (uint64_t(getLE32(p + 4)) << 32);
+}
+
+} // namespace stream::wire
@@ -0,0 +1,298 @@
+#include "../include/AudioFile.h"
+#include "../include/Logger.h"
+#include "../include/WireFormat.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace stream {
+namespace {
+
+using wire::getLE16;
+using wire::getLE32;
+using wire::getLE64;
+using wire::putLE16;
+using wire::putLE32;
+using wire::putLE64;
+
+constexpr uint32_t kDs64Body = 28; // riff size, data size, sample count, table length
+constexpr uint64_t kRiffLimit = std::numeric_limits<uint32_t>::max();
+
+// Wave64 chunk GUIDs as stored on disk.
+constexpr uint8_t kW64Riff[16] = {'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11,
+                                  0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00};
+constexpr uint8_t kW64Wave[16] = {'w', 'a', 'v', 'e', 0xF3, 0xAC, 0xD3, 0x11,
+                                  0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A};
+constexpr uint8_t kW64Fmt[16] = {'f', 'm', 't', ' ', 0xF3, 0xAC, 0xD3, 0x11,
+                                 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A};
+constexpr uint8_t kW64Data[16] = {'d', 'a', 't', 'a', 0xF3, 0xAC, 0xD3, 0x11,
+                                  0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A};
+
+// 16-byte PCM "fmt " body.
+void encodeFmt(uint8_t* p, const AudioFormat& f) {
+    putLE16(p, 1); // WAVE_FORMAT_PCM
+    putLE16(p + 2, f.channels);
+    putLE32(p + 4, f.sampleRate);
+    putLE32(p + 8, f.sampleRate * f.bytesPerFrame());
+    putLE16(p + 12, uint16_t(f.bytesPerFrame()));
+    putLE16(p + 14, f.bitsPerSample);
+}
+
+} // namespace
+
+bool AudioFileWriter::open(const std::string& path, const AudioFormat& format, AudioContainer container) {
+    close();
+    if (format.bitsPerSample != 16 || format.channels == 0 || format.sampleRate == 0) {
+        log_error("Audio file: only 16-bit PCM is supported");
+        return false;
+    }
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        log_error("Audio file: cannot create " + path);
+        return false;
+    }
+    format_ = format;
+    container_ = container;
+    dataBytes_ = 0;
+    if (container == AudioContainer::W64)
+        writeW64Header();
+    else
+        writeRiffHeader(container == AudioContainer::RF64);
+    return bool(file_);
+}
+
+void AudioFileWriter::writeRiffHeader(bool rf64) {
+    uint8_t h[12 + 8 + kDs64Body + 8 + 16 + 8] = {};
+    uint8_t* p = h;
+    memcpy(p, rf64 ? "RF64" : "RIFF", 4);
+    putLE32(p + 4, rf64 ? uint32_t(kRiffLimit) : 0);
+    memcpy(p + 8, "WAVE", 4);
+    p += 12;
+    // Reserved for ds64 so a plain WAV can become RF64 in place.
+    ds64Offset_ = uint64_t(p - h);
+    memcpy(p, rf64 ? "ds64" : "JUNK", 4);
+    putLE32(p + 4, kDs64Body);
+    p += 8 + kDs64Body;
+    memcpy(p, "fmt ", 4);
+    putLE32(p + 4, 16);
+    encodeFmt(p + 8, format_);
+    p += 8 + 16;
+    memcpy(p, "data", 4);
+    putLE32(p + 4, rf64 ? uint32_t(kRiffLimit) : 0);
+    dataSizeOffset_ = uint64_t(p - h) + 4;
+    file_.write(reinterpret_cast<const char*>(h), sizeof(h));
+}
+
+void AudioFileWriter::writeW64Header() {
+    uint8_t h[40 + 24 + 16 + 24] = {};
+    memcpy(h, kW64Riff, 16);
+    memcpy(h + 24, kW64Wave, 16);
+    memcpy(h + 40, kW64Fmt, 16);
+    putLE64(h + 56, 24 + 16);
+    encodeFmt(h + 64, format_);
+    memcpy(h + 80, kW64Data, 16);
+    dataSizeOffset_ = 96;
+    file_.write(reinterpret_cast<const char*>(h), sizeof(h));
+}
+
+bool AudioFileWriter::write(const int16_t* samples, size_t frames) {
+    if (!file_.is_open())
+        return false;
+    size_t bytes = frames * format_.bytesPerFrame();
+    file_.write(reinterpret_cast<const char*>(samples), std::streamsize(bytes));
+    dataBytes_ += bytes;
+    return bool(file_);
+}
+
+bool AudioFileWriter::close() {
+    if (!file_.is_open())
+        return true;
+    if (container_ == AudioContainer::W64)
+        finalizeW64();
+    else
+        finalizeRiff();
+    file_.close();
+    return !file_.fail();
+}
+
+void AudioFileWriter::finalizeRiff() {
+    uint64_t fileBytes = uint64_t(file_.tellp());
+    bool rf64 = container_ == AudioContainer::RF64 || fileBytes - 8 > kRiffLimit;
+    uint8_t b[8];
+    file_.seekp(0);
+    if (rf64) {
+        file_.write("RF64", 4);
+        putLE32(b, uint32_t(kRiffLimit));
+        file_.write(reinterpret_cast<const char*>(b), 4);
+        uint8_t ds64[8 + kDs64Body] = {};
+        memcpy(ds64, "ds64", 4);
+        putLE32(ds64 + 4, kDs64Body);
+        putLE64(ds64 + 8, fileBytes - 8);
+        putLE64(ds64 + 16, dataBytes_);
+        putLE64(ds64 + 24, frames());
+        file_.seekp(std::streamoff(ds64Offset_));
+        file_.write(reinterpret_cast<const char*>(ds64), sizeof(ds64));
+        putLE32(b, uint32_t(kRiffLimit));
+    } else {
+        file_.write("RIFF", 4);
+        putLE32(b, uint32_t(fileBytes - 8));
+        file_.write(reinterpret_cast<const char*>(b), 4);
+        putLE32(b, uint32_t(dataBytes_));
+    }
+    file_.seekp(std::streamoff(dataSizeOffset_));
+    file_.write(reinterpret_cast<const char*>(b), 4);
+}
+
+void AudioFileWriter::finalizeW64() {
+    uint64_t fileBytes = uint64_t(file_.tellp());
+    uint8_t b[8];
+    putLE64(b, fileBytes);
+    file_.seekp(16);
+    file_.write(reinterpret_cast<const char*>(b), 8);
+    putLE64(b, 24 + dataBytes_);
+    file_.seekp(std::streamoff(dataSizeOffset_));
+    file_.write(reinterpret_cast<const char*>(b), 8);
+}
+
+bool AudioFileReader::open(const std::string& path) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st {};
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0) ::close(fd);
+        log_error("Audio file: cannot open " + path);
+        return false;
+    }
+    mapBytes_ = size_t(st.st_size);
+    void* mem = mapBytes_ ? mmap(nullptr, mapBytes_, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        mapBytes_ = 0;
+        log_error("Audio file: cannot map " + path);
+        return false;
+    }
+    // Playback walks the file front to back.
+    madvise(mem, mapBytes_, MADV_SEQUENTIAL);
+    map_ = static_cast<const uint8_t*>(mem);
+#else
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        log_error("Audio file: cannot open " + path);
+        return false;
+    }
+    owned_.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    map_ = reinterpret_cast<const uint8_t*>(owned_.data());
+    mapBytes_ = owned_.size();
+#endif
+    bool ok = false;
+    if (mapBytes_ >= 12 && (!memcmp(map_, "RIFF", 4) || !memcmp(map_, "RF64", 4)) && !memcmp(map_ + 8, "WAVE", 4))
+        ok = parseRiff(!memcmp(map_, "RF64", 4));
+    else if (mapBytes_ >= 40 && !memcmp(map_, kW64Riff, 16) && !memcmp(map_ + 24, kW64Wave, 16))
+        ok = parseW64();
+    if (!ok) {
+        log_error("Audio file: " + path + " is not a 16-bit PCM WAV/RF64/W64 file");
+        close();
+    }
+    return ok;
+}
+
+void AudioFileReader::close() {
+#ifndef _WIN32
+    if (map_) munmap(const_cast<uint8_t*>(map_), mapBytes_);
+#endif
+    owned_.clear();
+    map_ = nullptr;
+    mapBytes_ = 0;
+    data_ = nullptr;
+    totalFrames_ = 0;
+    position_ = 0;
+}
+
+bool AudioFileReader::parseFmt(const uint8_t* p, uint64_t size) {
+    if (size < 16)
+        return false;
+    uint16_t tag = getLE16(p);
+    // WAVE_FORMAT_EXTENSIBLE keeps the real tag at the start of the GUID.
+    if (tag == 0xFFFE && size >= 40)
+        tag = getLE16(p + 24);
+    format_.channels = getLE16(p + 2);
+    format_.sampleRate = getLE32(p + 4);
+    format_.bitsPerSample = getLE16(p + 14);
+    return tag == 1 && format_.bitsPerSample == 16 && format_.channels > 0;
+}
+
+bool AudioFileReader::parseRiff(bool rf64) {
+    container_ = rf64 ? AudioContainer::RF64 : AudioContainer::Wav;
+    uint64_t ds64DataSize = 0;
+    bool haveFmt = false;
+    for (size_t off = 12; off + 8 <= mapBytes_;) {
+        const uint8_t* chunk = map_ + off;
+        uint64_t size = getLE32(chunk + 4);
+        const uint8_t* body = chunk + 8;
+        if (!memcmp(chunk, "ds64", 4) && size >= 16) {
+            ds64DataSize = getLE64(body + 8);
+        } else if (!memcmp(chunk, "fmt ", 4)) {
+            if (!parseFmt(body, size)) return false;
+            haveFmt = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!haveFmt) return false;
+            if (rf64 && size == kRiffLimit) size = ds64DataSize;
+            // An unfinalized recording has a zero size; use what's there.
+            size_t available = mapBytes_ - (off + 8);
+            if (size == 0 || size > available) size = available;
+            data_ = body;
+            totalFrames_ = size / format_.bytesPerFrame();
+            return true;
+        }
+        off += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+bool AudioFileReader::parseW64() {
+    container_ = AudioContainer::W64;
+    bool haveFmt = false;
+    for (size_t off = 40; off + 24 <= mapBytes_;) {
+        const uint8_t* chunk = map_ + off;
+        uint64_t size = getLE64(chunk + 16); // includes the 24-byte header
+        if (size < 24) return false;
+        if (!memcmp(chunk, kW64Fmt, 16)) {
+            if (!parseFmt(chunk + 24, size - 24)) return false;
+            haveFmt = true;
+        } else if (!memcmp(chunk, kW64Data, 16)) {
+            if (!haveFmt) return false;
+            size_t available = mapBytes_ - (off + 24);
+            uint64_t bytes = size - 24 > available ? available : size - 24;
+            data_ = chunk + 24;
+            totalFrames_ = bytes / format_.bytesPerFrame();
+            return true;
+        }
+        off += (size + 7) & ~uint64_t(7);
+    }
+    return false;
+}
+
+bool AudioFileReader::seek(uint64_t frame) {
+    if (!data_ || frame > totalFrames_)
+        return false;
+    position_ = frame;
+    return true;
+}
+
+size_t AudioFileReader::read(const int16_t*& data, size_t frames) {
+    if (!data_ || position_ >= totalFrames_)
+        return 0;
+    uint64_t n = std::min<uint64_t>(frames, totalFrames_ - position_);
+    data = reinterpret_cast<const int16_t*>(data_ + position_ * format_.bytesPerFrame());
+    position_ += n;
+    return size_t(n);
+}
+
+}
@@ -0,0 +1,85 @@
+#include "../include/Capabilities.h"
+#include "../include/Config.h"
+
+namespace stream {
+
+void CapabilityProbes::add(const std::string& name, Probe probe) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : entries_) {
+        if (entry->name == name) {
+            if (!entry->future.valid()) entry->probe = std::move(probe);
+            return;
+        }
+    }
+    entries_.push_back(std::make_unique<Entry>(Entry{name, std::move(probe), {}}));
+}
+
+void CapabilityProbes::startLocked(Entry& entry) {
+    if (entry.future.valid()) return;
+    entry.future = std::async(std::launch::async, [name = entry.name, probe = entry.probe] {
+        ProbeResult result;
+        result.name = name;
+        auto t0 = std::chrono::steady_clock::now();
+        result.available = probe(result.detail);
+        result.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0);
+        return result;
+    }).share();
+}
+
+void CapabilityProbes::run() {
+    std::vector<std::shared_future<ProbeResult>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : entries_) {
+            startLocked(*entry);
+            pending.push_back(entry->future);
+        }
+    }
+    for (auto& future : pending) future.wait();
+}
+
+ProbeResult CapabilityProbes::result(const std::string& name) {
+    std::shared_future<ProbeResult> future;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : entries_) {
+            if (entry->name == name) {
+                startLocked(*entry);
+                future = entry->future;
+                break;
+            }
+        }
+    }
+    if (!future.valid()) {
+        ProbeResult unknown;
+        unknown.name = name;
+        unknown.detail = "no such probe";
+        return unknown;
+    }
+    return future.get();
+}
+
+std::vector<ProbeResult> CapabilityProbes::results() {
+    run();
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ProbeResult> out;
+    for (auto& entry : entries_) out.push_back(entry->future.get());
+    return out;
+}
+
+CapabilityProbes& capabilities() {
+    static CapabilityProbes probes;
+    return probes;
+}
+
+#ifndef __linux__
+// Other platforms have no cheap probes yet; their backends report failures
+// when started.
+void addPlatformProbes(CapabilityProbes& probes, const StreamConfig& config) {
+    (void)probes;
+    (void)config;
+}
+#endif
+
+}
@@ -0,0 +1,254 @@
+#include "../include/ChangeDetector.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STREAM_HASH_SSE2 1
+#endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define STREAM_HASH_AVX2 1
+#endif
+
+namespace stream {
+
+namespace {
+
+// XXH3-style accumulation over eight 64-bit lanes: each lane adds its
+// neighbour's input word and the 32x32-bit product of its own keyed word.
+// Keys differ for each of the four 64-byte blocks of a tile row, so moving
+// pixels around within the row changes the hash. The SIMD paths compute
+// exactly what the scalar one does.
+constexpr int kKeyWords = 32;
+
+constexpr uint64_t splitmix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+struct Keys {
+    alignas(32) uint64_t words[kKeyWords];
+    constexpr Keys() : words() {
+        for (int i = 0; i < kKeyWords; ++i) words[i] = splitmix(uint64_t(i));
+    }
+};
+constexpr Keys kKeys;
+constexpr uint64_t kPrime = 0x9e3779b185ebca87ull;
+
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline const uint64_t* blockKeys(size_t block) { return kKeys.words + (block * 8) % kKeyWords; }
+
+// The lanes are weighted by distinct odd keys and summed: independent
+// multiplies, so folding doesn't serialise the short per-tile spans.
+inline uint64_t finish(const uint64_t acc[8], const uint8_t* tail, size_t tailBytes) {
+    uint64_t h = 0;
+    for (int i = 0; i < 8; ++i) h += acc[i] * (kKeys.words[i] | 1);
+    // Pixels are four bytes, so the tail is whole pixels.
+    for (size_t i = 0; i + 4 <= tailBytes; i += 4) {
+        uint32_t v;
+        memcpy(&v, tail + i, sizeof(v));
+        h = (h ^ v) * kPrime;
+    }
+    return h ^ (h >> 29);
+}
+
+// Each variant hashes a whole row of tiles per call, so nothing but the
+// per-tile fold stands between consecutive 256-byte spans. The scalar one
+// is always built: it is the fallback and the reference the others are
+// tested against.
+inline void accumulateScalar(uint64_t acc[8], const uint8_t* p, size_t blocks) {
+    for (size_t b = 0; b < blocks; ++b) {
+        const uint8_t* in = p + b * 64;
+        const uint64_t* key = blockKeys(b);
+        for (int i = 0; i < 8; ++i) {
+            uint64_t dk = load64(in + i * 8) ^ key[i];
+            acc[i] += load64(in + (i ^ 1) * 8);
+            acc[i] += (dk & 0xffffffffu) * (dk >> 32);
+        }
+    }
+}
+
+#ifdef STREAM_HASH_SSE2
+inline void accumulateSse2(uint64_t acc[8], const uint8_t* p, size_t blocks) {
+    __m128i a[4];
+    for (int i = 0; i < 4; ++i) a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+    for (size_t b = 0; b < blocks; ++b) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(p + b * 64);
+        const __m128i* key = reinterpret_cast<const __m128i*>(blockKeys(b));
+        for (int i = 0; i < 4; ++i) {
+            __m128i d = _mm_loadu_si128(in + i);
+            __m128i dk = _mm_xor_si128(d, _mm_load_si128(key + i));
+            __m128i product = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+            a[i] = _mm_add_epi64(a[i], _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+            a[i] = _mm_add_epi64(a[i], product);
+        }
+    }
+    for (int i = 0; i < 4; ++i) _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, a[i]);
+}
+#endif
+
+#ifdef STREAM_HASH_AVX2
+__attribute__((target("avx2"))) inline void accumulateAvx2(uint64_t acc[8], const uint8_t* p, size_t blocks) {
+    __m256i a[2];
+    for (int i = 0; i < 2; ++i) a[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + i);
+    for (size_t b = 0; b < blocks; ++b) {
+        const __m256i* in = reinterpret_cast<const __m256i*>(p + b * 64);
+        const __m256i* key = reinterpret_cast<const __m256i*>(blockKeys(b));
+        for (int i = 0; i < 2; ++i) {
+            __m256i d = _mm256_loadu_si256(in + i);
+            __m256i dk = _mm256_xor_si256(d, _mm256_load_si256(key + i));
+            __m256i product = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+            a[i] = _mm256_add_epi64(a[i], _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+            a[i] = _mm256_add_epi64(a[i], product);
+        }
+    }
+    for (int i = 0; i < 2; ++i) _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, a[i]);
+}
+#endif
+
+constexpr size_t kTileBytes = TileChangeDetector::kTileSize * 4;
+
+#define STREAM_ROW_HASHES(accumulateFn)                                              \
+    for (size_t x = 0, t = 0; x < bytes; x += kTileBytes, ++t) {                     \
+        size_t n = std::min(kTileBytes, bytes - x);                                  \
+        uint64_t acc[8];                                                             \
+        for (int i = 0; i < 8; ++i) acc[i] = kKeys.words[i];                         \
+        accumulateFn(acc, row + x, n / 64);                                          \
+        out[t] = finish(acc, row + x + n / 64 * 64, n % 64);                         \
+    }
+
+#ifdef STREAM_HASH_AVX2
+__attribute__((target("avx2"))) void rowHashesAvx2(const uint8_t* row, size_t bytes, uint64_t* out) {
+    STREAM_ROW_HASHES(accumulateAvx2)
+}
+#endif
+#ifdef STREAM_HASH_SSE2
+void rowHashesSse2(const uint8_t* row, size_t bytes, uint64_t* out) { STREAM_ROW_HASHES(accumulateSse2) }
+#endif
+void rowHashesScalar(const uint8_t* row, size_t bytes, uint64_t* out) { STREAM_ROW_HASHES(accumulateScalar) }
+
+using RowHashes = void (*)(const uint8_t*, size_t, uint64_t*);
+
+RowHashes pickRowHashes() {
+#ifdef STREAM_HASH_AVX2
+    if (__builtin_cpu_supports("avx2")) return rowHashesAvx2;
+#endif
+#ifdef STREAM_HASH_SSE2
+    return rowHashesSse2;
+#else
+    return rowHashesScalar;
+#endif
+}
+
+const RowHashes rowHashes = pickRowHashes();
+
+RowHashes rowHashesFor(TileChangeDetector::HashImpl impl) {
+    switch (impl) {
+    case TileChangeDetector::HashImpl::Scalar: return rowHashesScalar;
+    case TileChangeDetector::HashImpl::Sse2:
+#ifdef STREAM_HASH_SSE2
+        return rowHashesSse2;
+#else
+        return nullptr;
+#endif
+    case TileChangeDetector::HashImpl::Avx2:
+#ifdef STREAM_HASH_AVX2
+        if (__builtin_cpu_supports("avx2")) return rowHashesAvx2;
+#endif
+        return nullptr;
+    }
+    return nullptr;
+}
+
+}
+
+bool TileChangeDetector::hashRowWith(HashImpl impl, const uint8_t* row, size_t bytes, uint64_t* out) {
+    RowHashes fn = rowHashesFor(impl);
+    if (!fn) return false;
+    fn(row, bytes, out);
+    return true;
+}
+
+void TileChangeDetector::hashRow(const uint8_t* row, size_t bytes, uint64_t* out) {
+    rowHashes(row, bytes, out);
+}
+
+uint64_t TileChangeDetector::hashSpan(const uint8_t* p, size_t bytes) {
+    uint64_t h = 0;
+    rowHashes(p, std::min(bytes, kTileBytes), &h);
+    return h;
+}
+
+TileChangeDetector::TileChangeDetector(const Options& options)
+    : rowStride_(std::clamp(options.rowStride, 1, kTileSize)) {}
+
+void TileChangeDetector::hashTile(const FrameData& frame, int tx, int ty) {
+    int x = tx * kTileSize;
+    size_t bytes = size_t(std::min(kTileSize, frame.width - x)) * 4;
+    int yEnd = std::min(frame.height, (ty + 1) * kTileSize);
+    for (int y = ty * kTileSize; y < yEnd; ++y)
+        hashRow(frame.data + size_t(y) * frame.stride + size_t(x) * 4, bytes, &hashes_[size_t(y) * columns_ + tx]);
+}
+
+size_t TileChangeDetector::process(FrameData& frame) {
+    if (!frame.data || frame.width <= 0 || frame.height <= 0) return 0;
+
+    bool fresh = hashes_.empty() || frame.width != width_ || frame.height != height_ ||
+                 frame.generation != generation_;
+    if (fresh) {
+        width_ = frame.width;
+        height_ = frame.height;
+        generation_ = frame.generation;
+        columns_ = (width_ + kTileSize - 1) / kTileSize;
+        rows_ = (height_ + kTileSize - 1) / kTileSize;
+        hashes_.assign(size_t(height_) * columns_, 0);
+        bitmap_.assign((size_t(columns_) * rows_ + 63) / 64, 0);
+        phase_ = 0;
+    } else {
+        std::fill(bitmap_.begin(), bitmap_.end(), 0);
+    }
+
+    size_t dirty = 0;
+    auto mark = [&](size_t tile) {
+        bitmap_[tile / 64] |= uint64_t(1) << (tile % 64);
+        ++dirty;
+    };
+    auto isDirty = [&](size_t tile) { return (bitmap_[tile / 64] >> (tile % 64)) & 1; };
+
+    if (fresh) {
+        for (int y = 0; y < height_; ++y)
+            hashRow(frame.data + size_t(y) * frame.stride, size_t(width_) * 4, &hashes_[size_t(y) * columns_]);
+        for (size_t tile = 0; tile < size_t(columns_) * rows_; ++tile) mark(tile);
+    } else {
+        row_.resize(columns_);
+        for (int y = phase_; y < height_; y += rowStride_) {
+            hashRow(frame.data + size_t(y) * frame.stride, size_t(width_) * 4, row_.data());
+            size_t tileBase = size_t(y / kTileSize) * columns_;
+            const uint64_t* stored = &hashes_[size_t(y) * columns_];
+            for (int tx = 0; tx < columns_; ++tx) {
+                if (row_[tx] != stored[tx] && !isDirty(tileBase + tx)) mark(tileBase + tx);
+            }
+        }
+        // Bring every row of a dirty tile up to date, so rows that weren't
+        // sampled this time don't flag the tile again later.
+        for (size_t tile = 0; dirty && tile < size_t(columns_) * rows_; ++tile) {
+            if (isDirty(tile)) hashTile(frame, int(tile % columns_), int(tile / columns_));
+        }
+        phase_ = (phase_ + 1) % rowStride_;
+    }
+
+    frame.dirtyTiles = bitmap_.data();
+    frame.tileColumns = columns_;
+    frame.tileRows = rows_;
+    frame.dirtyTileCount = dirty;
+    return dirty;
+}
+
+}
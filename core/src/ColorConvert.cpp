@@ -38,3 +38,51 @@ void ConvertBGRAtoI420(const uint8_t* src, int width, int height,
         }
     }
 }
+
+static inline uint8_t LumaOf(const uint8_t* p) {
+    return (uint8_t)(((66 * p[2] + 129 * p[1] + 25 * p[0] + 128) >> 8) + 16);
+}
+
+// Chroma of the average of `n` pixels whose B, G, R sums are given.
+static inline void ChromaOf(int b, int g, int r, int n, uint8_t& u, uint8_t& v) {
+    b /= n; g /= n; r /= n;
+    u = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    v = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+void ConvertBGRAtoNV12(const uint8_t* src, int src_stride, int width, int height,
+                       uint8_t* dst_y, int stride_y,
+                       uint8_t* dst_uv, int stride_uv) {
+    for (int y = 0; y < height; y += 2) {
+        const uint8_t* row0 = src + y * src_stride;
+        const uint8_t* row1 = row0 + src_stride;
+        uint8_t* y0 = dst_y + y * stride_y;
+        uint8_t* y1 = y0 + stride_y;
+        uint8_t* uv = dst_uv + (y / 2) * stride_uv;
+        for (int x = 0; x < width; x += 2) {
+            const uint8_t* a = row0 + x * 4;
+            const uint8_t* b = row1 + x * 4;
+            y0[x] = LumaOf(a);
+            y0[x + 1] = LumaOf(a + 4);
+            y1[x] = LumaOf(b);
+            y1[x + 1] = LumaOf(b + 4);
+            ChromaOf(a[0] + a[4] + b[0] + b[4], a[1] + a[5] + b[1] + b[5],
+                     a[2] + a[6] + b[2] + b[6], 4, uv[x], uv[x + 1]);
+        }
+    }
+}
+
+void ConvertBGRAtoYUYV(const uint8_t* src, int src_stride, int width, int height,
+                       uint8_t* dst, int dst_stride) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = src + y * src_stride;
+        uint8_t* out = dst + y * dst_stride;
+        for (int x = 0; x < width; x += 2) {
+            const uint8_t* a = row + x * 4;
+            out[0] = LumaOf(a);
+            out[2] = LumaOf(a + 4);
+            ChromaOf(a[0] + a[4], a[1] + a[5], a[2] + a[6], 2, out[1], out[3]);
+            out += 4;
+        }
+    }
+}
@@ -0,0 +1,327 @@
+#include "../include/Config.h"
+#include "../include/Logger.h"
+#include <fstream>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace stream {
+namespace {
+
+// Small helpers that validate one field each and record a readable error.
+struct Reader {
+    std::vector<std::string>& errors;
+
+    const nlohmann::json* object(const nlohmann::json& parent, const char* key, const std::string& where) {
+        auto it = parent.find(key);
+        if (it == parent.end()) return nullptr;
+        if (!it->is_object()) {
+            errors.push_back(where + key + ": expected an object");
+            return nullptr;
+        }
+        return &*it;
+    }
+
+    void string(const nlohmann::json& parent, const char* key, const std::string& where, std::string& out,
+                std::initializer_list<const char*> prefixes = {}) {
+        auto it = parent.find(key);
+        if (it == parent.end()) return;
+        if (!it->is_string()) {
+            errors.push_back(where + key + ": expected a string");
+            return;
+        }
+        const std::string& value = it->get_ref<const std::string&>();
+        if (prefixes.size()) {
+            bool ok = false;
+            for (const char* p : prefixes) ok = ok || value.rfind(p, 0) == 0;
+            if (!ok) {
+                std::string expected;
+                for (const char* p : prefixes) expected += expected.empty() ? p : std::string(" or ") + p;
+                errors.push_back(where + key + ": must start with " + expected);
+                return;
+            }
+        }
+        out = value;
+    }
+
+    void choice(const nlohmann::json& parent, const char* key, const std::string& where, std::string& out,
+                std::initializer_list<const char*> allowed) {
+        std::string value = out;
+        size_t errorsBefore = errors.size();
+        string(parent, key, where, value);
+        if (errors.size() != errorsBefore) return;
+        std::string expected;
+        for (const char* a : allowed) {
+            if (value == a) {
+                out = value;
+                return;
+            }
+            expected += expected.empty() ? a : std::string(", ") + a;
+        }
+        errors.push_back(where + key + ": expected one of " + expected);
+    }
+
+    void integer(const nlohmann::json& parent, const char* key, const std::string& where, int& out, int min, int max) {
+        auto it = parent.find(key);
+        if (it == parent.end()) return;
+        if (!it->is_number_integer()) {
+            errors.push_back(where + key + ": expected an integer");
+            return;
+        }
+        int64_t v = it->get<int64_t>();
+        if (v < min || v > max) {
+            errors.push_back(where + key + ": " + std::to_string(v) + " out of range [" +
+                             std::to_string(min) + ", " + std::to_string(max) + "]");
+            return;
+        }
+        out = int(v);
+    }
+
+    void boolean(const nlohmann::json& parent, const char* key, const std::string& where, bool& out) {
+        auto it = parent.find(key);
+        if (it == parent.end()) return;
+        if (!it->is_boolean()) {
+            errors.push_back(where + key + ": expected true or false");
+            return;
+        }
+        out = it->get<bool>();
+    }
+
+    void warnUnknown(const nlohmann::json& obj, const std::string& where, std::initializer_list<const char*> known) {
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            bool found = false;
+            for (const char* k : known) found = found || it.key() == k;
+            if (!found) STREAM_LOG_WARN("config: unknown key {}{}", where, it.key());
+        }
+    }
+};
+
+} // namespace
+
+bool parseConfig(const nlohmann::json& j, StreamConfig& out, std::vector<std::string>& errors) {
+    if (!j.is_object()) {
+        errors.push_back("config: expected a JSON object");
+        return false;
+    }
+    size_t errorsBefore = errors.size();
+    Reader r{errors};
+    StreamConfig c = StreamConfig{};
+
+    r.warnUnknown(j, "", {"signaling_url", "stun_server", "log_level", "stats_socket", "frame_bus_socket", "capture",
+                        "audio", "encode", "threads"});
+    r.string(j, "signaling_url", "", c.signalingUrl, {"ws://", "wss://"});
+    r.string(j, "stun_server", "", c.stunServer, {"stun:", "turn:", "turns:"});
+    r.string(j, "log_level", "", c.logLevel);
+    if (parseLogLevel(c.logLevel, LogLevel(0xff)) == LogLevel(0xff))
+        errors.push_back("log_level: expected debug, info, warn, error or off");
+    r.string(j, "stats_socket", "", c.statsSocket);
+    r.string(j, "frame_bus_socket", "", c.frameBusSocket);
+
+    if (const nlohmann::json* cap = r.object(j, "capture", "")) {
+        r.warnUnknown(*cap, "capture.", {"framerate", "resolution", "region", "monitor", "window", "backend",
+                                         "pipewire_node"});
+        r.choice(*cap, "backend", "capture.", c.capture.backend.backend, {"auto", "x11", "pipewire"});
+        int node = int(c.capture.backend.pipewireNode);
+        r.integer(*cap, "pipewire_node", "capture.", node, 0, INT32_MAX);
+        c.capture.backend.pipewireNode = uint32_t(node);
+        r.integer(*cap, "framerate", "capture.", c.capture.framerate, 1, 240);
+        std::string resolution;
+        r.string(*cap, "resolution", "capture.", resolution);
+        if (!resolution.empty()) {
+            int w = 0, h = 0;
+            char tail = 0;
+            if (sscanf(resolution.c_str(), "%dx%d%c", &w, &h, &tail) != 2 || w < 16 || h < 16 || w > 8192 || h > 8192)
+                errors.push_back("capture.resolution: expected WIDTHxHEIGHT, e.g. 1920x1080");
+            else {
+                c.capture.width = w;
+                c.capture.height = h;
+            }
+        }
+        if (const nlohmann::json* region = r.object(*cap, "region", "capture.")) {
+            r.warnUnknown(*region, "capture.region.", {"x", "y", "width", "height"});
+            r.integer(*region, "x", "capture.region.", c.capture.region.x, 0, 65535);
+            r.integer(*region, "y", "capture.region.", c.capture.region.y, 0, 65535);
+            r.integer(*region, "width", "capture.region.", c.capture.region.width, 0, 65535);
+            r.integer(*region, "height", "capture.region.", c.capture.region.height, 0, 65535);
+        }
+        r.string(*cap, "monitor", "capture.", c.capture.monitor);
+        r.integer(*cap, "window", "capture.", c.capture.window, 0, 0x1fffffff); // XIDs are 29 bits
+        if (int(!c.capture.region.empty()) + int(!c.capture.monitor.empty()) + int(c.capture.window != 0) > 1)
+            errors.push_back("capture: region, monitor and window are mutually exclusive");
+    }
+
+    if (const nlohmann::json* audio = r.object(j, "audio", "")) {
+        r.warnUnknown(*audio, "audio.", {"enabled", "device"});
+        r.boolean(*audio, "enabled", "audio.", c.audio.enabled);
+        r.string(*audio, "device", "audio.", c.audio.device);
+    }
+
+    if (const nlohmann::json* enc = r.object(j, "encode", "")) {
+        r.warnUnknown(*enc, "encode.", {"bitrate", "hardware", "vfr"});
+        r.integer(*enc, "bitrate", "encode.", c.encode.bitrate, 100000, 200000000);
+        r.boolean(*enc, "hardware", "encode.", c.encode.hardware);
+        r.boolean(*enc, "vfr", "encode.", c.encode.vfr);
+    }
+
+    if (const nlohmann::json* threads = r.object(j, "threads", "")) {
+        r.warnUnknown(*threads, "threads.", {"capture", "audio", "network", "control"});
+        std::pair<ThreadRole, ThreadPolicy*> policies[] = {{ThreadRole::Capture, &c.threads.capture},
+                                                           {ThreadRole::Audio, &c.threads.audio},
+                                                           {ThreadRole::Network, &c.threads.network},
+                                                           {ThreadRole::Control, &c.threads.control}};
+        for (auto [role, policy] : policies) {
+            std::string where = std::string("threads.") + threadRoleName(role) + ".";
+            const nlohmann::json* t = r.object(*threads, threadRoleName(role), "threads.");
+            if (!t) continue;
+            r.warnUnknown(*t, where, {"cpus", "scheduler", "priority"});
+            std::string cpus;
+            r.string(*t, "cpus", where, cpus);
+            if (!parseCpuList(cpus, policy->cpus))
+                errors.push_back(where + "cpus: expected a CPU list, e.g. \"2-3,6\"");
+            r.choice(*t, "scheduler", where, policy->scheduler, {"other", "fifo", "rr"});
+            r.integer(*t, "priority", where, policy->priority, 0, 99);
+            if (policy->scheduler != "other" && policy->priority == 0)
+                errors.push_back(where + "priority: fifo and rr need a priority of 1-99");
+        }
+    }
+
+    if (errors.size() != errorsBefore) return false;
+    out = std::move(c);
+    return true;
+}
+
+bool loadConfig(const std::string& path, StreamConfig& out, std::vector<std::string>& errors) {
+    std::ifstream f(path);
+    if (!f) {
+        errors.push_back(path + ": cannot open");
+        return false;
+    }
+    nlohmann::json j = nlohmann::json::parse(f, nullptr, false);
+    if (j.is_discarded()) {
+        errors.push_back(path + ": invalid JSON");
+        return false;
+    }
+    return parseConfig(j, out, errors);
+}
+
+ConfigDiff diffConfig(const StreamConfig& a, const StreamConfig& b) {
+    ConfigDiff d;
+    d.framerate = a.capture.framerate != b.capture.framerate;
+    d.bitrate = a.encode.bitrate != b.encode.bitrate;
+    d.vfr = a.encode.vfr != b.encode.vfr;
+    for (int role = 0; role < kThreadRoleCount; ++role)
+        d.threads = d.threads || !(a.threads.forRole(ThreadRole(role)) == b.threads.forRole(ThreadRole(role)));
+    d.target = !(a.capture.target() == b.capture.target());
+    if (a.signalingUrl != b.signalingUrl) d.restartRequired.push_back("signaling_url");
+    if (a.stunServer != b.stunServer) d.restartRequired.push_back("stun_server");
+    if (a.statsSocket != b.statsSocket) d.restartRequired.push_back("stats_socket");
+    if (a.frameBusSocket != b.frameBusSocket) d.restartRequired.push_back("frame_bus_socket");
+    if (a.capture.width != b.capture.width || a.capture.height != b.capture.height)
+        d.restartRequired.push_back("capture.resolution");
+    if (a.capture.backend.backend != b.capture.backend.backend ||
+        a.capture.backend.pipewireNode != b.capture.backend.pipewireNode)
+        d.restartRequired.push_back("capture.backend");
+    if (a.audio.enabled != b.audio.enabled || a.audio.device != b.audio.device)
+        d.restartRequired.push_back("audio");
+    if (a.encode.hardware != b.encode.hardware) d.restartRequired.push_back("encode.hardware");
+    return d;
+}
+
+ConfigWatcher::ConfigWatcher(std::string path, StreamConfig initial, Callback callback)
+    : path_(std::move(path)), callback_(std::move(callback)), current_(std::move(initial)) {}
+
+ConfigWatcher::~ConfigWatcher() { stop(); }
+
+StreamConfig ConfigWatcher::current() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_;
+}
+
+#ifdef __linux__
+bool ConfigWatcher::start() {
+    std::filesystem::path file = std::filesystem::absolute(path_);
+    inotifyFd_ = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (inotifyFd_ < 0 ||
+        inotify_add_watch(inotifyFd_, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        STREAM_LOG_ERROR("config: cannot watch {}: {}", file.parent_path().string(), strerror(errno));
+        if (inotifyFd_ >= 0) close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+    wakeFd_ = eventfd(0, EFD_CLOEXEC);
+    thread_ = std::thread(&ConfigWatcher::run, this);
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        (void)!write(wakeFd_, &one, sizeof(one));
+        thread_.join();
+    }
+    if (inotifyFd_ >= 0) close(inotifyFd_);
+    if (wakeFd_ >= 0) close(wakeFd_);
+    inotifyFd_ = wakeFd_ = -1;
+}
+
+void ConfigWatcher::run() {
+    ThreadScope scope(ThreadRole::Control, "config-watch");
+    std::string name = std::filesystem::path(path_).filename().string();
+    alignas(inotify_event) char buf[4096];
+    pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) return;
+        bool touched = false;
+        ssize_t n;
+        while ((n = read(inotifyFd_, buf, sizeof(buf))) > 0) {
+            for (char* p = buf; p < buf + n;) {
+                auto* ev = reinterpret_cast<inotify_event*>(p);
+                if (ev->len && name == ev->name) touched = true;
+                p += sizeof(inotify_event) + ev->len;
+            }
+        }
+        if (!touched) continue;
+        // Editors often write in several steps; let them finish.
+        if (poll(&fds[1], 1, 50) > 0) return;
+        while (read(inotifyFd_, buf, sizeof(buf)) > 0) {}
+        reload();
+    }
+}
+
+void ConfigWatcher::reload() {
+    StreamConfig next;
+    std::vector<std::string> errors;
+    if (!loadConfig(path_, next, errors)) {
+        for (const auto& e : errors) STREAM_LOG_ERROR("config reload rejected: {}", e);
+        return;
+    }
+    StreamConfig previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        previous = current_;
+        current_ = next;
+    }
+    STREAM_LOG_INFO("config reloaded from {}", path_);
+    callback_(previous, next);
+}
+#else
+// No inotify: the config is read once at startup.
+bool ConfigWatcher::start() { return false; }
+void ConfigWatcher::stop() {}
+void ConfigWatcher::run() {}
+void ConfigWatcher::reload() {}
+#endif
+
+}
@@ -0,0 +1,91 @@
+#include "../include/EncodePipeline.h"
+#include "../include/Logger.h"
+#include "../include/PipelineStats.h"
+#include <chrono>
+
+namespace stream {
+
+bool EncodePipeline::start(Encoder& encoder, const Settings& settings, Encoder::EncodedCallback onEncoded) {
+    encoder_ = &encoder;
+    onEncoded_ = [onEncoded = std::move(onEncoded)](const EncodedFrame& frame) {
+        auto& counters = pipelineCounters();
+        counters.framesEncoded.fetch_add(1, std::memory_order_relaxed);
+        counters.bytesEncoded.fetch_add(frame.data.size(), std::memory_order_relaxed);
+        if (frame.isKeyFrame) counters.keyFramesEncoded.fetch_add(1, std::memory_order_relaxed);
+        onEncoded(frame);
+    };
+    width_ = settings.width;
+    height_ = settings.height;
+    bitrate_ = appliedBitrate_ = settings.bitrate;
+    framerate_ = appliedFramerate_ = settings.framerate;
+    generation_ = 0;
+    pacer_.setEnabled(settings.vfr);
+    if (!encoder_->Start(settings.width, settings.height, settings.framerate, onEncoded_))
+        return false;
+    encoder_->SetBitrate(settings.bitrate);
+    return true;
+}
+
+void EncodePipeline::applyRates() {
+    int bitrate = bitrate_.load(std::memory_order_relaxed);
+    if (bitrate != appliedBitrate_) {
+        appliedBitrate_ = bitrate;
+        if (!encoder_->SetBitrate(bitrate))
+            STREAM_LOG_ERROR("Encoder cannot change bitrate live; restart to apply");
+    }
+    int framerate = framerate_.load(std::memory_order_relaxed);
+    if (framerate != appliedFramerate_) {
+        appliedFramerate_ = framerate;
+        encoder_->SetFramerate(framerate);
+    }
+}
+
+// The encoder switches in place and emits one keyframe with the new
+// parameter sets, so the track and the peer connection are untouched.
+// Backends that can't are restarted at the current rates.
+void EncodePipeline::resize(int width, int height) {
+    width_ = width;
+    height_ = height;
+    if (encoder_->Reconfigure(width, height)) {
+        STREAM_LOG_INFO("Encoder reconfigured to {}x{}", width, height);
+        return;
+    }
+    STREAM_LOG_INFO("Encoder restarting at {}x{}", width, height);
+    pacer_.forceNext();
+    encoder_->Stop();
+    if (encoder_->Start(width, height, appliedFramerate_, onEncoded_))
+        encoder_->SetBitrate(appliedBitrate_);
+    else
+        STREAM_LOG_ERROR("Encoder failed to restart at {}x{}", width, height);
+}
+
+void EncodePipeline::onFrame(const FrameData& frame) {
+    auto& counters = pipelineCounters();
+    counters.framesCaptured.fetch_add(1, std::memory_order_relaxed);
+    applyRates();
+    if (frame.generation != generation_) {
+        generation_ = frame.generation;
+        if (frame.width != width() || frame.height != height())
+            resize(frame.width, frame.height);
+    }
+
+    // Static frames stop here; see FramePacer for the refresh policy.
+    switch (pacer_.decide(frame)) {
+    case FramePacer::Decision::Drop:
+        counters.framesSkipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    case FramePacer::Decision::Refine:
+        encoder_->RefineNextFrame();
+        encoder_->SetDirtyTiles(nullptr, 0, 0);
+        break;
+    default:
+        encoder_->SetDirtyTiles(frame.dirtyTiles, frame.tileColumns, frame.tileRows);
+        break;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    encoder_->EncodeFrame(frame.data, frame.stride);
+    counters.encodeMicros.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count(), std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,200 @@
+#include "../include/EventLoop.h"
+#include "../include/Logger.h"
+#include <cerrno>
+#include <cstring>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace stream {
+
+EventLoop::EventLoop() {
+#ifdef __linux__
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeFd_;
+    if (epollFd_ < 0 || wakeFd_ < 0 || epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev) < 0)
+        STREAM_LOG_ERROR("event loop: cannot set up epoll: {}", strerror(errno));
+#endif
+}
+
+EventLoop::~EventLoop() {
+#ifdef __linux__
+    if (wakeFd_ >= 0) close(wakeFd_);
+    if (epollFd_ >= 0) close(epollFd_);
+#endif
+}
+
+void EventLoop::wake() {
+#ifdef __linux__
+    uint64_t one = 1;
+    (void)!write(wakeFd_, &one, sizeof(one));
+#else
+    cv_.notify_one();
+#endif
+}
+
+void EventLoop::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake();
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    wake();
+}
+
+EventLoop::TimerId EventLoop::addTimer(std::chrono::milliseconds delay, Task task,
+                                       std::chrono::milliseconds interval) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = nextTimer_++;
+        timers_[id] = {Clock::now() + delay, interval, std::make_shared<Task>(std::move(task))};
+    }
+    wake(); // the loop may be sleeping past the new deadline
+    return id;
+}
+
+void EventLoop::cancelTimer(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timers_.erase(id);
+}
+
+std::chrono::milliseconds EventLoop::nextTimeoutLocked(Clock::time_point now) const {
+    if (timers_.empty()) return std::chrono::milliseconds(-1);
+    Clock::time_point due = Clock::time_point::max();
+    for (const auto& [id, timer] : timers_) due = std::min(due, timer.due);
+    if (due <= now) return std::chrono::milliseconds(0);
+    // Rounded up, so the loop never wakes just before a deadline.
+    return std::chrono::ceil<std::chrono::milliseconds>(due - now);
+}
+
+// Posted tasks first, then timers that are due, each outside the lock so
+// handlers may post, add timers or stop the loop.
+void EventLoop::runDue() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks.swap(tasks_);
+    }
+    for (Task& task : tasks) task();
+
+    for (;;) {
+        std::shared_ptr<Task> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Clock::time_point now = Clock::now();
+            for (auto it = timers_.begin(); it != timers_.end(); ++it) {
+                if (it->second.due > now) continue;
+                task = it->second.task;
+                if (it->second.interval.count() > 0)
+                    it->second.due = std::max(it->second.due + it->second.interval, now);
+                else
+                    timers_.erase(it);
+                break;
+            }
+        }
+        if (!task) return;
+        (*task)();
+    }
+}
+
+#ifdef __linux__
+
+bool EventLoop::watch(int fd, Task onReadable) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    bool known = watches_.count(fd) != 0;
+    if (epoll_ctl(epollFd_, known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0) {
+        STREAM_LOG_ERROR("event loop: cannot watch fd {}: {}", fd, strerror(errno));
+        return false;
+    }
+    watches_[fd] = std::make_shared<Task>(std::move(onReadable));
+    return true;
+}
+
+void EventLoop::unwatch(int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (watches_.erase(fd)) epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EventLoop::run() {
+    epoll_event events[16];
+    for (;;) {
+        int timeout;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_) break;
+            // Tasks posted before run() set the eventfd, so they are seen.
+            timeout = int(nextTimeoutLocked(Clock::now()).count());
+        }
+        int n = epoll_wait(epollFd_, events, 16, timeout);
+        if (n < 0 && errno != EINTR) {
+            STREAM_LOG_ERROR("event loop: epoll_wait: {}", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd_) {
+                uint64_t count;
+                (void)!read(wakeFd_, &count, sizeof(count));
+                continue;
+            }
+            std::shared_ptr<Task> handler;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = watches_.find(fd);
+                if (it != watches_.end()) handler = it->second; // unwatched by an earlier handler otherwise
+            }
+            if (handler) (*handler)();
+        }
+        runDue();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = false;
+    tasks_.clear();
+}
+
+#else
+
+bool EventLoop::watch(int, Task) { return false; }
+
+void EventLoop::unwatch(int) {}
+
+void EventLoop::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        // Checked under the lock, so a post() or addTimer() racing with the
+        // previous round is either seen here or notifies the wait.
+        if (tasks_.empty()) {
+            std::chrono::milliseconds timeout = nextTimeoutLocked(Clock::now());
+            if (timeout.count() < 0)
+                cv_.wait(lock);
+            else
+                cv_.wait_for(lock, timeout);
+        }
+        if (stop_) break;
+        lock.unlock();
+        runDue();
+        lock.lock();
+    }
+    stop_ = false;
+    tasks_.clear();
+}
+
+#endif
+
+}
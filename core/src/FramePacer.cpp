@@ -0,0 +1,41 @@
+#include "../include/FramePacer.h"
+
+namespace stream {
+
+FramePacer::Decision FramePacer::sent(Decision decision, uint64_t timestamp) {
+    lastSent_ = timestamp;
+    switch (decision) {
+    case Decision::Encode: ++stats_.encoded; break;
+    case Decision::Refine: ++stats_.refined; break;
+    case Decision::Refresh: ++stats_.refreshed; break;
+    case Decision::Drop: break;
+    }
+    return decision;
+}
+
+FramePacer::Decision FramePacer::decide(const FrameData& frame) {
+    bool changed = !frame.dirtyTiles || frame.dirtyTileCount > 0;
+    if (!enabled_.load(std::memory_order_relaxed) || changed || force_) {
+        force_ = false;
+        if (changed) ++burst_;
+        refinesLeft_ = 0;
+        return sent(Decision::Encode, frame.timestamp);
+    }
+    if (burst_) {
+        refinesLeft_ = burst_ >= options_.refineAfterFrames ? options_.refineFrames : 0;
+        burst_ = 0;
+    }
+
+    // Timestamps that go backwards (a backend restart) count as overdue.
+    uint64_t since = frame.timestamp > lastSent_ ? frame.timestamp - lastSent_ : UINT64_MAX;
+    if (refinesLeft_ > 0 && since >= uint64_t(options_.refineInterval.count())) {
+        --refinesLeft_;
+        return sent(Decision::Refine, frame.timestamp);
+    }
+    if (refinesLeft_ == 0 && since >= uint64_t(options_.refreshInterval.count()))
+        return sent(Decision::Refresh, frame.timestamp);
+    ++stats_.dropped;
+    return Decision::Drop;
+}
+
+}
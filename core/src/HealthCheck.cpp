@@ -1,29 +1,40 @@
 #include "../include/HealthCheck.h"
-#include "../include/Capture.h"
-#include "../include/Encoder.h"
-#include "../include/SignalingClient.h"
-#include "../include/WebRTCSession.h"
+#include "../include/Capabilities.h"
+#include "../include/Config.h"
 #include "../include/Logger.h"
+#include <algorithm>
 namespace stream {
-bool health_check() {
-    // Try to create all major modules and check for nullptr
-    bool ok = true;
-    if (!createPlatformCapture()) {
-        log_error("HealthCheck: Failed to create capture");
-        ok = false;
-    }
-    if (!createPlatformEncoder()) {
-        log_error("HealthCheck: Failed to create encoder");
-        ok = false;
-    }
-    if (!createWebSocketSignalingClient()) {
-        log_error("HealthCheck: Failed to create signaling client");
-        ok = false;
-    }
-    if (!createWebRTCSession()) {
-        log_error("HealthCheck: Failed to create WebRTC session");
-        ok = false;
+bool health_check(const StreamConfig& config) {
+    CapabilityProbes& probes = capabilities();
+    addPlatformProbes(probes, config);
+    auto t0 = std::chrono::steady_clock::now();
+    auto results = probes.results();
+    auto total = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0);
+
+    // Screen capture can't run without a display: an X one if the config
+    // asks for the X11 backend, otherwise X or PipeWire, which is what
+    // Wayland sessions use. Everything else has a fallback or is optional.
+    auto available = [&](const char* name) {
+        for (const auto& r : results)
+            if (r.name == name) return r.available;
+        return false;
+    };
+    bool hasCaptureProbes = std::any_of(results.begin(), results.end(),
+                                        [](const ProbeResult& r) { return r.name == "x11.display"; });
+    bool x11Only = config.capture.backend.backend == "x11";
+    bool ok = !hasCaptureProbes || available("x11.display") || (!x11Only && available("pipewire"));
+
+    for (const auto& r : results) {
+        std::string line = "HealthCheck: " + r.name + (r.available ? " ok" : " unavailable") + " (" +
+                           std::to_string(r.elapsed.count()) + "us): " + r.detail;
+        bool captureProbe = r.name == "x11.display" || (r.name == "pipewire" && !x11Only);
+        if (!ok && captureProbe) {
+            log_error(line);
+        } else {
+            log_info(line);
+        }
     }
+    log_info("HealthCheck: " + std::to_string(results.size()) + " probes in " + std::to_string(total.count()) + "us");
     return ok;
 }
 }
@@ -1,6 +1,309 @@
 #include "../include/Logger.h"
-#include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace stream {
-void log_info(const std::string& msg) { std::cout << "[INFO] " << msg << std::endl; }
-void log_error(const std::string& msg) { std::cerr << "[ERROR] " << msg << std::endl; }
+namespace logdetail {
+
+std::atomic<uint8_t> runtimeLevel{uint8_t(LogLevel::Info)};
+
+namespace {
+
+constexpr size_t kRingBytes = 64 * 1024;    // per thread, power of two
+constexpr uint32_t kPaddingFlag = 0x80000000u;
+constexpr auto kFlushInterval = std::chrono::milliseconds(20);
+
+// Single-producer/single-consumer byte ring. Each record starts with a u32
+// length (multiple of 8); a record that would straddle the end is preceded
+// by a padding record so every record is contiguous.
+struct ThreadRing {
+    ThreadRing(uint32_t id) : buffer(kRingBytes), threadId(id) {}
+
+    std::vector<uint8_t> buffer;
+    std::atomic<uint64_t> head{0}; // written by the owning thread
+    std::atomic<uint64_t> tail{0}; // written by the sink thread
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> abandoned{false};
+    uint64_t pending = 0; // size of the record between begin/commit
+    uint32_t threadId;
+};
+
+struct Entry {
+    uint64_t timestamp;
+    uint32_t threadId;
+    LogLevel level;
+    std::string text;
+};
+
+class Sink {
+public:
+    Sink() : thread_(&Sink::run, this) {}
+
+    ~Sink() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    std::shared_ptr<ThreadRing> registerThread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto ring = std::make_shared<ThreadRing>(nextThreadId_++);
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void wake() { cv_.notify_one(); }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = ++flushRequested_;
+        cv_.notify_one();
+        flushed_.wait(lock, [&] { return flushCompleted_ >= target || stop_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_;
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+    uint32_t nextThreadId_ = 1;
+    bool stop_ = false;
+    uint64_t flushRequested_ = 0;
+    uint64_t flushCompleted_ = 0;
+    std::thread thread_;
+
+    void run() {
+        std::vector<Entry> entries;
+        std::string out, err;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait_for(lock, kFlushInterval, [this] { return stop_ || flushRequested_ > flushCompleted_; });
+            bool stopping = stop_;
+            uint64_t flushTarget = flushRequested_;
+            auto rings = rings_;
+            lock.unlock();
+
+            for (auto& ring : rings) drain(*ring, entries);
+            write(entries, out, err);
+
+            lock.lock();
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const auto& r) {
+                return r->abandoned.load(std::memory_order_acquire) &&
+                       r->head.load(std::memory_order_acquire) == r->tail.load(std::memory_order_relaxed);
+            }), rings_.end());
+            flushCompleted_ = flushTarget;
+            flushed_.notify_all();
+            if (stopping) return;
+        }
+    }
+
+    static void drain(ThreadRing& ring, std::vector<Entry>& entries) {
+        uint64_t dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped)
+            entries.push_back({0, ring.threadId, LogLevel::Warn,
+                               "log ring full, dropped " + std::to_string(dropped) + " message(s)"});
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        while (tail != head) {
+            const uint8_t* rec = &ring.buffer[tail & (kRingBytes - 1)];
+            uint32_t len;
+            memcpy(&len, rec, 4);
+            if (!(len & kPaddingFlag))
+                entries.push_back(decode(rec, ring.threadId));
+            tail += len & ~kPaddingFlag;
+        }
+        ring.tail.store(tail, std::memory_order_release);
+    }
+
+    static Entry decode(const uint8_t* rec, uint32_t threadId) {
+        Entry e;
+        e.threadId = threadId;
+        const uint8_t* p = rec + 8;
+        const char* format;
+        memcpy(&e.timestamp, p, 8);
+        memcpy(&format, p + 8, sizeof(format));
+        p += 8 + sizeof(format);
+        e.level = LogLevel(*p++);
+        unsigned argc = *p++;
+
+        // "{}" takes the next argument, "{{" is a literal brace; leftover
+        // arguments are appended so nothing is silently lost.
+        auto appendArg = [&](std::string& s) {
+            char buf[32];
+            char tag = char(*p++);
+            switch (tag) {
+            case 's': {
+                uint32_t n;
+                memcpy(&n, p, 4);
+                s.append(reinterpret_cast<const char*>(p + 4), n);
+                p += 4 + n;
+                return;
+            }
+            case 'b': s += *p++ ? "true" : "false"; return;
+            case 'c': s += char(*p++); return;
+            case 'i': {
+                int64_t v;
+                memcpy(&v, p, 8);
+                p += 8;
+                s.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+                return;
+            }
+            case 'u': {
+                uint64_t v;
+                memcpy(&v, p, 8);
+                p += 8;
+                s.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+                return;
+            }
+            case 'p': {
+                uint64_t v;
+                memcpy(&v, p, 8);
+                p += 8;
+                s += "0x";
+                s.append(buf, std::to_chars(buf, buf + sizeof(buf), v, 16).ptr);
+                return;
+            }
+            case 'd': {
+                double v;
+                memcpy(&v, p, 8);
+                p += 8;
+                s.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+                return;
+            }
+            }
+        };
+        for (const char* f = format; *f; ++f) {
+            if (f[0] == '{' && f[1] == '{') {
+                e.text += '{';
+                ++f;
+            } else if (f[0] == '}' && f[1] == '}') {
+                e.text += '}';
+                ++f;
+            } else if (f[0] == '{' && f[1] == '}' && argc) {
+                appendArg(e.text);
+                --argc;
+                ++f;
+            } else {
+                e.text += *f;
+            }
+        }
+        while (argc--) {
+            e.text += ' ';
+            appendArg(e.text);
+        }
+        return e;
+    }
+
+    static void write(std::vector<Entry>& entries, std::string& out, std::string& err) {
+        if (entries.empty()) return;
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const Entry& a, const Entry& b) { return a.timestamp < b.timestamp; });
+        static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+        char prefix[64];
+        for (const Entry& e : entries) {
+            std::string& target = e.level >= LogLevel::Warn ? err : out;
+            snprintf(prefix, sizeof(prefix), "[%s] %llu.%06llu t%u ", names[uint8_t(e.level) & 3],
+                     (unsigned long long)(e.timestamp / 1000000000ull),
+                     (unsigned long long)(e.timestamp / 1000ull % 1000000ull), e.threadId);
+            target += prefix;
+            target += e.text;
+            target += '\n';
+        }
+        // One write per stream per batch.
+        if (!out.empty()) {
+            fwrite(out.data(), 1, out.size(), stdout);
+            fflush(stdout);
+        }
+        if (!err.empty()) {
+            fwrite(err.data(), 1, err.size(), stderr);
+            fflush(stderr);
+        }
+        entries.clear();
+        out.clear();
+        err.clear();
+    }
+};
+
+Sink& sink() {
+    static Sink instance;
+    return instance;
+}
+
+// Marks the ring abandoned when its thread exits; the sink drains what is
+// left and then frees it.
+struct ThreadRingHolder {
+    std::shared_ptr<ThreadRing> ring;
+    ~ThreadRingHolder() {
+        if (ring) ring->abandoned.store(true, std::memory_order_release);
+    }
+};
+
+ThreadRing& threadRing() {
+    thread_local ThreadRingHolder holder;
+    if (!holder.ring) holder.ring = sink().registerThread();
+    return *holder.ring;
+}
+
+} // namespace
+
+uint8_t* beginRecord(size_t bytes) {
+    ThreadRing& ring = threadRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    uint64_t tail = ring.tail.load(std::memory_order_acquire);
+    size_t offset = head & (kRingBytes - 1);
+    size_t toEnd = kRingBytes - offset;
+    size_t padding = bytes > toEnd ? toEnd : 0;
+    if (bytes > kRingBytes / 4 || head + padding + bytes - tail > kRingBytes) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    if (padding) {
+        uint32_t len = uint32_t(padding) | kPaddingFlag;
+        memcpy(&ring.buffer[offset], &len, 4);
+        head += padding;
+        ring.head.store(head, std::memory_order_release);
+        offset = 0;
+    }
+    uint32_t len = uint32_t(bytes);
+    memcpy(&ring.buffer[offset], &len, 4);
+    ring.pending = bytes;
+    return &ring.buffer[offset];
+}
+
+void commitRecord(LogLevel level) {
+    ThreadRing& ring = threadRing();
+    ring.head.store(ring.head.load(std::memory_order_relaxed) + ring.pending, std::memory_order_release);
+    // Errors go out promptly; everything else waits for the next batch.
+    if (level >= LogLevel::Error) sink().wake();
+}
+
+} // namespace logdetail
+
+void log_info(const std::string& msg) { STREAM_LOG_INFO("{}", msg); }
+void log_error(const std::string& msg) { STREAM_LOG_ERROR("{}", msg); }
+
+void setLogLevel(LogLevel level) {
+    logdetail::runtimeLevel.store(uint8_t(level), std::memory_order_relaxed);
+}
+
+LogLevel parseLogLevel(std::string_view name, LogLevel fallback) {
+    if (name == "debug") return LogLevel::Debug;
+    if (name == "info") return LogLevel::Info;
+    if (name == "warn" || name == "warning") return LogLevel::Warn;
+    if (name == "error") return LogLevel::Error;
+    if (name == "off") return LogLevel::Off;
+    return fallback;
+}
+
+void flushLogs() { logdetail::sink().flush(); }
+
 }
@@ -0,0 +1,143 @@
+#include "../include/PipelineStats.h"
+#include "../include/Logger.h"
+#include <nlohmann/json.hpp>
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace stream {
+
+PipelineCounters& pipelineCounters() {
+    static PipelineCounters counters;
+    return counters;
+}
+
+std::string statsToJson(const StatsSnapshot& s, const std::vector<ThreadUsage>& threads) {
+    nlohmann::json j;
+    j["timestamp_us"] = s.timestampMicros;
+    j["capture_fps"] = s.captureFps;
+    j["encode_fps"] = s.encodeFps;
+    j["skipped_fps"] = s.skippedFps;
+    j["encode_ms_avg"] = s.encodeMsAvg;
+    j["grab_ms_avg"] = s.grabMsAvg;
+    j["encoded_kbps"] = s.encodedKbps;
+    j["key_frames"] = s.keyFrames;
+    j["rtt_ms"] = s.rttMs;
+    j["packets_lost"] = s.packetsLost;
+    j["fraction_lost"] = s.fractionLost;
+    j["jitter_ms"] = s.jitterMs;
+    j["jitter_buffer_delay_ms"] = s.jitterBufferDelayMs;
+    j["available_outgoing_kbps"] = s.availableOutgoingKbps;
+    j["frames_sent"] = s.framesSent;
+    j["ice_connection_state"] = s.iceConnectionState;
+    j["signaling_state"] = s.signalingState;
+    j["time_to_first_frame_ms"] = s.timeToFirstFrameMs;
+    j["threads"] = nlohmann::json::array();
+    for (const ThreadUsage& t : threads)
+        j["threads"].push_back({{"name", t.name}, {"role", threadRoleName(t.role)}, {"tid", t.tid},
+                                {"cpu_ms", t.cpuMicros / 1000.0}});
+    return j.dump();
+}
+
+// The data copies below are plain loads racing with the writer; the
+// sequence re-check discards any torn copy, the usual seqlock contract.
+void StatsPublisher::publish(const StatsSnapshot& snapshot) {
+    uint32_t next = current_.load(std::memory_order_relaxed) ^ 1;
+    Slot& slot = slots_[next];
+    slot.seq.fetch_add(1, std::memory_order_acq_rel); // odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.data = snapshot;
+    slot.seq.fetch_add(1, std::memory_order_release);
+    current_.store(next, std::memory_order_release);
+}
+
+StatsSnapshot StatsPublisher::latest() const {
+    for (;;) {
+        const Slot& slot = slots_[current_.load(std::memory_order_acquire)];
+        uint32_t before = slot.seq.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        StatsSnapshot copy = slot.data;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == before)
+            return copy;
+    }
+}
+
+StatsServer::~StatsServer() { stop(); }
+
+#ifdef _WIN32
+bool StatsServer::start(const std::string&) {
+    log_error("Stats socket not supported on this platform");
+    return false;
+}
+void StatsServer::stop() {}
+void StatsServer::run() {}
+#else
+
+bool StatsServer::start(const std::string& socketPath) {
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        log_error("Stats socket path too long: " + socketPath);
+        return false;
+    }
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+        log_error(std::string("Stats socket: ") + strerror(errno));
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd_, 4) < 0) {
+        log_error("Stats socket bind " + socketPath + ": " + strerror(errno));
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    wakeFd_ = eventfd(0, EFD_CLOEXEC);
+    path_ = socketPath;
+    thread_ = std::thread(&StatsServer::run, this);
+    return true;
+}
+
+void StatsServer::stop() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        (void)!write(wakeFd_, &one, sizeof(one));
+        thread_.join();
+    }
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        unlink(path_.c_str());
+    }
+    if (wakeFd_ >= 0) close(wakeFd_);
+    listenFd_ = wakeFd_ = -1;
+}
+
+void StatsServer::run() {
+    ThreadScope scope(ThreadRole::Control, "stats-server");
+    pollfd fds[2] = {{listenFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) return;
+        if (!(fds[0].revents & POLLIN)) continue;
+        int client = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) continue;
+        std::string body = statsToJson(publisher_.latest(), threadTopology().usage());
+        body += '\n';
+        (void)!send(client, body.data(), body.size(), MSG_NOSIGNAL);
+        close(client);
+    }
+}
+#endif
+
+}
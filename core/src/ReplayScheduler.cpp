@@ -0,0 +1,46 @@
+#include "ReplayScheduler.h"
+#include <algorithm>
+#include <thread>
+
+namespace stream {
+
+ReplayScheduler::ReplayScheduler(const Options& options)
+    : speed_(options.speed <= 0.0 ? 0.0 : std::clamp(options.speed, kMinSpeed, kMaxSpeed)),
+      late_(options.late),
+      lateTolerance_(options.lateTolerance) {}
+
+bool ReplayScheduler::wait(uint64_t mediaMicros, bool droppable) {
+    if (!started_) {
+        started_ = true;
+        start_ = Clock::now();
+        startMedia_ = mediaMicros;
+    }
+    if (unthrottled()) {
+        ++stats_.delivered;
+        return true;
+    }
+
+    // Media that runs backwards (e.g. B-frame order) is due immediately.
+    uint64_t offset = mediaMicros > startMedia_ ? mediaMicros - startMedia_ : 0;
+    auto due = start_ + std::chrono::microseconds(int64_t(double(offset) / speed_));
+    auto now = Clock::now();
+    if (now < due) {
+        std::this_thread::sleep_until(due);
+        ++stats_.delivered;
+        return true;
+    }
+
+    auto lateBy = std::chrono::duration_cast<std::chrono::microseconds>(now - due);
+    if (late_ == LatePolicy::Drop && droppable && lateBy > lateTolerance_) {
+        ++stats_.dropped;
+        return false;
+    }
+    ++stats_.delivered;
+    if (lateBy.count() > 0) {
+        ++stats_.late;
+        stats_.maxLateMicros = std::max<int64_t>(stats_.maxLateMicros, lateBy.count());
+    }
+    return true;
+}
+
+}
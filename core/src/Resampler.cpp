@@ -0,0 +1,134 @@
+#include "../include/Resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define STREAM_RESAMPLER_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define STREAM_RESAMPLER_NEON 1
+#endif
+
+namespace stream {
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kKaiserBeta = 8.0;
+
+double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// `n` is a multiple of 8 (taps are rounded up in the constructor).
+float dot(const float* a, const float* b, int n) {
+#if defined(STREAM_RESAMPLER_SSE)
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc0);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(STREAM_RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.f), acc1 = vdupq_n_f32(0.f);
+    for (int i = 0; i < n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    return vgetq_lane_f32(acc0, 0) + vgetq_lane_f32(acc0, 1) + vgetq_lane_f32(acc0, 2) + vgetq_lane_f32(acc0, 3);
+#else
+    float sum = 0.f;
+    for (int i = 0; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+#endif
+}
+
+int16_t toS16(float v) {
+    v = std::round(v);
+    return int16_t(std::clamp(v, -32768.f, 32767.f));
+}
+
+} // namespace
+
+Resampler::Resampler(int inputRate, int outputRate, int channels, int tapsPerPhase)
+    : inputRate_(inputRate), outputRate_(outputRate), channels_(channels),
+      taps_((std::max(tapsPerPhase, 8) + 7) & ~7) {
+    int g = std::gcd(inputRate, outputRate);
+    up_ = outputRate / g;
+    down_ = inputRate / g;
+    history_.resize(size_t(channels));
+    reset();
+    if (up_ == down_) return;
+
+    // Prototype runs at inputRate * L; cut off a little below the lower
+    // Nyquist frequency so the transition band doesn't alias.
+    const int length = up_ * taps_;
+    const double cutoff = 0.5 * std::min(1.0, double(up_) / down_) * 0.92 / up_;
+    const double center = (length - 1) / 2.0;
+    const double norm = besselI0(kKaiserBeta);
+    std::vector<double> proto(static_cast<size_t>(length));
+    for (int i = 0; i < length; ++i) {
+        double t = i - center;
+        double sinc = t == 0 ? 2.0 * cutoff : std::sin(2.0 * kPi * cutoff * t) / (kPi * t);
+        double r = 2.0 * i / (length - 1) - 1.0;
+        proto[size_t(i)] = sinc * besselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / norm;
+    }
+    // Phase p uses h[p + m*L] for input x[i - m]; store reversed so the dot
+    // product walks the history forwards. Scale by L to undo zero-stuffing.
+    coeffs_.assign(size_t(up_) * taps_, 0.f);
+    for (int p = 0; p < up_; ++p)
+        for (int m = 0; m < taps_; ++m)
+            coeffs_[size_t(p) * taps_ + (taps_ - 1 - m)] = float(proto[size_t(p + m * up_)] * up_);
+}
+
+void Resampler::reset() {
+    for (auto& h : history_) h.assign(size_t(taps_ - 1), 0.f);
+    position_ = 0;
+    phase_ = 0;
+}
+
+void Resampler::process(const int16_t* in, size_t frames, std::vector<int16_t>& out) {
+    if (up_ == down_) {
+        out.insert(out.end(), in, in + frames * channels_);
+        return;
+    }
+    for (int c = 0; c < channels_; ++c) {
+        auto& h = history_[size_t(c)];
+        size_t base = h.size();
+        h.resize(base + frames);
+        for (size_t i = 0; i < frames; ++i) h[base + i] = float(in[i * channels_ + c]);
+    }
+    const size_t available = history_[0].size();
+    size_t outFrames = 0;
+    // Count first so `out` grows once.
+    for (size_t pos = position_, phase = size_t(phase_); pos + size_t(taps_) <= available; ++outFrames) {
+        phase += size_t(down_);
+        pos += phase / size_t(up_);
+        phase %= size_t(up_);
+    }
+    size_t start = out.size();
+    out.resize(start + outFrames * channels_);
+    int16_t* dst = out.data() + start;
+    for (size_t n = 0; n < outFrames; ++n) {
+        const float* coeff = &coeffs_[size_t(phase_) * taps_];
+        for (int c = 0; c < channels_; ++c)
+            *dst++ = toS16(dot(coeff, &history_[size_t(c)][position_], taps_));
+        phase_ += down_;
+        position_ += size_t(phase_ / up_);
+        phase_ %= up_;
+    }
+    // Drop consumed input, keeping the window's worth of history.
+    for (auto& h : history_) h.erase(h.begin(), h.begin() + std::ptrdiff_t(position_));
+    position_ = 0;
+}
+
+}
@@ -0,0 +1,101 @@
+#include "../include/Startup.h"
+#include "../include/Logger.h"
+#include "../include/PipelineStats.h"
+#include <future>
+#include <thread>
+
+namespace stream {
+
+void StartupOrchestrator::add(const std::string& name, Step step, std::vector<std::string> after, bool required) {
+    pending_.push_back({name, std::move(step), std::move(after), required});
+}
+
+bool StartupOrchestrator::run() {
+    std::vector<Pending> batch;
+    batch.swap(pending_);
+    const size_t n = batch.size();
+
+    // Each step publishes its outcome through a promise; dependents wait
+    // on it. Steps from earlier run() calls are already settled.
+    std::vector<std::promise<bool>> done(n);
+    std::vector<std::shared_future<bool>> outcome(n);
+    for (size_t i = 0; i < n; ++i) outcome[i] = done[i].get_future().share();
+
+    std::vector<std::vector<std::shared_future<bool>>> depsOf(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (const auto& name : batch[i].after) {
+            bool found = false;
+            for (size_t j = 0; j < i && !found; ++j) {
+                if (batch[j].name == name) {
+                    depsOf[i].push_back(outcome[j]);
+                    found = true;
+                }
+            }
+            for (const auto& r : results_) {
+                if (!found && r.name == name) {
+                    std::promise<bool> settled;
+                    settled.set_value(r.ok);
+                    depsOf[i].push_back(settled.get_future().share());
+                    found = true;
+                }
+            }
+            if (!found) {
+                log_error("Startup: " + batch[i].name + " depends on unknown step " + name);
+                std::promise<bool> missing;
+                missing.set_value(false);
+                depsOf[i].push_back(missing.get_future().share());
+            }
+        }
+    }
+
+    std::vector<StepResult> batchResults(n);
+    std::vector<std::thread> threads;
+    threads.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        threads.emplace_back([&, i] {
+            StepResult& r = batchResults[i];
+            r.name = batch[i].name;
+            r.required = batch[i].required;
+            bool ready = true;
+            for (auto& dep : depsOf[i]) ready = dep.get() && ready;
+            r.startedAt = sinceStart();
+            if (!ready) {
+                r.skipped = true;
+            } else {
+                r.ok = batch[i].step();
+                r.elapsed = sinceStart() - r.startedAt;
+            }
+            done[i].set_value(r.ok);
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    bool ok = true;
+    for (auto& r : batchResults) {
+        if (r.required && !r.ok) {
+            log_error("Startup: " + r.name + (r.skipped ? " skipped, a dependency failed" : " failed"));
+            ok = false;
+        }
+        results_.push_back(std::move(r));
+    }
+    return ok;
+}
+
+bool StartupOrchestrator::markFirstFrame() {
+    if (first_frame_seen_.load(std::memory_order_relaxed) || first_frame_seen_.exchange(true))
+        return false;
+    int64_t us = sinceStart().count();
+    first_frame_us_.store(us, std::memory_order_relaxed);
+    pipelineCounters().timeToFirstFrameMicros.store(uint64_t(us), std::memory_order_relaxed);
+    return true;
+}
+
+void StartupOrchestrator::logTimeline() const {
+    for (const auto& r : results_) {
+        std::string state = r.skipped ? "skipped" : r.ok ? "ok" : r.required ? "FAILED" : "unavailable";
+        log_info("Startup: " + r.name + " " + state + " at +" + std::to_string(r.startedAt.count() / 1000) +
+                 "ms, took " + std::to_string(r.elapsed.count() / 1000) + "ms");
+    }
+}
+
+}
@@ -0,0 +1,219 @@
+#include "../include/ThreadTopology.h"
+#include "../include/Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace stream {
+
+const char* threadRoleName(ThreadRole role) {
+    switch (role) {
+    case ThreadRole::Capture: return "capture";
+    case ThreadRole::Audio: return "audio";
+    case ThreadRole::Network: return "network";
+    case ThreadRole::Control: return "control";
+    }
+    return "?";
+}
+
+bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    std::vector<int> out;
+    std::istringstream in(text);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        int first = 0, last = 0;
+        char dash = 0, tail = 0;
+        int n = sscanf(range.c_str(), " %d %c %d %c", &first, &dash, &last, &tail);
+        if (n == 1)
+            last = first;
+        else if (n != 3 || dash != '-')
+            return false;
+        if (first < 0 || last < first || last >= 4096) return false;
+        for (int cpu = first; cpu <= last; ++cpu) out.push_back(cpu);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    cpus = std::move(out);
+    return true;
+}
+
+ThreadTopology& threadTopology() {
+    static ThreadTopology topology;
+    return topology;
+}
+
+void ThreadTopology::setPolicy(ThreadRole role, const ThreadPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policies_[int(role)] = policy;
+    for (const Entry& entry : threads_)
+        if (entry.role == role) applyLocked(entry);
+}
+
+ThreadPolicy ThreadTopology::policy(ThreadRole role) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return policies_[int(role)];
+}
+
+#ifdef __linux__
+namespace {
+
+int currentTid() { return int(syscall(SYS_gettid)); }
+
+// What the process was allowed to run on before anything was pinned, so
+// a role whose CPU list is removed goes back to it.
+const cpu_set_t& processAffinity() {
+    static const cpu_set_t mask = [] {
+        cpu_set_t m;
+        CPU_ZERO(&m);
+        if (sched_getaffinity(0, sizeof(m), &m) != 0)
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) CPU_SET(cpu, &m);
+        return m;
+    }();
+    return mask;
+}
+
+// Nanoseconds on CPU from schedstat, else user + system ticks from stat.
+bool threadCpuMicros(int tid, uint64_t& micros) {
+    std::string task = "/proc/self/task/" + std::to_string(tid);
+    std::ifstream schedstat(task + "/schedstat");
+    uint64_t ns = 0;
+    if (schedstat >> ns) {
+        micros = ns / 1000;
+        return true;
+    }
+    std::ifstream statFile(task + "/stat");
+    std::string stat;
+    if (!std::getline(statFile, stat)) return false;
+    // The name in parentheses may hold spaces; fields resume after it.
+    size_t close = stat.rfind(')');
+    if (close == std::string::npos) return false;
+    std::istringstream fields(stat.substr(close + 2));
+    std::string field;
+    uint64_t utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; ++i) {
+        if (i == 14) utime = std::stoull(field);
+        if (i == 15) stime = std::stoull(field);
+    }
+    long hz = sysconf(_SC_CLK_TCK);
+    micros = (utime + stime) * 1000000 / uint64_t(hz > 0 ? hz : 100);
+    return true;
+}
+
+bool readCpuList(const std::string& path, std::vector<int>& cpus) {
+    std::ifstream f(path);
+    std::string text;
+    return std::getline(f, text) && parseCpuList(text, cpus);
+}
+
+constexpr int kMpolPreferred = 1;
+constexpr int kMaxNodes = 1024;
+
+}
+
+void ThreadTopology::enter(ThreadRole role, const std::string& name) {
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back({name, role, currentTid()});
+    applyLocked(threads_.back());
+}
+
+void ThreadTopology::leave() {
+    int tid = currentTid();
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.erase(std::remove_if(threads_.begin(), threads_.end(), [&](const Entry& e) { return e.tid == tid; }),
+                   threads_.end());
+}
+
+void ThreadTopology::applyLocked(const Entry& entry) const {
+    const ThreadPolicy& policy = policies_[int(entry.role)];
+    cpu_set_t mask = processAffinity();
+    if (!policy.cpus.empty()) {
+        CPU_ZERO(&mask);
+        for (int cpu : policy.cpus)
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &mask);
+    }
+    if (sched_setaffinity(entry.tid, sizeof(mask), &mask) != 0)
+        STREAM_LOG_WARN("threads: {} cannot be pinned to its {} CPUs: {}", entry.name, threadRoleName(entry.role),
+                        strerror(errno));
+
+    int scheduler = policy.scheduler == "fifo" ? SCHED_FIFO : policy.scheduler == "rr" ? SCHED_RR : SCHED_OTHER;
+    sched_param param{};
+    param.sched_priority = scheduler == SCHED_OTHER ? 0 : std::clamp(policy.priority, 1, 99);
+    if (sched_setscheduler(entry.tid, scheduler, &param) != 0 && scheduler != SCHED_OTHER) {
+        STREAM_LOG_WARN("threads: SCHED_{} unavailable for {} ({}), running at normal priority",
+                        policy.scheduler == "fifo" ? "FIFO" : "RR", entry.name, strerror(errno));
+        param.sched_priority = 0;
+        sched_setscheduler(entry.tid, SCHED_OTHER, &param);
+    }
+}
+
+std::vector<ThreadUsage> ThreadTopology::usage() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ThreadUsage> out;
+    for (auto it = threads_.begin(); it != threads_.end();) {
+        uint64_t micros = 0;
+        if (!threadCpuMicros(it->tid, micros)) {
+            it = threads_.erase(it); // exited without leave()
+            continue;
+        }
+        out.push_back({it->name, it->role, it->tid, micros});
+        ++it;
+    }
+    return out;
+}
+
+int ThreadTopology::numaNode(ThreadRole role) const {
+    std::vector<int> cpus = policy(role).cpus;
+    std::vector<int> online;
+    if (cpus.empty() || !readCpuList("/sys/devices/system/node/online", online) || online.size() < 2) return -1;
+    for (int node : online) {
+        std::vector<int> nodeCpus;
+        if (!readCpuList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", nodeCpus)) continue;
+        if (std::includes(nodeCpus.begin(), nodeCpus.end(), cpus.begin(), cpus.end())) return node;
+    }
+    return -1; // spans nodes
+}
+
+bool ThreadTopology::bindToNode(void* addr, size_t bytes, ThreadRole role) const {
+    int node = numaNode(role);
+    if (node < 0 || node >= kMaxNodes || !addr || !bytes) return false;
+    unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {};
+    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = uintptr_t(addr) & ~(page - 1);
+    uintptr_t end = (uintptr_t(addr) + bytes + page - 1) & ~(page - 1);
+    // The kernel drops the last bit of maxnode, hence the + 1.
+    if (syscall(SYS_mbind, begin, end - begin, kMpolPreferred, mask, kMaxNodes + 1, 0) != 0) {
+        STREAM_LOG_WARN("threads: cannot prefer NUMA node {} for {} memory: {}", node, threadRoleName(role),
+                        strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+#else
+
+void ThreadTopology::enter(ThreadRole, const std::string&) {}
+
+void ThreadTopology::leave() {}
+
+void ThreadTopology::applyLocked(const Entry&) const {}
+
+std::vector<ThreadUsage> ThreadTopology::usage() { return {}; }
+
+int ThreadTopology::numaNode(ThreadRole) const { return -1; }
+
+bool ThreadTopology::bindToNode(void*, size_t, ThreadRole) const { return false; }
+
+#endif
+
+}
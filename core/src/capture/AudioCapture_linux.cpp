@@ -0,0 +1,142 @@
+#include "AudioCapture.h"
+#include "Logger.h"
+#include "Resampler.h"
+#include "ThreadTopology.h"
+#include <alsa/asoundlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// ALSA capture on a SCHED_FIFO thread. Small periods (5 ms) keep the
+// device-side delay low; samples are resampled to 48 kHz if needed and
+// handed out in 10 ms frames, which bounds capture-to-send latency to about
+// 15 ms plus the resampler's group delay.
+class LinuxAudioCapture : public AudioCapture {
+public:
+    explicit LinuxAudioCapture(std::string device) : device_(std::move(device)) {}
+    ~LinuxAudioCapture() override { Stop(); }
+
+    bool Start(AudioCallback callback) override {
+        if (!OpenDevice())
+            return false;
+        callback_ = std::move(callback);
+        running_ = true;
+        thread_ = std::thread(&LinuxAudioCapture::CaptureLoop, this);
+        return true;
+    }
+
+    void Stop() override {
+        running_ = false;
+        if (thread_.joinable())
+            thread_.join();
+        if (handle_)
+            snd_pcm_close(handle_);
+        handle_ = nullptr;
+    }
+
+    uint64_t LatencyMicros() const override { return latency_micros_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr unsigned kPeriodMicros = 5000;
+    static constexpr uint64_t kLatencyBudgetMicros = 20000;
+
+    std::string device_;
+    snd_pcm_t* handle_ = nullptr;
+    unsigned rate_ = 0;
+    unsigned channels_ = 2;
+    snd_pcm_uframes_t period_ = 0;
+    AudioCallback callback_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> latency_micros_{0};
+    std::thread thread_;
+
+    bool OpenDevice() {
+        int rc = snd_pcm_open(&handle_, device_.c_str(), SND_PCM_STREAM_CAPTURE, 0);
+        if (rc < 0) {
+            STREAM_LOG_ERROR("audio capture: cannot open {}: {}", device_, snd_strerror(rc));
+            handle_ = nullptr;
+            return false;
+        }
+        snd_pcm_hw_params_t* hw;
+        snd_pcm_hw_params_alloca(&hw);
+        snd_pcm_hw_params_any(handle_, hw);
+        snd_pcm_hw_params_set_access(handle_, hw, SND_PCM_ACCESS_RW_INTERLEAVED);
+        snd_pcm_hw_params_set_format(handle_, hw, SND_PCM_FORMAT_S16_LE);
+        snd_pcm_hw_params_set_channels_near(handle_, hw, &channels_);
+        // Prefer 48 kHz so the resampler is a no-op; take what the device has.
+        rate_ = AudioCapture::kOutputRate;
+        snd_pcm_hw_params_set_rate_near(handle_, hw, &rate_, nullptr);
+        unsigned periodTime = kPeriodMicros;
+        snd_pcm_hw_params_set_period_time_near(handle_, hw, &periodTime, nullptr);
+        unsigned bufferTime = kPeriodMicros * 4;
+        snd_pcm_hw_params_set_buffer_time_near(handle_, hw, &bufferTime, nullptr);
+        if ((rc = snd_pcm_hw_params(handle_, hw)) < 0) {
+            STREAM_LOG_ERROR("audio capture: hw params: {}", snd_strerror(rc));
+            snd_pcm_close(handle_);
+            handle_ = nullptr;
+            return false;
+        }
+        snd_pcm_hw_params_get_period_size(hw, &period_, nullptr);
+        STREAM_LOG_INFO("audio capture: {} at {} Hz, {} ch, period {} frames", device_, rate_, channels_,
+                        uint64_t(period_));
+        return true;
+    }
+
+    static uint64_t NowMicros() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void CaptureLoop() {
+        // The audio role defaults to SCHED_FIFO 10: a period missed while
+        // the desktop is busy is an audible dropout.
+        stream::ThreadScope scope(stream::ThreadRole::Audio, "audio-capture");
+        stream::Resampler resampler(int(rate_), AudioCapture::kOutputRate, int(channels_));
+        const size_t frameSamples = size_t(AudioCapture::kOutputRate / 1000 * AudioCapture::kFrameMillis) * channels_;
+        std::vector<int16_t> period(period_ * channels_);
+        std::vector<int16_t> pending; // 48 kHz samples not yet delivered
+        pending.reserve(frameSamples * 4);
+
+        snd_pcm_start(handle_);
+        while (running_) {
+            snd_pcm_sframes_t n = snd_pcm_readi(handle_, period.data(), period_);
+            if (n < 0) {
+                STREAM_LOG_EVERY_MS(stream::LogLevel::Warn, 1000, "audio capture: overrun ({})", snd_strerror(int(n)));
+                if (snd_pcm_recover(handle_, int(n), 1) < 0) {
+                    STREAM_LOG_ERROR("audio capture: device lost");
+                    return;
+                }
+                continue;
+            }
+            uint64_t now = NowMicros();
+            snd_pcm_sframes_t delay = 0;
+            snd_pcm_delay(handle_, &delay);
+            resampler.process(period.data(), size_t(n), pending);
+
+            size_t offset = 0;
+            while (pending.size() - offset >= frameSamples) {
+                // Everything still queued (in the device, in `pending` behind
+                // this frame, and in the filter) is newer than this frame's
+                // first sample.
+                uint64_t queuedFrames = (pending.size() - offset) / channels_;
+                uint64_t age = (uint64_t(delay) + uint64_t(resampler.delayFrames())) * 1000000 / rate_ +
+                               queuedFrames * 1000000 / AudioCapture::kOutputRate;
+                AudioFrame frame{pending.data() + offset, frameSamples / channels_, AudioCapture::kOutputRate,
+                                 int(channels_), now - age};
+                callback_(frame);
+                latency_micros_.store(NowMicros() - frame.timestamp, std::memory_order_relaxed);
+                offset += frameSamples;
+            }
+            pending.erase(pending.begin(), pending.begin() + std::ptrdiff_t(offset));
+
+            uint64_t latency = latency_micros_.load(std::memory_order_relaxed);
+            if (latency > kLatencyBudgetMicros)
+                STREAM_LOG_EVERY_MS(stream::LogLevel::Warn, 5000, "audio capture latency {} us over budget", latency);
+        }
+    }
+};
+
+std::unique_ptr<AudioCapture> createPlatformAudioCapture(const std::string& device) {
+    return std::make_unique<LinuxAudioCapture>(device);
+}
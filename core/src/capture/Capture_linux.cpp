@@ -1,23 +1,37 @@
 #include "Capture.h"
+#include "ChangeDetector.h"
+#include "LinuxCaptureBackends.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "ThreadTopology.h"
 #include <X11/Xlib.h>
 #include <X11/extensions/XShm.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xrandr.h>
+#include <X11/extensions/Xcomposite.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <unistd.h>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
-#include <iostream>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
 
 class LinuxCapture : public Capture {
 public:
-    LinuxCapture() : running_(false) {}
+    explicit LinuxCapture(bool pipelined = true) : running_(false), pipelined_(pipelined) {}
     ~LinuxCapture() { Stop(); }
 
     bool Start(FrameCallback callback) override {
         callback_ = callback;
         running_ = true;
         capture_thread_ = std::thread(&LinuxCapture::CaptureLoop, this);
+        if (cursor_callback_)
+            cursor_thread_ = std::thread(&LinuxCapture::CursorLoop, this);
         return true;
     }
 
@@ -25,65 +39,567 @@ public:
         running_ = false;
         if (capture_thread_.joinable())
             capture_thread_.join();
+        if (cursor_thread_.joinable())
+            cursor_thread_.join();
+    }
+
+    void SetCursorCallback(CursorCallback callback) override {
+        cursor_callback_ = callback;
+    }
+
+    void SetFrameRate(int fps) override {
+        if (fps > 0) fps_ = fps;
+    }
+
+    bool SetRegion(const CaptureRegion& region) override {
+        return SetTarget(CaptureTarget::fromRegion(region));
+    }
+
+    bool SetTarget(const CaptureTarget& target) override {
+        std::lock_guard<std::mutex> lock(target_mutex_);
+        target_ = target;
+        target_dirty_ = true;
+        return true;
     }
 
 private:
-    bool running_;
+    std::atomic<bool> running_;
+    const bool pipelined_;
     FrameCallback callback_;
+    CursorCallback cursor_callback_;
     std::thread capture_thread_;
+    std::thread cursor_thread_;
+    std::atomic<int> fps_{60};
+    std::mutex target_mutex_;
+    CaptureTarget target_{};
+    std::atomic<bool> target_dirty_{false};
+    std::atomic<int> origin_x_{0};
+    std::atomic<int> origin_y_{0};
 
-    void CaptureLoop() {
+    // The root window grab does not include the cursor, so it is tracked on
+    // its own connection: XFixes tells us when the shape changes and the
+    // position is polled at a higher rate than frames are captured. Nothing
+    // here touches the video path, so a pure mouse move never costs a frame.
+    void CursorLoop() {
+        stream::ThreadScope scope(stream::ThreadRole::Capture, "cursor-x11");
         Display* display = XOpenDisplay(nullptr);
         if (!display) {
-            std::cerr << "Failed to open X display" << std::endl;
+            STREAM_LOG_ERROR("Failed to open X display for cursor");
             return;
         }
+        int eventBase = 0, errorBase = 0;
+        if (!XFixesQueryExtension(display, &eventBase, &errorBase)) {
+            STREAM_LOG_WARN("XFixes not available, cursor overlay disabled");
+            XCloseDisplay(display);
+            return;
+        }
+
+        Window root = DefaultRootWindow(display);
+        XFixesSelectCursorInput(display, root, XFixesDisplayCursorNotifyMask);
+
+        std::vector<uint32_t> pixels;
+        CursorData cursor{};
+        bool shapeDirty = true;
+        int lastX = -1, lastY = -1;
+
+        while (running_) {
+            while (XPending(display)) {
+                XEvent ev;
+                XNextEvent(display, &ev);
+                if (ev.type == eventBase + XFixesCursorNotify)
+                    shapeDirty = true;
+            }
+
+            if (shapeDirty) {
+                shapeDirty = false;
+                if (XFixesCursorImage* img = XFixesGetCursorImage(display)) {
+                    // XFixes hands back one pixel per unsigned long, which is
+                    // 64 bits wide on LP64, so repack into 32-bit ARGB.
+                    pixels.resize(size_t(img->width) * img->height);
+                    for (size_t i = 0; i < pixels.size(); ++i)
+                        pixels[i] = static_cast<uint32_t>(img->pixels[i]);
+                    cursor.width = img->width;
+                    cursor.height = img->height;
+                    cursor.hotspotX = img->xhot;
+                    cursor.hotspotY = img->yhot;
+                    cursor.serial = static_cast<uint32_t>(img->cursor_serial);
+                    cursor.x = img->x - origin_x_;
+                    cursor.y = img->y - origin_y_;
+                    cursor.pixels = pixels.data();
+                    cursor.timestamp = NowMicros();
+                    cursor_callback_(cursor);
+                    cursor.pixels = nullptr;
+                    lastX = img->x;
+                    lastY = img->y;
+                    XFree(img);
+                }
+            }
+
+            Window rootRet, childRet;
+            int rootX, rootY, winX, winY;
+            unsigned int mask;
+            if (XQueryPointer(display, root, &rootRet, &childRet,
+                              &rootX, &rootY, &winX, &winY, &mask) &&
+                (rootX != lastX || rootY != lastY)) {
+                lastX = rootX;
+                lastY = rootY;
+                cursor.x = rootX - origin_x_;
+                cursor.y = rootY - origin_y_;
+                cursor.timestamp = NowMicros();
+                cursor_callback_(cursor);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(4)); // ~250 Hz
+        }
+
+        XCloseDisplay(display);
+    }
+
+    static uint64_t NowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Shared-memory XImage sized to the current capture area. In pipelined
+    // mode the segment also backs a server-side pixmap that the source is
+    // copied into.
+    struct ShmImage {
+        XImage* image = nullptr;
+        XShmSegmentInfo shminfo{};
+        Pixmap pixmap = None;
+    };
+
+    static bool AllocateImage(Display* display, Visual* visual, int depth, int width, int height, ShmImage& out,
+                              bool withPixmap = false) {
+        out.image = XShmCreateImage(display, visual, depth, ZPixmap, nullptr, &out.shminfo, width, height);
+        if (!out.image) return false;
+        out.shminfo.shmid = shmget(IPC_PRIVATE, out.image->bytes_per_line * out.image->height, IPC_CREAT | 0777);
+        out.shminfo.shmaddr = (char*)shmat(out.shminfo.shmid, nullptr, 0);
+        // Untouched so far; the capture thread reads every pixel, so the
+        // pages should come from its node rather than the X server's.
+        if (out.shminfo.shmaddr != (char*)-1)
+            stream::threadTopology().bindToNode(out.shminfo.shmaddr, size_t(out.image->bytes_per_line) * out.image->height,
+                                                stream::ThreadRole::Capture);
+        out.image->data = out.shminfo.shmaddr;
+        out.shminfo.readOnly = False;
+        if (!XShmAttach(display, &out.shminfo)) {
+            STREAM_LOG_ERROR("Failed to attach shared memory");
+            FreeImage(display, out, false);
+            return false;
+        }
+        if (withPixmap)
+            out.pixmap = XShmCreatePixmap(display, DefaultRootWindow(display), out.shminfo.shmaddr, &out.shminfo,
+                                          width, height, depth);
+        return true;
+    }
+
+    static void FreeImage(Display* display, ShmImage& img, bool attached = true) {
+        if (!img.image) return;
+        if (img.pixmap != None) XFreePixmap(display, img.pixmap);
+        img.pixmap = None;
+        if (attached) XShmDetach(display, &img.shminfo);
+        img.image->f.destroy_image(img.image);
+        shmdt(img.shminfo.shmaddr);
+        shmctl(img.shminfo.shmid, IPC_RMID, 0);
+        img.image = nullptr;
+    }
+
+    // Shared pixmaps are optional in MIT-SHM and only usable here if the
+    // server lays them out like our ZPixmap images.
+    static bool SharedPixmapsUsable(Display* display) {
+        int major = 0, minor = 0;
+        Bool pixmaps = False;
+        return XShmQueryVersion(display, &major, &minor, &pixmaps) && pixmaps &&
+               XShmPixmapFormat(display) == ZPixmap;
+    }
+
+    // Clamps the requested region to the screen; an empty region means the
+    // whole root window.
+    static CaptureRegion ResolveRegion(const CaptureRegion& requested, int screenW, int screenH) {
+        if (requested.empty()) return {0, 0, screenW, screenH};
+        CaptureRegion r = requested;
+        r.x = std::clamp(r.x, 0, screenW - 1);
+        r.y = std::clamp(r.y, 0, screenH - 1);
+        r.width = std::min(r.width, screenW - r.x);
+        r.height = std::min(r.height, screenH - r.y);
+        return r;
+    }
+
+    // Where a target's pixels come from: a rectangle of the root window, or
+    // for a window target its composite backing pixmap. A window redirected
+    // by Composite keeps its contents off screen, so it is captured whole
+    // even while covered by other windows.
+    struct Source {
+        Drawable drawable = None;
+        CaptureRegion area;  // within drawable
+        Visual* visual = nullptr;
+        int depth = 0;
+        int originX = 0;     // root position of the area, for the cursor
+        int originY = 0;
+        Window window = None;       // redirected window being followed
+        Pixmap windowPixmap = None; // its current backing pixmap
+    };
+
+    // X errors arrive asynchronously through a process-wide handler. The
+    // capture thread's errors are almost always a target that went away
+    // under us (window destroyed or unmapped), so they pause the target
+    // instead of taking down the process; other threads keep the previous
+    // handler.
+    static thread_local bool t_capture_thread;
+    static thread_local int t_x_error;
+    static XErrorHandler s_previous_handler;
+
+    static int OnXError(Display* display, XErrorEvent* error) {
+        if (!t_capture_thread)
+            return s_previous_handler ? s_previous_handler(display, error) : 0;
+        t_x_error = error->error_code;
+        return 0;
+    }
+
+    static void InstallErrorHandler() {
+        static std::once_flag once;
+        std::call_once(once, [] { s_previous_handler = XSetErrorHandler(OnXError); });
+        t_capture_thread = true;
+    }
+
+    static void ReleaseWindow(Display* display, Source& src) {
+        if (src.windowPixmap != None) XFreePixmap(display, src.windowPixmap);
+        src.windowPixmap = None;
+        if (src.window != None) {
+            XSelectInput(display, src.window, NoEventMask);
+            XCompositeUnredirectWindow(display, src.window, CompositeRedirectAutomatic);
+        }
+        src.window = None;
+    }
 
+    // Resolves `target` into `src`. False with `why` set when there is
+    // nothing to capture right now; the loop then waits for the target to
+    // reappear or change.
+    static bool ResolveSource(Display* display, const CaptureTarget& target, Source& src, std::string& why) {
         Window root = DefaultRootWindow(display);
-        XWindowAttributes gwa;
-        XGetWindowAttributes(display, root, &gwa);
-        int width = gwa.width;
-        int height = gwa.height;
-
-        XShmSegmentInfo shminfo;
-        XImage* image = XShmCreateImage(display, DefaultVisual(display, 0), DefaultDepth(display, 0),
-                                        ZPixmap, nullptr, &shminfo, width, height);
-        shminfo.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0777);
-        shminfo.shmaddr = (char*)shmat(shminfo.shmid, nullptr, 0);
-        image->data = shminfo.shmaddr;
-        shminfo.readOnly = False;
-
-        if (!XShmAttach(display, &shminfo)) {
-            std::cerr << "Failed to attach shared memory" << std::endl;
+        XWindowAttributes rootAttr;
+        XGetWindowAttributes(display, root, &rootAttr);
+
+        if (target.kind != CaptureTarget::Kind::Window || src.window != Window(target.window))
+            ReleaseWindow(display, src);
+        src.drawable = root;
+        src.visual = rootAttr.visual;
+        src.depth = rootAttr.depth;
+
+        switch (target.kind) {
+        case CaptureTarget::Kind::Screen:
+        case CaptureTarget::Kind::Region:
+            src.area = ResolveRegion(target.kind == CaptureTarget::Kind::Region ? target.region : CaptureRegion{},
+                                     rootAttr.width, rootAttr.height);
+            break;
+
+        case CaptureTarget::Kind::Monitor: {
+            int count = 0;
+            XRRMonitorInfo* monitors = XRRGetMonitors(display, root, True, &count);
+            int chosen = -1;
+            for (int i = 0; i < count && chosen < 0; ++i) {
+                char* name = XGetAtomName(display, monitors[i].name);
+                if (target.monitor.empty() ? monitors[i].primary : name && target.monitor == name) chosen = i;
+                if (name) XFree(name);
+            }
+            // With no primary set, the first monitor stands in for it.
+            if (chosen < 0 && target.monitor.empty() && count > 0) chosen = 0;
+            bool found = chosen >= 0;
+            if (found) {
+                const XRRMonitorInfo& m = monitors[chosen];
+                src.area = {m.x, m.y, m.width, m.height};
+            }
+            if (monitors) XRRFreeMonitors(monitors);
+            if (!found) {
+                why = "monitor " + (target.monitor.empty() ? std::string("(primary)") : target.monitor) +
+                      " not connected";
+                return false;
+            }
+            src.area = ResolveRegion(src.area, rootAttr.width, rootAttr.height);
+            break;
+        }
+
+        case CaptureTarget::Kind::Window: {
+            Window window = Window(target.window);
+            XWindowAttributes attr;
+            if (!XGetWindowAttributes(display, window, &attr) || t_x_error) {
+                ReleaseWindow(display, src);
+                why = "window " + std::to_string(target.window) + " does not exist";
+                return false;
+            }
+            if (src.window != window) {
+                XCompositeRedirectWindow(display, window, CompositeRedirectAutomatic);
+                XSelectInput(display, window, StructureNotifyMask);
+                src.window = window;
+            }
+            if (attr.map_state != IsViewable) {
+                why = "window " + std::to_string(target.window) + " is not mapped";
+                return false;
+            }
+            // A new backing pixmap is allocated on every resize; naming it
+            // again picks up the current one.
+            if (src.windowPixmap != None) XFreePixmap(display, src.windowPixmap);
+            src.windowPixmap = XCompositeNameWindowPixmap(display, window);
+            XSync(display, False);
+            if (t_x_error) {
+                src.windowPixmap = None;
+                why = "window " + std::to_string(target.window) + " has no backing pixmap";
+                return false;
+            }
+            Window child;
+            XTranslateCoordinates(display, window, root, 0, 0, &src.originX, &src.originY, &child);
+            src.drawable = src.windowPixmap;
+            src.visual = attr.visual;
+            src.depth = attr.depth;
+            // The pixmap includes the border; only the inside is captured.
+            src.area = {attr.border_width, attr.border_width, attr.width, attr.height};
+            return true;
+        }
+        }
+        src.originX = src.area.x;
+        src.originY = src.area.y;
+        return true;
+    }
+
+    // XShmGetImage is a round trip that holds this thread while the server
+    // copies the whole area. In pipelined mode the copy is an XCopyArea into
+    // a shared pixmap instead, which returns as soon as it is queued: when
+    // conversion and encode would not leave room for a serial grab before
+    // the next deadline, the copy of frame N+1 is issued into the other
+    // segment before frame N is handed to the callback, and an XSync (the
+    // server answers only after the copy is done) collects it afterwards.
+    // Otherwise the grab is started ahead of the deadline by its measured
+    // duration, so a pipeline with headroom doesn't deliver older frames
+    // than a serial grab would.
+    void CaptureLoop() {
+        stream::ThreadScope scope(stream::ThreadRole::Capture, "capture-x11");
+        Display* display = XOpenDisplay(nullptr);
+        if (!display) {
+            STREAM_LOG_ERROR("Failed to open X display");
             return;
         }
+        InstallErrorHandler();
+
+        int compositeEvent = 0, compositeError = 0;
+        const bool haveComposite = XCompositeQueryExtension(display, &compositeEvent, &compositeError);
+        // Mode changes, hotplug and monitor rearrangement all re-resolve the
+        // target, so the grab follows the screen without a restart.
+        int randrEvent = 0, randrError = 0;
+        const bool haveRandr = XRRQueryExtension(display, &randrEvent, &randrError);
+        if (haveRandr)
+            XRRSelectInput(display, DefaultRootWindow(display),
+                           RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+        const bool pipelined = pipelined_ && SharedPixmapsUsable(display);
+        if (pipelined_ && !pipelined)
+            STREAM_LOG_INFO("X11 capture: no shared pixmaps, using synchronous XShmGetImage");
+
+        auto& counters = stream::pipelineCounters();
+        // X11 has no damage we can use for a root grab; hashing the tiles is
+        // cheaper than XDamage round trips anyway.
+        stream::TileChangeDetector detector;
+        Source src;
+        CaptureRegion area{};
+        ShmImage shm[2];
+        int shmDepth = 0;
+        uint32_t generation = 0;
+        GC gc = nullptr;
+        int slots = pipelined ? 2 : 1;
+        int cur = 0;
+        bool inFlight = false;     // a copy into shm[cur] has been queued
+        bool paused = false;       // target is gone until it changes or reappears
+        uint64_t issuedAt = 0;
+        double copyEstimate = 0;   // us, serial copy duration
+        double callbackEstimate = 0;
+        uint64_t frames = 0, overlapped = 0, stallTotal = 0, copyTotal = 0, copySamples = 0;
+        auto next = std::chrono::steady_clock::now();
+
+        auto issueCopy = [&](int slot) {
+            issuedAt = NowMicros();
+            XCopyArea(display, src.drawable, shm[slot].pixmap, gc, area.x, area.y, area.width, area.height, 0, 0);
+            XFlush(display);
+            inFlight = true;
+        };
 
         while (running_) {
-            XShmGetImage(display, root, image, 0, 0, AllPlanes);
+            // A followed window reports resizes, moves and its own demise.
+            while (XPending(display)) {
+                XEvent ev;
+                XNextEvent(display, &ev);
+                if (haveRandr && (ev.type == randrEvent + RRScreenChangeNotify || ev.type == randrEvent + RRNotify)) {
+                    XRRUpdateConfiguration(&ev);
+                    target_dirty_ = true;
+                }
+                if (src.window != None && ev.xany.window == src.window &&
+                    (ev.type == ConfigureNotify || ev.type == MapNotify || ev.type == UnmapNotify ||
+                     ev.type == DestroyNotify))
+                    target_dirty_ = true;
+                if (ev.type == DestroyNotify && ev.xdestroywindow.window == src.window)
+                    src.window = None; // nothing left to unredirect
+            }
+            if (t_x_error && !paused) {
+                STREAM_LOG_WARN("X11 capture: X error {} on the capture target", t_x_error);
+                t_x_error = 0;
+                target_dirty_ = true;
+            }
+
+            if (target_dirty_.exchange(false) || (!shm[0].image && !paused)) {
+                CaptureTarget target;
+                {
+                    std::lock_guard<std::mutex> lock(target_mutex_);
+                    target = target_;
+                }
+                if (inFlight) {
+                    XSync(display, False); // that copy is of the old source
+                    inFlight = false;
+                }
+                std::string why;
+                t_x_error = 0;
+                if (target.kind == CaptureTarget::Kind::Window && !haveComposite) {
+                    why = "Composite extension missing, cannot capture single windows";
+                    paused = true;
+                } else {
+                    paused = !ResolveSource(display, target, src, why);
+                }
+                if (paused) {
+                    STREAM_LOG_WARN("X11 capture paused: {}", why);
+                } else {
+                    if (!shm[0].image || src.area.width != area.width || src.area.height != area.height ||
+                        src.depth != shmDepth) {
+                        if (gc) XFreeGC(display, gc);
+                        gc = nullptr;
+                        bool allocated = true;
+                        for (int i = 0; i < slots; ++i) {
+                            FreeImage(display, shm[i]);
+                            allocated = allocated && AllocateImage(display, src.visual, src.depth, src.area.width,
+                                                                   src.area.height, shm[i], pipelined);
+                        }
+                        if (!allocated) break;
+                        shmDepth = src.depth;
+                        if (generation)
+                            STREAM_LOG_INFO("X11 capture: now {}x{}", src.area.width, src.area.height);
+                        ++generation;
+                        if (pipelined) {
+                            gc = XCreateGC(display, shm[0].pixmap, 0, nullptr);
+                            // The windows, not just the root background.
+                            XSetSubwindowMode(display, gc, IncludeInferiors);
+                        }
+                    }
+                    area = src.area;
+                    origin_x_ = src.originX;
+                    origin_y_ = src.originY;
+                }
+            }
+            if (paused) {
+                std::this_thread::sleep_for(std::chrono::microseconds(1000000 / std::max(1, fps_.load())));
+                continue;
+            }
+
+            // Collect the frame: either the copy queued earlier or a serial
+            // grab now.
+            uint64_t waitStart = NowMicros();
+            bool cold = !inFlight;
+            if (!pipelined) {
+                issuedAt = waitStart;
+                XShmGetImage(display, src.drawable, shm[cur].image, area.x, area.y, AllPlanes);
+            } else {
+                if (cold) issueCopy(cur);
+                XSync(display, False);
+            }
+            uint64_t done = NowMicros();
+            inFlight = false;
+            stallTotal += done - waitStart;
+            counters.grabMicros.fetch_add(done - waitStart, std::memory_order_relaxed);
+            if (cold) {
+                copyEstimate += (double(done - issuedAt) - copyEstimate) / 8;
+                copyTotal += done - issuedAt;
+                ++copySamples;
+            }
+            if (t_x_error) continue; // the target vanished mid-grab
 
             FrameData frame;
-            frame.data = (uint8_t*)image->data;
-            frame.width = width;
-            frame.height = height;
-            frame.stride = image->bytes_per_line;
-            frame.size = image->bytes_per_line * height;
-            frame.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
-                                  std::chrono::steady_clock::now().time_since_epoch()).count();
+            frame.data = (uint8_t*)shm[cur].image->data;
+            frame.width = area.width;
+            frame.height = area.height;
+            frame.stride = shm[cur].image->bytes_per_line;
+            frame.size = shm[cur].image->bytes_per_line * area.height;
+            frame.timestamp = issuedAt;
+            frame.generation = generation;
+            detector.process(frame);
+
+            next += std::chrono::microseconds(1000000 / std::max(1, fps_.load()));
+            uint64_t nextMicros = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                next.time_since_epoch()).count());
+            if (pipelined) {
+                cur ^= 1;
+                if (done + uint64_t(callbackEstimate + copyEstimate) >= nextMicros) {
+                    issueCopy(cur);
+                    ++overlapped;
+                }
+            }
 
+            uint64_t callbackStart = NowMicros();
             callback_(frame);
+            callbackEstimate += (double(NowMicros() - callbackStart) - callbackEstimate) / 8;
+            ++frames;
+
+            // Pace against absolute deadlines so callback time doesn't add
+            // up. A grab that isn't overlapped starts early by its measured
+            // duration so the frame is ready at the deadline.
+            auto now = std::chrono::steady_clock::now();
+            if (next < now) next = now;
+            std::this_thread::sleep_until(inFlight ? next : next - std::chrono::microseconds(int64_t(copyEstimate)));
+        }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60 FPS
+        if (frames) {
+            // The logger takes plain {} only, so round to hundredths here.
+            auto ms = [](double micros) { return std::round(micros / 10) / 100; };
+            STREAM_LOG_INFO("X11 capture {}x{} ({}): {} frames, {}% overlapped, grab stall {} ms avg, "
+                            "copy {} ms avg",
+                            area.width, area.height, pipelined ? "pipelined" : "XShmGetImage", frames,
+                            overlapped * 100 / frames, ms(double(stallTotal) / frames),
+                            ms(copySamples ? double(copyTotal) / copySamples : 0.0));
         }
 
         // Cleanup
-        XShmDetach(display, &shminfo);
-        image->f.destroy_image(image);
-        shmdt(shminfo.shmaddr);
-        shmctl(shminfo.shmid, IPC_RMID, 0);
+        if (inFlight) XSync(display, False);
+        for (auto& img : shm) FreeImage(display, img);
+        if (gc) XFreeGC(display, gc);
+        ReleaseWindow(display, src);
         XCloseDisplay(display);
     }
 };
 
+thread_local bool LinuxCapture::t_capture_thread = false;
+thread_local int LinuxCapture::t_x_error = 0;
+XErrorHandler LinuxCapture::s_previous_handler = nullptr;
+
 extern "C" Capture* CreateCapture() {
     return new LinuxCapture();
 }
+
+std::unique_ptr<Capture> createX11Capture(bool pipelined) {
+    return std::make_unique<LinuxCapture>(pipelined);
+}
+
+#ifndef HAVE_PIPEWIRE
+std::unique_ptr<Capture> createPipeWireCapture(uint32_t node) {
+    (void)node;
+    STREAM_LOG_WARN("Built without PipeWire support, using X11 capture");
+    return createX11Capture();
+}
+#endif
+
+// The X11 grab only sees XWayland clients on a Wayland session, so those
+// go through the screencast portal unless the config says otherwise.
+static bool WaylandSession() {
+    const char* type = getenv("XDG_SESSION_TYPE");
+    return getenv("WAYLAND_DISPLAY") || (type && strcmp(type, "wayland") == 0);
+}
+
+std::unique_ptr<Capture> createPlatformCapture(const CaptureBackendOptions& options) {
+    if (options.backend == "x11")
+        return createX11Capture();
+    if (options.backend == "pipewire" || options.pipewireNode || WaylandSession())
+        return createPipeWireCapture(options.pipewireNode);
+    return createX11Capture();
+}
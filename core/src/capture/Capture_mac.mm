@@ -92,3 +92,8 @@ private:
 extern "C" Capture* CreateCapture() {
     return new MacCapture();
 }
+
+std::unique_ptr<Capture> createPlatformCapture(const CaptureBackendOptions& options) {
+    (void)options;
+    return std::unique_ptr<Capture>(CreateCapture());
+}
@@ -0,0 +1,761 @@
+#include "Capture.h"
+#include "ChangeDetector.h"
+#include "LinuxCaptureBackends.h"
+#include "Logger.h"
+#include "ThreadTopology.h"
+#include <pipewire/pipewire.h>
+#include <spa/buffer/meta.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/pod/builder.h>
+#include <spa/utils/result.h>
+#include <systemd/sd-bus.h>
+#include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kDrmFormatXRGB8888 = 0x34325258; // 'XR24', SPA BGRx
+constexpr uint32_t kDrmFormatARGB8888 = 0x34325241; // 'AR24', SPA BGRA
+constexpr uint64_t kDrmFormatModLinear = 0;
+
+constexpr const char* kPortalService = "org.freedesktop.portal.Desktop";
+constexpr const char* kPortalPath = "/org/freedesktop/portal/desktop";
+constexpr const char* kScreenCastInterface = "org.freedesktop.portal.ScreenCast";
+constexpr uint32_t kSourceMonitor = 1;
+constexpr uint32_t kCursorHidden = 1;
+constexpr uint32_t kCursorEmbedded = 2;
+constexpr uint32_t kCursorMetadata = 4;
+constexpr uint32_t kPersistUntilRevoked = 2;
+// Start() may be waiting on the user to pick a screen.
+constexpr auto kPortalResponseTimeout = std::chrono::seconds(120);
+
+constexpr int kMaxCursorSize = 256;
+
+// Pod values go through varargs, so sizes must already be ints.
+int CursorMetaSize(int width, int height) {
+    return int(sizeof(spa_meta_cursor) + sizeof(spa_meta_bitmap)) + width * height * 4;
+}
+
+uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Lets the next start skip the portal's picker dialog.
+std::filesystem::path RestoreTokenPath() {
+    const char* state = getenv("XDG_STATE_HOME");
+    const char* home = getenv("HOME");
+    std::filesystem::path dir = state && *state ? std::filesystem::path(state)
+                                : home          ? std::filesystem::path(home) / ".local/state"
+                                                : std::filesystem::temp_directory_path();
+    return dir / "stream-core" / "screencast-restore-token";
+}
+
+std::string LoadRestoreToken() {
+    std::ifstream f(RestoreTokenPath());
+    std::string token;
+    std::getline(f, token);
+    return token;
+}
+
+void SaveRestoreToken(const std::string& token) {
+    std::error_code ec;
+    auto path = RestoreTokenPath();
+    std::filesystem::create_directories(path.parent_path(), ec);
+    std::ofstream(path) << token << '\n';
+}
+
+// org.freedesktop.portal.ScreenCast over sd-bus. Every portal call returns a
+// Request object whose Response signal carries the result, so each step
+// subscribes to the (predictable, token-based) request path first and then
+// pumps the bus until the response arrives.
+class ScreenCastPortal {
+public:
+    ~ScreenCastPortal() { Close(); }
+
+    bool Open(bool wantCursorMetadata);
+    void Close();
+
+    int TakeFd() { return std::exchange(fd_, -1); }
+    uint32_t Node() const { return node_; }
+    bool CursorMetadata() const { return cursor_metadata_; }
+
+private:
+    struct Response {
+        bool done = false;
+        uint32_t code = 2; // 0 success, 1 cancelled, 2 other error
+        std::string sessionHandle;
+        std::string restoreToken;
+        uint32_t node = 0;
+    };
+    using Append = std::function<int(sd_bus_message*)>;
+
+    sd_bus* bus_ = nullptr;
+    std::string sender_;
+    std::string session_;
+    unsigned requests_ = 0;
+    int fd_ = -1;
+    uint32_t node_ = 0;
+    bool cursor_metadata_ = false;
+
+    bool Request(const char* method, const Append& args, const Append& options, Response& response);
+    static int OnResponse(sd_bus_message* m, void* userdata, sd_bus_error* error);
+};
+
+bool ScreenCastPortal::Open(bool wantCursorMetadata) {
+    int r = sd_bus_open_user(&bus_);
+    if (r < 0) {
+        STREAM_LOG_ERROR("screencast: no session bus: {}", strerror(-r));
+        return false;
+    }
+    const char* unique = nullptr;
+    if (sd_bus_get_unique_name(bus_, &unique) < 0 || !unique || !*unique)
+        return false;
+    sender_ = unique + 1; // ":1.42" -> "1_42"
+    std::replace(sender_.begin(), sender_.end(), '.', '_');
+
+    uint32_t cursorModes = 0, version = 0;
+    sd_bus_error error = SD_BUS_ERROR_NULL;
+    r = sd_bus_get_property_trivial(bus_, kPortalService, kPortalPath, kScreenCastInterface, "AvailableCursorModes",
+                                    &error, 'u', &cursorModes);
+    if (r < 0) {
+        STREAM_LOG_ERROR("screencast: xdg-desktop-portal has no ScreenCast interface: {}",
+                         error.message ? error.message : strerror(-r));
+        sd_bus_error_free(&error);
+        return false;
+    }
+    sd_bus_get_property_trivial(bus_, kPortalService, kPortalPath, kScreenCastInterface, "version", &error, 'u',
+                                &version);
+    sd_bus_error_free(&error);
+    cursor_metadata_ = wantCursorMetadata && (cursorModes & kCursorMetadata);
+    uint32_t cursorMode = cursor_metadata_ ? kCursorMetadata : (cursorModes & kCursorEmbedded) ? kCursorEmbedded
+                                                                                             : kCursorHidden;
+
+    Response created;
+    std::string sessionToken = "stream_core" + std::to_string(getpid());
+    if (!Request("CreateSession", nullptr, [&](sd_bus_message* m) {
+            return sd_bus_message_append(m, "{sv}", "session_handle_token", "s", sessionToken.c_str());
+        }, created) || created.sessionHandle.empty())
+        return false;
+    session_ = created.sessionHandle;
+
+    std::string restoreToken = version >= 4 ? LoadRestoreToken() : std::string();
+    Response selected;
+    if (!Request("SelectSources", [&](sd_bus_message* m) {
+            return sd_bus_message_append(m, "o", session_.c_str());
+        }, [&](sd_bus_message* m) {
+            int rc = sd_bus_message_append(m, "{sv}", "types", "u", kSourceMonitor);
+            if (rc >= 0) rc = sd_bus_message_append(m, "{sv}", "multiple", "b", 0);
+            if (rc >= 0) rc = sd_bus_message_append(m, "{sv}", "cursor_mode", "u", cursorMode);
+            if (rc >= 0 && version >= 4) rc = sd_bus_message_append(m, "{sv}", "persist_mode", "u", kPersistUntilRevoked);
+            if (rc >= 0 && !restoreToken.empty())
+                rc = sd_bus_message_append(m, "{sv}", "restore_token", "s", restoreToken.c_str());
+            return rc;
+        }, selected))
+        return false;
+
+    Response started;
+    if (!Request("Start", [&](sd_bus_message* m) {
+            return sd_bus_message_append(m, "os", session_.c_str(), "");
+        }, nullptr, started))
+        return false;
+    if (!started.node) {
+        STREAM_LOG_ERROR("screencast: portal returned no stream");
+        return false;
+    }
+    node_ = started.node;
+    if (!started.restoreToken.empty())
+        SaveRestoreToken(started.restoreToken);
+
+    sd_bus_message* reply = nullptr;
+    r = sd_bus_call_method(bus_, kPortalService, kPortalPath, kScreenCastInterface, "OpenPipeWireRemote", &error,
+                           &reply, "oa{sv}", session_.c_str(), 0);
+    int fd = -1;
+    if (r >= 0 && sd_bus_message_read(reply, "h", &fd) >= 0)
+        fd_ = fcntl(fd, F_DUPFD_CLOEXEC, 3); // the message owns `fd`
+    if (fd_ < 0)
+        STREAM_LOG_ERROR("screencast: OpenPipeWireRemote failed: {}", error.message ? error.message : strerror(-r));
+    sd_bus_message_unref(reply);
+    sd_bus_error_free(&error);
+    return fd_ >= 0;
+}
+
+bool ScreenCastPortal::Request(const char* method, const Append& args, const Append& options, Response& response) {
+    std::string token = "stream_core" + std::to_string(++requests_);
+    std::string path = std::string(kPortalPath) + "/request/" + sender_ + "/" + token;
+    sd_bus_slot* slot = nullptr;
+    int r = sd_bus_match_signal(bus_, &slot, kPortalService, path.c_str(), "org.freedesktop.portal.Request",
+                                "Response", &ScreenCastPortal::OnResponse, &response);
+
+    sd_bus_message* m = nullptr;
+    sd_bus_message* reply = nullptr;
+    sd_bus_error error = SD_BUS_ERROR_NULL;
+    if (r >= 0) r = sd_bus_message_new_method_call(bus_, &m, kPortalService, kPortalPath, kScreenCastInterface, method);
+    if (r >= 0 && args) r = args(m);
+    if (r >= 0) r = sd_bus_message_open_container(m, 'a', "{sv}");
+    if (r >= 0) r = sd_bus_message_append(m, "{sv}", "handle_token", "s", token.c_str());
+    if (r >= 0 && options) r = options(m);
+    if (r >= 0) r = sd_bus_message_close_container(m);
+    if (r >= 0) r = sd_bus_call(bus_, m, 0, &error, &reply);
+    if (r < 0)
+        STREAM_LOG_ERROR("screencast: {} failed: {}", method, error.message ? error.message : strerror(-r));
+
+    auto deadline = std::chrono::steady_clock::now() + kPortalResponseTimeout;
+    while (r >= 0 && !response.done) {
+        r = sd_bus_process(bus_, nullptr);
+        if (r > 0) continue;
+        if (std::chrono::steady_clock::now() > deadline) {
+            STREAM_LOG_ERROR("screencast: no response to {}", method);
+            break;
+        }
+        if (r >= 0) r = sd_bus_wait(bus_, 100000);
+    }
+
+    sd_bus_slot_unref(slot);
+    sd_bus_message_unref(reply);
+    sd_bus_message_unref(m);
+    sd_bus_error_free(&error);
+    if (response.done && response.code != 0)
+        STREAM_LOG_ERROR("screencast: {} {}", method, response.code == 1 ? "cancelled by the user" : "failed");
+    return response.done && response.code == 0;
+}
+
+int ScreenCastPortal::OnResponse(sd_bus_message* m, void* userdata, sd_bus_error*) {
+    auto* out = static_cast<Response*>(userdata);
+    out->done = true;
+    if (sd_bus_message_read(m, "u", &out->code) < 0 || sd_bus_message_enter_container(m, 'a', "{sv}") < 0)
+        return 0;
+    while (sd_bus_message_enter_container(m, 'e', "sv") > 0) {
+        const char* key = nullptr;
+        const char* value = nullptr;
+        sd_bus_message_read(m, "s", &key);
+        std::string name = key ? key : "";
+        if (name == "session_handle" && sd_bus_message_read(m, "v", "s", &value) >= 0) {
+            out->sessionHandle = value;
+        } else if (name == "restore_token" && sd_bus_message_read(m, "v", "s", &value) >= 0) {
+            out->restoreToken = value;
+        } else if (name == "streams" && sd_bus_message_enter_container(m, 'v', "a(ua{sv})") > 0) {
+            // One stream, since "multiple" is off; take the first node.
+            if (sd_bus_message_enter_container(m, 'a', "(ua{sv})") > 0) {
+                while (sd_bus_message_enter_container(m, 'r', "ua{sv}") > 0) {
+                    uint32_t node = 0;
+                    sd_bus_message_read(m, "u", &node);
+                    if (!out->node) out->node = node;
+                    sd_bus_message_skip(m, "a{sv}");
+                    sd_bus_message_exit_container(m);
+                }
+                sd_bus_message_exit_container(m);
+            }
+            sd_bus_message_exit_container(m);
+        } else {
+            sd_bus_message_skip(m, "v");
+        }
+        sd_bus_message_exit_container(m);
+    }
+    sd_bus_message_exit_container(m);
+    return 0;
+}
+
+void ScreenCastPortal::Close() {
+    if (bus_ && !session_.empty())
+        sd_bus_call_method(bus_, kPortalService, session_.c_str(), "org.freedesktop.portal.Session", "Close",
+                           nullptr, nullptr, "");
+    session_.clear();
+    if (bus_) bus_ = sd_bus_flush_close_unref(bus_);
+    if (fd_ >= 0) close(std::exchange(fd_, -1));
+}
+
+// CPU mapping of a DMA-BUF that PipeWire didn't map for us.
+struct BufferMapping {
+    uint8_t* data;
+    size_t length;
+};
+
+} // namespace
+
+// Receives screen frames from a PipeWire stream. Buffers come from the
+// stream's own pool (2-8 buffers) and are handed to the callback in place:
+// a memfd/shared-memory buffer is mapped by PipeWire, a DMA-BUF is mapped
+// read-only and bracketed with DMA_BUF_IOCTL_SYNC, and the fd is passed on
+// in FrameData so a hardware encoder can import it. The buffer goes back to
+// the producer when the callback returns. Only the LINEAR modifier is
+// offered for DMA-BUFs, since that is what the CPU path can read; producers
+// that can't export it negotiate shared memory instead.
+class PipeWireCapture : public Capture {
+public:
+    explicit PipeWireCapture(uint32_t node) : node_(node) {}
+    ~PipeWireCapture() override { Stop(); }
+
+    bool Start(FrameCallback callback) override {
+        callback_ = std::move(callback);
+        if (StartStream())
+            return true;
+        StopStream();
+        if (!getenv("DISPLAY"))
+            return false;
+        STREAM_LOG_WARN("PipeWire screencast unavailable, falling back to X11 capture");
+        fallback_ = createX11Capture();
+        fallback_->SetFrameRate(fps_);
+        if (cursor_callback_) fallback_->SetCursorCallback(cursor_callback_);
+        {
+            std::lock_guard<std::mutex> lock(region_mutex_);
+            if (!region_.empty()) fallback_->SetRegion(region_);
+        }
+        return fallback_->Start(callback_);
+    }
+
+    void Stop() override {
+        if (fallback_) fallback_->Stop();
+        StopStream();
+    }
+
+    void SetCursorCallback(CursorCallback callback) override {
+        cursor_callback_ = std::move(callback);
+    }
+
+    void SetFrameRate(int fps) override {
+        if (fps <= 0) return;
+        fps_ = fps;
+        if (fallback_) fallback_->SetFrameRate(fps);
+    }
+
+    // Applied by offsetting into the received buffer, so cropping is free.
+    bool SetRegion(const CaptureRegion& region) override {
+        std::lock_guard<std::mutex> lock(region_mutex_);
+        region_ = region;
+        return fallback_ ? fallback_->SetRegion(region) : true;
+    }
+
+    // Monitors and windows are picked in the portal's dialog; only the X11
+    // fallback can switch to one here.
+    bool SetTarget(const CaptureTarget& target) override {
+        if (target.kind == CaptureTarget::Kind::Screen || target.kind == CaptureTarget::Kind::Region)
+            return Capture::SetTarget(target);
+        return fallback_ && fallback_->SetTarget(target);
+    }
+
+private:
+    enum class State { Connecting, Ready, Failed };
+
+    uint32_t node_;
+    FrameCallback callback_;
+    CursorCallback cursor_callback_;
+    std::unique_ptr<Capture> fallback_;
+    std::atomic<int> fps_{60};
+    std::mutex region_mutex_;
+    CaptureRegion region_{};
+
+    std::unique_ptr<ScreenCastPortal> portal_;
+    pw_thread_loop* loop_ = nullptr;
+    pw_context* context_ = nullptr;
+    pw_core* core_ = nullptr;
+    pw_stream* stream_ = nullptr;
+    spa_hook stream_listener_{};
+    bool cursor_metadata_ = false;
+
+    std::mutex state_mutex_;
+    std::condition_variable state_cv_;
+    State state_ = State::Connecting;
+
+    // Negotiated format; only touched on the PipeWire thread.
+    int width_ = 0;
+    int height_ = 0;
+    // Geometry of the last delivered frame.
+    int last_width_ = 0;
+    int last_height_ = 0;
+    int last_stride_ = 0;
+    uint32_t generation_ = 0;
+    stream::TileChangeDetector detector_;
+    uint32_t drm_format_ = kDrmFormatXRGB8888;
+    uint64_t modifier_ = kDrmFormatModLinear;
+    uint64_t last_frame_us_ = 0;
+    CursorData cursor_{};
+    std::vector<uint32_t> cursor_pixels_;
+    uint32_t cursor_serial_ = 0;
+    int origin_x_ = 0;
+    int origin_y_ = 0;
+
+    static const pw_stream_events kStreamEvents;
+
+    bool StartStream() {
+        int fd = -1;
+        uint32_t node = node_;
+        if (!node) {
+            portal_ = std::make_unique<ScreenCastPortal>();
+            if (!portal_->Open(bool(cursor_callback_)))
+                return false;
+            fd = portal_->TakeFd();
+            node = portal_->Node();
+            cursor_metadata_ = portal_->CursorMetadata();
+        } else {
+            // A direct node may or may not carry cursor metadata; ask anyway.
+            cursor_metadata_ = bool(cursor_callback_);
+        }
+
+        pw_init(nullptr, nullptr);
+        loop_ = pw_thread_loop_new("pw-capture", nullptr);
+        context_ = loop_ ? pw_context_new(pw_thread_loop_get_loop(loop_), nullptr, 0) : nullptr;
+        if (!context_ || pw_thread_loop_start(loop_) < 0) {
+            if (fd >= 0) close(fd);
+            STREAM_LOG_ERROR("PipeWire: cannot start the main loop");
+            return false;
+        }
+        // Frames arrive on the loop's thread; it gets the capture role.
+        // Blocking invokes wait for that thread, so never with the lock held.
+        pw_loop_invoke(pw_thread_loop_get_loop(loop_), &PipeWireCapture::EnterLoopThread, 0, nullptr, 0, true, nullptr);
+
+        pw_thread_loop_lock(loop_);
+        // pw_context_connect_fd takes ownership of the portal's fd.
+        core_ = fd >= 0 ? pw_context_connect_fd(context_, fd, nullptr, 0) : pw_context_connect(context_, nullptr, 0);
+        int r = -1;
+        if (core_) {
+            stream_ = pw_stream_new(core_, "stream-core screen",
+                                    pw_properties_new(PW_KEY_MEDIA_TYPE, "Video", PW_KEY_MEDIA_CATEGORY, "Capture",
+                                                      PW_KEY_MEDIA_ROLE, "Screen", nullptr));
+        }
+        if (stream_) {
+            pw_stream_add_listener(stream_, &stream_listener_, &kStreamEvents, this);
+            uint8_t buffer[2048];
+            spa_pod_builder builder;
+            spa_pod_builder_init(&builder, buffer, sizeof(buffer));
+            // DMA-BUF first; the plain formats are the shared-memory fallback.
+            const spa_pod* params[4];
+            uint32_t count = 0;
+            for (bool dmabuf : {true, false})
+                for (spa_video_format format : {SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_BGRA})
+                    params[count++] = BuildFormat(&builder, format, dmabuf, fps_);
+            r = pw_stream_connect(stream_, PW_DIRECTION_INPUT, node,
+                                  pw_stream_flags(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS), params,
+                                  count);
+        }
+        pw_thread_loop_unlock(loop_);
+        if (r < 0) {
+            STREAM_LOG_ERROR("PipeWire: cannot connect to node {}: {}", node,
+                             core_ ? spa_strerror(r) : "no PipeWire daemon");
+            return false;
+        }
+
+        // Wait for format negotiation so a refusal can still fall back.
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        state_cv_.wait_for(lock, std::chrono::seconds(5), [&] { return state_ != State::Connecting; });
+        if (state_ != State::Ready) {
+            STREAM_LOG_ERROR("PipeWire: node {} did not start streaming", node);
+            return false;
+        }
+        STREAM_LOG_INFO("PipeWire: capturing node {}", node);
+        return true;
+    }
+
+    static int EnterLoopThread(spa_loop*, bool, uint32_t, const void*, size_t, void*) {
+        stream::threadTopology().enter(stream::ThreadRole::Capture, "pw-capture");
+        return 0;
+    }
+
+    static int LeaveLoopThread(spa_loop*, bool, uint32_t, const void*, size_t, void*) {
+        stream::threadTopology().leave();
+        return 0;
+    }
+
+    void StopStream() {
+        if (loop_) pw_thread_loop_lock(loop_);
+        if (stream_) {
+            pw_stream_disconnect(stream_);
+            spa_hook_remove(&stream_listener_);
+            pw_stream_destroy(stream_);
+            stream_ = nullptr;
+        }
+        if (core_) {
+            pw_core_disconnect(core_);
+            core_ = nullptr;
+        }
+        if (loop_) {
+            pw_thread_loop_unlock(loop_);
+            pw_loop_invoke(pw_thread_loop_get_loop(loop_), &PipeWireCapture::LeaveLoopThread, 0, nullptr, 0, true,
+                           nullptr);
+            pw_thread_loop_stop(loop_);
+        }
+        if (context_) {
+            pw_context_destroy(context_);
+            context_ = nullptr;
+        }
+        if (loop_) {
+            pw_thread_loop_destroy(loop_);
+            loop_ = nullptr;
+        }
+        portal_.reset();
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        state_ = State::Connecting;
+    }
+
+    static const spa_pod* BuildFormat(spa_pod_builder* b, spa_video_format format, bool dmabuf, int fps) {
+        spa_rectangle defaultSize{1920, 1080}, minSize{1, 1}, maxSize{8192, 8192};
+        spa_fraction anyRate{0, 1}, maxRate{uint32_t(fps), 1}, minRate{1, 1};
+        spa_pod_frame frame;
+        spa_pod_builder_push_object(b, &frame, SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+        spa_pod_builder_add(b, SPA_FORMAT_mediaType, SPA_POD_Id(SPA_MEDIA_TYPE_video), 0);
+        spa_pod_builder_add(b, SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw), 0);
+        spa_pod_builder_add(b, SPA_FORMAT_VIDEO_format, SPA_POD_Id(format), 0);
+        if (dmabuf) {
+            // Mandatory, so producers without modifier support skip this
+            // entry and match the shared-memory one instead.
+            spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_modifier, SPA_POD_PROP_FLAG_MANDATORY);
+            spa_pod_builder_long(b, int64_t(kDrmFormatModLinear));
+        }
+        spa_pod_builder_add(b, SPA_FORMAT_VIDEO_size,
+                            SPA_POD_CHOICE_RANGE_Rectangle(&defaultSize, &minSize, &maxSize), 0);
+        spa_pod_builder_add(b, SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&anyRate), 0);
+        spa_pod_builder_add(b, SPA_FORMAT_VIDEO_maxFramerate,
+                            SPA_POD_CHOICE_RANGE_Fraction(&maxRate, &minRate, &maxRate), 0);
+        return static_cast<const spa_pod*>(spa_pod_builder_pop(b, &frame));
+    }
+
+    static void OnStateChanged(void* data, pw_stream_state old, pw_stream_state state, const char* error) {
+        auto* self = static_cast<PipeWireCapture*>(data);
+        if (state == PW_STREAM_STATE_ERROR)
+            STREAM_LOG_ERROR("PipeWire stream error: {}", error ? error : "unknown");
+        std::lock_guard<std::mutex> lock(self->state_mutex_);
+        if (state == PW_STREAM_STATE_PAUSED || state == PW_STREAM_STATE_STREAMING)
+            self->state_ = State::Ready;
+        else if (state == PW_STREAM_STATE_ERROR || (state == PW_STREAM_STATE_UNCONNECTED && old != state))
+            self->state_ = State::Failed;
+        self->state_cv_.notify_all();
+    }
+
+    static void OnParamChanged(void* data, uint32_t id, const spa_pod* param) {
+        auto* self = static_cast<PipeWireCapture*>(data);
+        if (!param || id != SPA_PARAM_Format)
+            return;
+        uint32_t mediaType = 0, mediaSubtype = 0;
+        spa_video_info_raw info{};
+        if (spa_format_parse(param, &mediaType, &mediaSubtype) < 0 || mediaType != SPA_MEDIA_TYPE_video ||
+            mediaSubtype != SPA_MEDIA_SUBTYPE_raw || spa_format_video_raw_parse(param, &info) < 0)
+            return;
+        self->width_ = int(info.size.width);
+        self->height_ = int(info.size.height);
+        self->drm_format_ = info.format == SPA_VIDEO_FORMAT_BGRA ? kDrmFormatARGB8888 : kDrmFormatXRGB8888;
+        self->modifier_ = info.modifier;
+        bool dmabuf = spa_pod_find_prop(param, nullptr, SPA_FORMAT_VIDEO_modifier) != nullptr;
+        STREAM_LOG_INFO("PipeWire: {}x{} {} via {}", self->width_, self->height_,
+                        info.format == SPA_VIDEO_FORMAT_BGRA ? "BGRA" : "BGRx", dmabuf ? "DMA-BUF" : "shared memory");
+
+        uint8_t buffer[1024];
+        spa_pod_builder b;
+        spa_pod_builder_init(&b, buffer, sizeof(buffer));
+        int dataTypes = dmabuf ? (1 << SPA_DATA_DmaBuf) : (1 << SPA_DATA_MemFd) | (1 << SPA_DATA_MemPtr);
+        const spa_pod* params[4];
+        uint32_t count = 0;
+        params[count++] = static_cast<const spa_pod*>(spa_pod_builder_add_object(&b,
+            SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+            SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 2, 8),
+            SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(dataTypes)));
+        params[count++] = static_cast<const spa_pod*>(spa_pod_builder_add_object(&b,
+            SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+            SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+            SPA_PARAM_META_size, SPA_POD_Int(int(sizeof(spa_meta_header)))));
+        params[count++] = static_cast<const spa_pod*>(spa_pod_builder_add_object(&b,
+            SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+            SPA_PARAM_META_type, SPA_POD_Id(SPA_META_VideoCrop),
+            SPA_PARAM_META_size, SPA_POD_Int(int(sizeof(spa_meta_region)))));
+        if (self->cursor_metadata_) {
+            params[count++] = static_cast<const spa_pod*>(spa_pod_builder_add_object(&b,
+                SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+                SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Cursor),
+                SPA_PARAM_META_size, SPA_POD_CHOICE_RANGE_Int(CursorMetaSize(64, 64), CursorMetaSize(1, 1),
+                                                              CursorMetaSize(kMaxCursorSize, kMaxCursorSize))));
+        }
+        pw_stream_update_params(self->stream_, params, count);
+    }
+
+    static void OnAddBuffer(void*, pw_buffer* buffer) {
+        spa_data& d = buffer->buffer->datas[0];
+        if (d.type != SPA_DATA_DmaBuf || d.data)
+            return;
+        size_t length = d.maxsize + d.mapoffset;
+        void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, int(d.fd), 0);
+        if (data == MAP_FAILED) {
+            STREAM_LOG_ERROR("PipeWire: cannot map DMA-BUF: {}", strerror(errno));
+            return;
+        }
+        buffer->user_data = new BufferMapping{static_cast<uint8_t*>(data), length};
+    }
+
+    static void OnRemoveBuffer(void*, pw_buffer* buffer) {
+        if (auto* mapping = static_cast<BufferMapping*>(buffer->user_data)) {
+            munmap(mapping->data, mapping->length);
+            delete mapping;
+            buffer->user_data = nullptr;
+        }
+    }
+
+    static void OnProcess(void* data) {
+        auto* self = static_cast<PipeWireCapture*>(data);
+        // Only the newest buffer matters; older ones go straight back.
+        pw_buffer* buffer = nullptr;
+        while (pw_buffer* next = pw_stream_dequeue_buffer(self->stream_)) {
+            if (buffer) pw_stream_queue_buffer(self->stream_, buffer);
+            buffer = next;
+        }
+        if (!buffer)
+            return;
+        self->ProcessBuffer(buffer);
+        pw_stream_queue_buffer(self->stream_, buffer);
+    }
+
+    void ProcessBuffer(pw_buffer* buffer) {
+        spa_buffer* buf = buffer->buffer;
+        if (cursor_metadata_ && cursor_callback_)
+            ProcessCursor(buf);
+
+        auto* header = static_cast<spa_meta_header*>(spa_buffer_find_meta_data(buf, SPA_META_Header, sizeof(spa_meta_header)));
+        if (header && (header->flags & SPA_META_HEADER_FLAG_CORRUPTED))
+            return;
+        spa_data& d = buf->datas[0];
+        // Cursor-only updates arrive with an empty chunk.
+        if (!d.chunk || d.chunk->size == 0 || (d.chunk->flags & SPA_CHUNK_FLAG_CORRUPTED))
+            return;
+
+        // The compositor sends frames as they are damaged; keep to our rate.
+        uint64_t now = NowMicros();
+        uint64_t interval = 1000000 / uint64_t(std::max(1, fps_.load()));
+        if (last_frame_us_ && now - last_frame_us_ < interval * 9 / 10)
+            return;
+        last_frame_us_ = now;
+
+        auto* mapping = static_cast<BufferMapping*>(buffer->user_data);
+        uint8_t* base = d.data ? static_cast<uint8_t*>(d.data) : mapping ? mapping->data + d.mapoffset : nullptr;
+        if (!base)
+            return;
+
+        CaptureRegion area{0, 0, width_, height_};
+        auto* crop = static_cast<spa_meta_region*>(spa_buffer_find_meta_data(buf, SPA_META_VideoCrop, sizeof(spa_meta_region)));
+        if (crop && spa_meta_region_is_valid(crop))
+            area = {crop->region.position.x, crop->region.position.y, int(crop->region.size.width),
+                    int(crop->region.size.height)};
+        {
+            std::lock_guard<std::mutex> lock(region_mutex_);
+            if (!region_.empty()) {
+                int x = std::clamp(region_.x, 0, area.width - 1);
+                int y = std::clamp(region_.y, 0, area.height - 1);
+                area = {area.x + x, area.y + y, std::min(region_.width, area.width - x),
+                        std::min(region_.height, area.height - y)};
+            }
+        }
+        if (area.width <= 0 || area.height <= 0)
+            return;
+        origin_x_ = area.x;
+        origin_y_ = area.y;
+
+        int stride = d.chunk->stride;
+        uint32_t offset = d.chunk->offset + uint32_t(area.y) * uint32_t(stride) + uint32_t(area.x) * 4;
+        bool dmabuf = d.type == SPA_DATA_DmaBuf;
+        if (dmabuf) {
+            dma_buf_sync sync{DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ};
+            ioctl(int(d.fd), DMA_BUF_IOCTL_SYNC, &sync);
+        }
+
+        if (area.width != last_width_ || area.height != last_height_ || stride != last_stride_) {
+            last_width_ = area.width;
+            last_height_ = area.height;
+            last_stride_ = stride;
+            ++generation_;
+        }
+
+        FrameData frame;
+        frame.data = base + offset;
+        frame.width = area.width;
+        frame.height = area.height;
+        frame.stride = stride;
+        frame.size = size_t(stride) * (area.height - 1) + size_t(area.width) * 4;
+        frame.timestamp = now;
+        frame.generation = generation_;
+        if (dmabuf) {
+            frame.dmabufFd = int(d.fd);
+            frame.drmFormat = drm_format_;
+            frame.drmModifier = modifier_;
+            frame.dmabufOffset = offset;
+        } else {
+            // Compositors don't reliably attach damage to screencast buffers,
+            // so shm frames are diffed here. DMA-BUF mappings are often
+            // write-combined and too slow to read twice; those frames go out
+            // without a bitmap, which means "all changed".
+            detector_.process(frame);
+        }
+        callback_(frame);
+
+        if (dmabuf) {
+            dma_buf_sync sync{DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ};
+            ioctl(int(d.fd), DMA_BUF_IOCTL_SYNC, &sync);
+        }
+    }
+
+    void ProcessCursor(spa_buffer* buf) {
+        auto* cursor = static_cast<spa_meta_cursor*>(spa_buffer_find_meta_data(buf, SPA_META_Cursor, sizeof(spa_meta_cursor)));
+        if (!cursor || !spa_meta_cursor_is_valid(cursor))
+            return;
+        const int lastX = cursor_.x, lastY = cursor_.y;
+        cursor_.pixels = nullptr;
+        if (cursor->bitmap_offset) {
+            auto* bitmap = SPA_PTROFF(cursor, cursor->bitmap_offset, spa_meta_bitmap);
+            int w = int(bitmap->size.width), h = int(bitmap->size.height);
+            bool rgba = bitmap->format == SPA_VIDEO_FORMAT_RGBA;
+            if (w > 0 && h > 0 && (rgba || bitmap->format == SPA_VIDEO_FORMAT_BGRA)) {
+                // Repack into the ARGB words CursorData carries; compositors
+                // hand out premultiplied cursor images, as XFixes does.
+                const auto* src = SPA_PTROFF(bitmap, bitmap->offset, const uint8_t);
+                cursor_pixels_.resize(size_t(w) * h);
+                for (int y = 0; y < h; ++y) {
+                    const uint8_t* row = src + size_t(y) * bitmap->stride;
+                    for (int x = 0; x < w; ++x) {
+                        const uint8_t* p = row + x * 4;
+                        uint32_t r = rgba ? p[0] : p[2], g = p[1], b = rgba ? p[2] : p[0], a = p[3];
+                        cursor_pixels_[size_t(y) * w + x] = a << 24 | r << 16 | g << 8 | b;
+                    }
+                }
+                cursor_.width = w;
+                cursor_.height = h;
+                cursor_.hotspotX = cursor->hotspot.x;
+                cursor_.hotspotY = cursor->hotspot.y;
+                cursor_.serial = ++cursor_serial_;
+                cursor_.pixels = cursor_pixels_.data();
+            }
+        }
+        cursor_.x = cursor->position.x - origin_x_;
+        cursor_.y = cursor->position.y - origin_y_;
+        if (!cursor_.pixels && cursor_.x == lastX && cursor_.y == lastY)
+            return;
+        cursor_.timestamp = NowMicros();
+        cursor_callback_(cursor_);
+        cursor_.pixels = nullptr;
+    }
+};
+
+const pw_stream_events PipeWireCapture::kStreamEvents = [] {
+    pw_stream_events events{};
+    events.version = PW_VERSION_STREAM_EVENTS;
+    events.state_changed = &PipeWireCapture::OnStateChanged;
+    events.param_changed = &PipeWireCapture::OnParamChanged;
+    events.add_buffer = &PipeWireCapture::OnAddBuffer;
+    events.remove_buffer = &PipeWireCapture::OnRemoveBuffer;
+    events.process = &PipeWireCapture::OnProcess;
+    return events;
+}();
+
+std::unique_ptr<Capture> createPipeWireCapture(uint32_t node) {
+    return std::make_unique<PipeWireCapture>(node);
+}
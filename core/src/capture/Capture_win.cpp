@@ -1,10 +1,10 @@
 #include "Capture.h"
+#include "Logger.h"
 #include <windows.h>
 #include <d3d11.h>
 #include <dxgi1_2.h>
 #include <thread>
 #include <chrono>
-#include <iostream>
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -47,7 +47,7 @@ private:
                                &d3dDevice, &featureLevel, &d3dContext);
         if (FAILED(hr))
         {
-            std::cerr << "Failed to create D3D11 device" << std::endl;
+            STREAM_LOG_ERROR("Failed to create D3D11 device");
             return;
         }
 
@@ -67,7 +67,7 @@ private:
         hr = dxgiOutput1->DuplicateOutput(d3dDevice, &duplication);
         if (FAILED(hr))
         {
-            std::cerr << "Failed to duplicate output" << std::endl;
+            STREAM_LOG_ERROR("Failed to duplicate output");
             return;
         }
 
@@ -141,3 +141,9 @@ extern "C" Capture *CreateCapture()
 {
     return new WindowsCapture();
 }
+
+std::unique_ptr<Capture> createPlatformCapture(const CaptureBackendOptions& options)
+{
+    (void)options;
+    return std::unique_ptr<Capture>(CreateCapture());
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "Capture.h"
+
+// Backends behind createPlatformCapture() on Linux.
+
+// Root window grab through XShm. Sees nothing but XWayland clients on a
+// Wayland session. Pipelined grabs overlap the server's copy of the next
+// frame with processing of the current one; servers without shared pixmaps
+// get the synchronous XShmGetImage grab either way.
+std::unique_ptr<Capture> createX11Capture(bool pipelined = true);
+
+// Screencast through PipeWire. Node 0 asks xdg-desktop-portal for a stream
+// (which may show a consent dialog); any other node is connected to
+// directly on the local PipeWire daemon. If no stream can be set up and an
+// X display is available, Start() falls back to the X11 backend.
+std::unique_ptr<Capture> createPipeWireCapture(uint32_t node);
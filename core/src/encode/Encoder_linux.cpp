@@ -1,5 +1,5 @@
 #include "Encoder.h"
-#include <iostream>
+#include "Logger.h"
 #include <vector>
 
 // ⚠ NOTE: This is a high-level placeholder to demonstrate integration.
@@ -12,28 +12,97 @@ public:
 
     bool Start(int width, int height, int fps, EncodedCallback cb) override {
         callback_ = cb;
-        std::cout << "VAAPI encoder start: " << width << "x" << height << "@" << fps << " fps" << std::endl;
+        width_ = width;
+        height_ = height;
+        surface_width_ = width;
+        surface_height_ = height;
+        keyframe_pending_ = true;
+        STREAM_LOG_INFO("VAAPI encoder start: {}x{}@{} fps", width, height, fps);
         return true;
     }
 
     void EncodeFrame(const uint8_t* data, int stride) override {
         // Hardware accelerated encoding logic with VAAPI goes here.
-        // This is a simplified dummy example.
+        // This is a simplified dummy example. roi_ becomes the
+        // VAEncMiscParameterBufferROI rectangles for this picture, and
+        // refine_pending_ its QP delta.
 
         EncodedFrame encoded;
         encoded.data = std::vector<uint8_t>(data, data + stride); // placeholder
-        encoded.isKeyFrame = true;
+        encoded.isKeyFrame = keyframe_pending_;
         encoded.timestamp = 0;
+        keyframe_pending_ = false;
+        refine_pending_ = false;
 
         callback_(encoded);
     }
 
     void Stop() override {
-        std::cout << "VAAPI encoder stopped." << std::endl;
+        STREAM_LOG_INFO("VAAPI encoder stopped.");
+    }
+
+    // VAAPI takes new rate-control parameters on the next sequence, so both
+    // apply without recreating the context.
+    bool SetBitrate(int bitsPerSecond) override {
+        bitrate_ = bitsPerSecond;
+        STREAM_LOG_INFO("VAAPI encoder bitrate: {} bps", bitsPerSecond);
+        return true;
+    }
+
+    bool SetFramerate(int fps) override {
+        fps_ = fps;
+        STREAM_LOG_INFO("VAAPI encoder framerate: {} fps", fps);
+        return true;
+    }
+
+    // Applied as a negative QP delta in the next picture's
+    // VAEncMiscParameterRateControl, for that picture only.
+    void RefineNextFrame() override { refine_pending_ = true; }
+
+    // Rows of dirty tiles merged into rectangles, as VAAPI takes a short
+    // list of ROI regions rather than a per-block map.
+    void SetDirtyTiles(const uint64_t* bitmap, int columns, int rows) override {
+        roi_.clear();
+        if (!bitmap) return;
+        for (int ty = 0; ty < rows; ++ty) {
+            int start = -1;
+            for (int tx = 0; tx <= columns; ++tx) {
+                size_t tile = size_t(ty) * columns + tx;
+                bool dirty = tx < columns && ((bitmap[tile / 64] >> (tile % 64)) & 1);
+                if (dirty && start < 0) start = tx;
+                if (!dirty && start >= 0) {
+                    roi_.push_back({start * 64, ty * 64, (tx - start) * 64, 64});
+                    start = -1;
+                }
+            }
+        }
+    }
+
+    // The context and its surfaces are allocated at the size Start() got, so
+    // a smaller or equal picture only needs a new sequence: fresh SPS/PPS
+    // and an IDR on the next frame. Anything larger needs Stop()/Start().
+    bool Reconfigure(int width, int height) override {
+        if (width > surface_width_ || height > surface_height_)
+            return false;
+        width_ = width;
+        height_ = height;
+        keyframe_pending_ = true;
+        STREAM_LOG_INFO("VAAPI encoder reconfigured: {}x{}", width, height);
+        return true;
     }
 
 private:
     EncodedCallback callback_;
+    int bitrate_ = 0;
+    int fps_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int surface_width_ = 0; // what the surfaces were allocated for
+    int surface_height_ = 0;
+    bool keyframe_pending_ = true;
+    bool refine_pending_ = false;
+    struct Rect { int x, y, width, height; };
+    std::vector<Rect> roi_;
 };
 
 extern "C" Encoder* CreateEncoder() {
@@ -1,5 +1,5 @@
 #include "Encoder.h"
-#include <iostream>
+#include "Logger.h"
 
 // ⚠ NOTE: Requires NVIDIA Video Codec SDK installed and linked properly!
 // This is a simplified interface stub. Full production encoder is larger.
@@ -11,9 +11,12 @@ public:
 
     bool Start(int width, int height, int fps, EncodedCallback callback) override {
         callback_ = callback;
+        keyframe_pending_ = true;
+        max_width_ = width;
+        max_height_ = height;
         // Initialize NVENC session here
         // Load NVENC DLL dynamically, create encoder session
-        std::cout << "NVENC Start (" << width << "x" << height << "@" << fps << ")" << std::endl;
+        STREAM_LOG_INFO("NVENC Start ({}x{}@{})", width, height, fps);
         return true;
     }
 
@@ -22,19 +25,34 @@ public:
         // This is simplified — normally requires GPU memory buffers
         EncodedFrame encoded;
         encoded.data = std::vector<uint8_t>(data, data + stride); // placeholder only
-        encoded.isKeyFrame = true;
+        encoded.isKeyFrame = keyframe_pending_;
         encoded.timestamp = 0;
+        keyframe_pending_ = false;
 
         callback_(encoded);
     }
 
     void Stop() override {
         // Destroy NVENC session here
-        std::cout << "NVENC stopped." << std::endl;
+        STREAM_LOG_INFO("NVENC stopped.");
+    }
+
+    // nvEncReconfigureEncoder with resetEncoder and forceIDR set changes
+    // the resolution up to the session's maxEncodeWidth/Height in place.
+    // Those are the Start() size; anything larger needs a new session.
+    bool Reconfigure(int width, int height) override {
+        if (width > max_width_ || height > max_height_)
+            return false;
+        keyframe_pending_ = true;
+        STREAM_LOG_INFO("NVENC reconfigured ({}x{})", width, height);
+        return true;
     }
 
 private:
     EncodedCallback callback_;
+    bool keyframe_pending_ = true;
+    int max_width_ = 0; // maxEncodeWidth/Height of the session
+    int max_height_ = 0;
 };
 
 extern "C" Encoder* CreateEncoder() {
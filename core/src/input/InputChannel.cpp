@@ -0,0 +1,182 @@
+#include "InputChannel.h"
+#include "InputProtocol.h"
+#include "ThreadTopology.h"
+
+namespace stream {
+
+InputChannel::InputChannel(InputInjector& injector) : injector_(injector) {}
+
+InputChannel::~InputChannel() { stop(); }
+
+void InputChannel::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    thread_ = std::thread(&InputChannel::run, this);
+}
+
+void InputChannel::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void InputChannel::onMessage(const uint8_t* data, size_t size) {
+    Pending msg{std::vector<uint8_t>(data, data + size), Clock::now()};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(msg));
+    }
+    cv_.notify_one();
+}
+
+void InputChannel::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.clear();
+    resetPending_ = true;
+}
+
+InputChannel::Stats InputChannel::stats() const {
+    Stats s{};
+    s.messages = messages_.load(std::memory_order_relaxed);
+    s.malformed = malformed_.load(std::memory_order_relaxed);
+    s.events = events_.load(std::memory_order_relaxed);
+    s.injected = injected_.load(std::memory_order_relaxed);
+    s.coalescedMoves = coalescedMoves_.load(std::memory_order_relaxed);
+    s.duplicates = duplicates_.load(std::memory_order_relaxed);
+    s.staleMoves = staleMoves_.load(std::memory_order_relaxed);
+    s.staleKeys = staleKeys_.load(std::memory_order_relaxed);
+    uint64_t samples = latencySamples_.load(std::memory_order_relaxed);
+    s.meanLatencyMicros = samples ? latencySumMicros_.load(std::memory_order_relaxed) / samples : 0;
+    s.maxLatencyMicros = latencyMaxMicros_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void InputChannel::run() {
+    ThreadScope scope(ThreadRole::Control, "input");
+    std::vector<Pending> batch;
+    std::vector<InputEvent> decoded;
+    std::vector<InputEvent> coalesced;
+    for (;;) {
+        bool fresh;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !running_ || !pending_.empty(); });
+            if (!running_ && pending_.empty()) return;
+            batch.swap(pending_);
+            fresh = resetPending_;
+            resetPending_ = false;
+        }
+        if (fresh) clearSequenceState();
+        process(batch, decoded, coalesced);
+        batch.clear();
+    }
+}
+
+void InputChannel::clearSequenceState() {
+    anySeen_ = false;
+    highestSeq_ = 0;
+    seenWindow_ = 0;
+    anyMove_ = false;
+    lastMoveSeq_ = 0;
+    lastKeySeq_.clear();
+}
+
+// Sliding 64-entry replay window over sequence numbers, so events repeated
+// by the viewer for redundancy are applied exactly once.
+bool InputChannel::markSeen(uint32_t seq) {
+    if (!anySeen_) {
+        anySeen_ = true;
+        highestSeq_ = seq;
+        seenWindow_ = 1;
+        return true;
+    }
+    int32_t diff = int32_t(seq - highestSeq_);
+    if (diff > 0) {
+        seenWindow_ = diff >= 64 ? 0 : seenWindow_ << diff;
+        seenWindow_ |= 1;
+        highestSeq_ = seq;
+        return true;
+    }
+    uint32_t back = uint32_t(-int64_t(diff));
+    if (back >= 64) return false;
+    uint64_t bit = uint64_t(1) << back;
+    if (seenWindow_ & bit) return false;
+    seenWindow_ |= bit;
+    return true;
+}
+
+void InputChannel::process(std::vector<Pending>& batch, std::vector<InputEvent>& decoded, std::vector<InputEvent>& coalesced) {
+    decoded.clear();
+    coalesced.clear();
+    for (const Pending& msg : batch) {
+        messages_.fetch_add(1, std::memory_order_relaxed);
+        if (!decodeInputBatch(msg.bytes.data(), msg.bytes.size(), decoded))
+            malformed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    events_.fetch_add(decoded.size(), std::memory_order_relaxed);
+
+    for (const InputEvent& ev : decoded) {
+        if (!markSeen(ev.seq)) {
+            duplicates_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (ev.type == InputEvent::Type::MouseMove) {
+            // A reordered move older than one already applied would make the
+            // pointer jump backwards.
+            if (anyMove_ && int32_t(ev.seq - lastMoveSeq_) < 0) {
+                staleMoves_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            anyMove_ = true;
+            lastMoveSeq_ = ev.seq;
+            // Only the final position of a run of moves matters; moves around
+            // a button event are kept so drags start and end in place.
+            if (!coalesced.empty() && coalesced.back().type == InputEvent::Type::MouseMove) {
+                coalesced.back() = ev;
+                coalescedMoves_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+        } else {
+            // Same for a key-down arriving after its key-up: applying it
+            // would leave the key stuck.
+            uint32_t id = uint32_t(ev.type) << 16 | uint32_t(ev.code & 0xFFFF);
+            auto [it, first] = lastKeySeq_.try_emplace(id, ev.seq);
+            if (!first) {
+                if (int32_t(ev.seq - it->second) < 0) {
+                    staleKeys_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                it->second = ev.seq;
+            }
+        }
+        coalesced.push_back(ev);
+    }
+
+    for (InputEvent& ev : coalesced) {
+        if (ev.type == InputEvent::Type::MouseMove) {
+            lastX_ = ev.x;
+            lastY_ = ev.y;
+        } else if (ev.type == InputEvent::Type::MouseButton) {
+            ev.x = lastX_;
+            ev.y = lastY_;
+        }
+    }
+    injector_.injectBatch(coalesced);
+    injected_.fetch_add(coalesced.size(), std::memory_order_relaxed);
+
+    Clock::time_point done = Clock::now();
+    for (const Pending& msg : batch) {
+        uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(done - msg.received).count();
+        latencySumMicros_.fetch_add(us, std::memory_order_relaxed);
+        latencySamples_.fetch_add(1, std::memory_order_relaxed);
+        if (us > latencyMaxMicros_.load(std::memory_order_relaxed))
+            latencyMaxMicros_.store(us, std::memory_order_relaxed);
+    }
+}
+
+} // namespace stream
@@ -1,7 +1,14 @@
 #include "InputInjector.h"
+#include "UInputInjector.h"
+#include "Logger.h"
 #include <X11/Xlib.h>
 #include <X11/extensions/XTest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <string>
 
 namespace stream {
 class LinuxInputInjector : public InputInjector {
@@ -12,20 +19,89 @@ public:
     ~LinuxInputInjector() {
         if (display_) XCloseDisplay(display_);
     }
+    bool isOpen() const { return display_ != nullptr; }
     void injectMouse(int x, int y, int button, bool down) override {
-        XWarpPointer(display_, None, DefaultRootWindow(display_), 0, 0, 0, 0, x, y);
-        XTestFakeButtonEvent(display_, button, down, 0);
+        if (!display_) return;
+        XTestFakeMotionEvent(display_, -1, x, y, CurrentTime);
+        if (button > 0)
+            XTestFakeButtonEvent(display_, button, down, CurrentTime);
         XFlush(display_);
     }
     void injectKeyboard(int key, bool down) override {
-        XTestFakeKeyEvent(display_, key, down, 0);
+        if (!display_) return;
+        XTestFakeKeyEvent(display_, key, down, CurrentTime);
+        XFlush(display_);
+    }
+    // Consecutive moves collapse to the last one and the whole batch goes out
+    // in a single flush, so high-rate mice don't saturate the X connection.
+    void injectBatch(std::span<const InputEvent> events) override {
+        if (!display_ || events.empty()) return;
+        for (size_t i = 0; i < events.size(); ++i) {
+            const InputEvent& ev = events[i];
+            switch (ev.type) {
+            case InputEvent::Type::MouseMove:
+                if (i + 1 < events.size() && events[i + 1].type == InputEvent::Type::MouseMove)
+                    continue;
+                XTestFakeMotionEvent(display_, -1, ev.x, ev.y, CurrentTime);
+                break;
+            case InputEvent::Type::MouseButton:
+                XTestFakeButtonEvent(display_, ev.code, ev.down, CurrentTime);
+                break;
+            case InputEvent::Type::Key:
+                XTestFakeKeyEvent(display_, ev.code, ev.down, CurrentTime);
+                break;
+            }
+        }
         XFlush(display_);
     }
 private:
     Display* display_;
 };
 
+// Size of the first connected DRM output, used to scale the uinput
+// absolute axes when there is no X server to ask.
+static void connectedScreenSize(int& width, int& height) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/class/drm", ec)) {
+        std::ifstream status(entry.path() / "status");
+        std::string state;
+        if (!(status >> state) || state != "connected") continue;
+        std::ifstream modes(entry.path() / "modes");
+        std::string mode;
+        int w = 0, h = 0;
+        if (modes >> mode && sscanf(mode.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+            width = w;
+            height = h;
+            return;
+        }
+    }
+}
+
+// XTest only reaches X clients, so on a Wayland session (where the display
+// may just be XWayland) or with no display at all, go through uinput.
 std::unique_ptr<InputInjector> createPlatformInputInjector() {
-    return std::make_unique<LinuxInputInjector>();
+    const char* session = getenv("XDG_SESSION_TYPE");
+    bool wayland = session && std::string(session) == "wayland";
+    if (!wayland) {
+        auto x11 = std::make_unique<LinuxInputInjector>();
+        if (x11->isOpen()) return x11;
+    }
+
+    int width = 1920, height = 1080;
+    connectedScreenSize(width, height);
+    if (auto uinput = UInputInjector::create(width, height)) {
+        log_info("Injecting input through uinput (" +
+                 std::to_string(width) + "x" + std::to_string(height) + ")");
+        return uinput;
+    }
+    if (wayland) {
+        auto x11 = std::make_unique<LinuxInputInjector>();
+        if (x11->isOpen()) {
+            log_error("uinput unavailable, falling back to XTest (XWayland clients only)");
+            return x11;
+        }
+    }
+    log_error("No X display and uinput unavailable, input injection disabled");
+    return nullptr;
 }
 } // namespace stream
@@ -0,0 +1,203 @@
+#include "UInputInjector.h"
+#include "Logger.h"
+#include <linux/uinput.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+namespace stream {
+namespace {
+
+int openDevice() {
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        log_error(std::string("uinput: cannot open /dev/uinput: ") + strerror(errno));
+        return -1;
+    }
+    return fd;
+}
+
+bool finishDevice(int fd, const char* name) {
+    uinput_setup setup{};
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1209; // pid.codes open source vendor id
+    setup.id.product = 0x5354;
+    strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        log_error(std::string("uinput: cannot create ") + name + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+int createPointer(int width, int height) {
+    int fd = openDevice();
+    if (fd < 0) return -1;
+    bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) >= 0 &&
+              ioctl(fd, UI_SET_KEYBIT, BTN_LEFT) >= 0 &&
+              ioctl(fd, UI_SET_KEYBIT, BTN_RIGHT) >= 0 &&
+              ioctl(fd, UI_SET_KEYBIT, BTN_MIDDLE) >= 0 &&
+              ioctl(fd, UI_SET_EVBIT, EV_REL) >= 0 &&
+              ioctl(fd, UI_SET_RELBIT, REL_WHEEL) >= 0 &&
+              ioctl(fd, UI_SET_EVBIT, EV_ABS) >= 0 &&
+              ioctl(fd, UI_SET_ABSBIT, ABS_X) >= 0 &&
+              ioctl(fd, UI_SET_ABSBIT, ABS_Y) >= 0 &&
+              ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_POINTER) >= 0;
+    uinput_abs_setup abs{};
+    abs.code = ABS_X;
+    abs.absinfo.maximum = width - 1;
+    ok = ok && ioctl(fd, UI_ABS_SETUP, &abs) >= 0;
+    abs.code = ABS_Y;
+    abs.absinfo.maximum = height - 1;
+    ok = ok && ioctl(fd, UI_ABS_SETUP, &abs) >= 0;
+    if (!ok || !finishDevice(fd, "Stream Remote Pointer")) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int createKeyboard() {
+    int fd = openDevice();
+    if (fd < 0) return -1;
+    bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) >= 0;
+    for (int key = KEY_ESC; ok && key <= KEY_MICMUTE; ++key)
+        ok = ioctl(fd, UI_SET_KEYBIT, key) >= 0;
+    if (!ok || !finishDevice(fd, "Stream Remote Keyboard")) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void destroyDevice(int fd) {
+    if (fd < 0) return;
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+}
+
+} // namespace
+
+std::unique_ptr<UInputInjector> UInputInjector::create(int width, int height) {
+    int pointer = createPointer(width, height);
+    if (pointer < 0) return nullptr;
+    int keyboard = createKeyboard();
+    if (keyboard < 0) {
+        destroyDevice(pointer);
+        return nullptr;
+    }
+    return std::make_unique<UInputInjector>(pointer, keyboard);
+}
+
+UInputInjector::UInputInjector(int pointerFd, int keyboardFd)
+    : pointerFd_(pointerFd), keyboardFd_(keyboardFd) {
+    pending_.reserve(64);
+}
+
+UInputInjector::~UInputInjector() {
+    destroyDevice(pointerFd_);
+    destroyDevice(keyboardFd_);
+}
+
+void UInputInjector::injectMouse(int x, int y, int button, bool down) {
+    InputEvent ev{};
+    ev.type = button > 0 ? InputEvent::Type::MouseButton : InputEvent::Type::MouseMove;
+    ev.x = x;
+    ev.y = y;
+    ev.code = button;
+    ev.down = down;
+    injectBatch({&ev, 1});
+}
+
+void UInputInjector::injectKeyboard(int key, bool down) {
+    InputEvent ev{};
+    ev.type = InputEvent::Type::Key;
+    ev.code = key;
+    ev.down = down;
+    injectBatch({&ev, 1});
+}
+
+// Events for the same device are gathered into one input_event array and
+// written with a single write(); switching devices flushes first so a
+// modifier still brackets the click it belongs to.
+void UInputInjector::injectBatch(std::span<const InputEvent> events) {
+    for (size_t i = 0; i < events.size(); ++i) {
+        const InputEvent& ev = events[i];
+        if (ev.type == InputEvent::Type::MouseMove && i + 1 < events.size() &&
+            events[i + 1].type == InputEvent::Type::MouseMove)
+            continue;
+        append(ev);
+    }
+    flush();
+}
+
+void UInputInjector::emit(int fd, uint16_t type, uint16_t code, int32_t value) {
+    if (fd != pendingFd_) {
+        flush();
+        pendingFd_ = fd;
+    }
+    input_event e{};
+    e.type = type;
+    e.code = code;
+    e.value = value;
+    pending_.push_back(e);
+}
+
+void UInputInjector::sync(int fd) {
+    emit(fd, EV_SYN, SYN_REPORT, 0);
+}
+
+// Skipped when the pointer is already there, e.g. a click after its move.
+void UInputInjector::moveTo(int x, int y) {
+    if (x == lastX_ && y == lastY_) return;
+    emit(pointerFd_, EV_ABS, ABS_X, x);
+    emit(pointerFd_, EV_ABS, ABS_Y, y);
+    sync(pointerFd_);
+    lastX_ = x;
+    lastY_ = y;
+}
+
+void UInputInjector::append(const InputEvent& ev) {
+    switch (ev.type) {
+    case InputEvent::Type::MouseMove:
+        moveTo(ev.x, ev.y);
+        break;
+    case InputEvent::Type::MouseButton:
+        if (ev.code < 1 || ev.code > 5) return;
+        // The click lands at the event's position, as on X11.
+        moveTo(ev.x, ev.y);
+        // X button numbering: 1 left, 2 middle, 3 right, 4/5 wheel.
+        switch (ev.code) {
+        case 1: emit(pointerFd_, EV_KEY, BTN_LEFT, ev.down); break;
+        case 2: emit(pointerFd_, EV_KEY, BTN_MIDDLE, ev.down); break;
+        case 3: emit(pointerFd_, EV_KEY, BTN_RIGHT, ev.down); break;
+        case 4: if (ev.down) emit(pointerFd_, EV_REL, REL_WHEEL, 1); break;
+        case 5: if (ev.down) emit(pointerFd_, EV_REL, REL_WHEEL, -1); break;
+        default: return;
+        }
+        sync(pointerFd_);
+        break;
+    case InputEvent::Type::Key:
+        if (ev.code < 8) return;
+        emit(keyboardFd_, EV_KEY, uint16_t(ev.code - 8), ev.down);
+        sync(keyboardFd_);
+        break;
+    }
+}
+
+bool UInputInjector::flush() {
+    if (pending_.empty()) return true;
+    size_t bytes = pending_.size() * sizeof(input_event);
+    ssize_t written = write(pendingFd_, pending_.data(), bytes);
+    pending_.clear();
+    if (written != (ssize_t)bytes) {
+        log_error(std::string("uinput: short write: ") + (written < 0 ? strerror(errno) : "partial"));
+        return false;
+    }
+    return true;
+}
+
+} // namespace stream
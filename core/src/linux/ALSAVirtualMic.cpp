@@ -1,43 +1,152 @@
-#include <alsa/asoundlib.h>
-#include <iostream>
+#include "../../include/ALSAVirtualMic.h"
+#include "../../include/Logger.h"
+#include "../../include/ThreadTopology.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <vector>
 
-class ALSAVirtualMic {
-public:
-    ALSAVirtualMic(const std::string& device) : deviceName_(device), handle_(nullptr) {}
+ALSAVirtualMic::ALSAVirtualMic(const std::string& device) : backend_(createAlsaPcmBackend(device)) {}
 
-    bool Open() {
-        int rc = snd_pcm_open(&handle_, deviceName_.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
-        if (rc < 0) {
-            std::cerr << "Unable to open PCM device: " << snd_strerror(rc) << std::endl;
-            return false;
+ALSAVirtualMic::ALSAVirtualMic(std::unique_ptr<PcmBackend> backend) : backend_(std::move(backend)) {}
+
+ALSAVirtualMic::~ALSAVirtualMic() {
+    Close();
+}
+
+bool ALSAVirtualMic::Open(const Params& params) {
+    Close();
+    config_.sampleRate = params.sampleRate;
+    config_.channels = params.channels;
+    config_.periodFrames = std::max(1u, unsigned(uint64_t(params.sampleRate) * params.periodMicros / 1000000));
+    config_.periods = std::max(2u, params.periods);
+    if (!backend_ || !backend_->Open(config_))
+        return false;
+    size_t ringFrames = std::max<size_t>(size_t(config_.sampleRate) * params.ringMillis / 1000,
+                                         size_t(config_.periodFrames) * config_.periods);
+    ring_ = std::make_unique<stream::SpscRing<int16_t>>(ringFrames * config_.channels);
+    targetFrames_ = std::max<size_t>(size_t(config_.sampleRate) * params.targetMillis / 1000, config_.periodFrames);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC);
+    thread_ = std::thread(&ALSAVirtualMic::RefillLoop, this);
+    STREAM_LOG_INFO("virtual mic: {} Hz, {} ch, period {} frames x {}", config_.sampleRate, config_.channels,
+                    config_.periodFrames, config_.periods);
+    return true;
+}
+
+size_t ALSAVirtualMic::Write(const int16_t* buffer, size_t frames) {
+    if (!ring_)
+        return 0;
+    // Whole frames only: the power-of-two ring needn't hold a multiple of
+    // the channel count, and a partial frame would shift the interleaving.
+    const size_t ch = config_.channels;
+    size_t room = (ring_->capacity() - ring_->size()) / ch;
+    size_t accepted = ring_->write(buffer, std::min(frames, room) * ch) / ch;
+    if (accepted < frames)
+        dropped_frames_.fetch_add(frames - accepted, std::memory_order_relaxed);
+    return accepted;
+}
+
+void ALSAVirtualMic::Close() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        (void)!write(wakeFd_, &one, sizeof(one));
+        thread_.join();
+    }
+    if (wakeFd_ >= 0)
+        close(wakeFd_);
+    wakeFd_ = -1;
+    if (backend_)
+        backend_->Close();
+    ring_.reset();
+}
+
+ALSAVirtualMic::Stats ALSAVirtualMic::GetStats() const {
+    return {frames_played_.load(std::memory_order_relaxed), silence_frames_.load(std::memory_order_relaxed),
+            dropped_frames_.load(std::memory_order_relaxed), trimmed_frames_.load(std::memory_order_relaxed),
+            xruns_.load(std::memory_order_relaxed)};
+}
+
+void ALSAVirtualMic::RefillLoop() {
+    stream::ThreadScope scope(stream::ThreadRole::Audio, "virtual-mic");
+    pollfd fds[8];
+    for (;;) {
+        fds[0] = {wakeFd_, POLLIN, 0};
+        int n = backend_->PollDescriptors(fds + 1, 7);
+        if (poll(fds, nfds_t(n + 1), -1) < 0) {
+            if (errno == EINTR) continue;
+            STREAM_LOG_ERROR("virtual mic: poll failed");
+            return;
         }
-        snd_pcm_set_params(handle_,
-                           SND_PCM_FORMAT_S16_LE,
-                           SND_PCM_ACCESS_RW_INTERLEAVED,
-                           2, 44100, 1, 500000); // 0.5 sec latency
-        return true;
+        if (fds[0].revents)
+            return;
+        if (backend_->Writable(fds + 1, n) && !Refill())
+            return;
     }
+}
 
-    bool Write(const int16_t* buffer, size_t frames) {
-        int rc = snd_pcm_writei(handle_, buffer, frames);
-        if (rc < 0) {
-            snd_pcm_prepare(handle_);
-            std::cerr << "ALSA write error: " << snd_strerror(rc) << std::endl;
+// Moves as much as the device will take from the ring, topping up to at
+// least one period with silence so the device always has something queued.
+// Whatever is left beyond the target depth once the device is full is
+// latency, so the oldest of it is dropped.
+bool ALSAVirtualMic::Refill() {
+    long avail = backend_->Available();
+    if (avail < 0) {
+        xruns_.fetch_add(1, std::memory_order_relaxed);
+        STREAM_LOG_EVERY_MS(stream::LogLevel::Warn, 1000, "virtual mic: xrun ({})", avail);
+        if (!backend_->Recover(int(avail))) {
+            STREAM_LOG_ERROR("virtual mic: device lost");
             return false;
         }
         return true;
     }
-
-    void Close() {
-        if (handle_) snd_pcm_close(handle_);
-        handle_ = nullptr;
+    const unsigned ch = config_.channels;
+    unsigned long want = (unsigned long)avail;
+    unsigned long written = 0;
+    while (written < want) {
+        std::span<const int16_t> run = ring_->readable();
+        const int16_t* data = run.data();
+        unsigned long frames = std::min<unsigned long>(run.size() / ch, want - written);
+        // With 3 or 6 channels a frame can straddle the ring's wrap; it is
+        // copied out whole so the run after it starts aligned.
+        static thread_local std::vector<int16_t> straddling;
+        if (frames == 0 && !run.empty() && ring_->size() >= ch) {
+            straddling.resize(ch);
+            ring_->read(straddling.data(), ch);
+            data = straddling.data();
+            frames = 1;
+        } else if (frames == 0) {
+            break;
+        }
+        long r = backend_->WriteFrames(data, frames);
+        if (r == -EAGAIN)
+            break;
+        if (r < 0) {
+            xruns_.fetch_add(1, std::memory_order_relaxed);
+            return backend_->Recover(int(r));
+        }
+        if (data != straddling.data())
+            ring_->consume(size_t(r) * ch);
+        written += (unsigned long)r;
+        if ((unsigned long)r < frames)
+            break;
     }
+    frames_played_.fetch_add(written, std::memory_order_relaxed);
 
-    ~ALSAVirtualMic() {
-        Close();
+    size_t queued = ring_->size() / ch;
+    if (written == want && queued > targetFrames_) {
+        size_t excess = queued - targetFrames_;
+        ring_->consume(excess * ch);
+        trimmed_frames_.fetch_add(excess, std::memory_order_relaxed);
     }
 
-private:
-    std::string deviceName_;
-    snd_pcm_t* handle_;
-};
+    if (written < config_.periodFrames && want >= config_.periodFrames) {
+        static thread_local std::vector<int16_t> silence;
+        unsigned long pad = config_.periodFrames - written;
+        silence.assign(pad * ch, 0);
+        long r = backend_->WriteFrames(silence.data(), pad);
+        if (r > 0)
+            silence_frames_.fetch_add(uint64_t(r), std::memory_order_relaxed);
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+#include "../../include/ALSAVirtualMic.h"
+#include "../../include/Logger.h"
+#include <alsa/asoundlib.h>
+
+// Playback PCM opened non-blocking with mmap access when the device allows
+// it (snd_pcm_mmap_writei copies straight into the DMA area).
+class AlsaPcmBackend : public PcmBackend {
+public:
+    explicit AlsaPcmBackend(const std::string& device) : deviceName_(device) {}
+    ~AlsaPcmBackend() override { Close(); }
+
+    bool Open(PcmConfig& config) override {
+        int rc = snd_pcm_open(&handle_, deviceName_.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+        if (rc < 0) {
+            STREAM_LOG_ERROR("virtual mic: cannot open PCM {}: {}", deviceName_, snd_strerror(rc));
+            return false;
+        }
+        snd_pcm_hw_params_t* hw;
+        snd_pcm_hw_params_alloca(&hw);
+        snd_pcm_hw_params_any(handle_, hw);
+        mmap_ = snd_pcm_hw_params_set_access(handle_, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+        if (!mmap_)
+            snd_pcm_hw_params_set_access(handle_, hw, SND_PCM_ACCESS_RW_INTERLEAVED);
+        snd_pcm_hw_params_set_format(handle_, hw, SND_PCM_FORMAT_S16_LE);
+        snd_pcm_hw_params_set_channels(handle_, hw, config.channels);
+        unsigned rate = config.sampleRate;
+        snd_pcm_hw_params_set_rate_near(handle_, hw, &rate, nullptr);
+        snd_pcm_uframes_t period = config.periodFrames;
+        snd_pcm_hw_params_set_period_size_near(handle_, hw, &period, nullptr);
+        snd_pcm_uframes_t buffer = period * config.periods;
+        snd_pcm_hw_params_set_buffer_size_near(handle_, hw, &buffer);
+        if ((rc = snd_pcm_hw_params(handle_, hw)) < 0) {
+            STREAM_LOG_ERROR("virtual mic: hw params: {}", snd_strerror(rc));
+            Close();
+            return false;
+        }
+
+        // Wake us once per period and start as soon as one period is queued.
+        snd_pcm_sw_params_t* sw;
+        snd_pcm_sw_params_alloca(&sw);
+        snd_pcm_sw_params_current(handle_, sw);
+        snd_pcm_sw_params_set_avail_min(handle_, sw, period);
+        snd_pcm_sw_params_set_start_threshold(handle_, sw, period);
+        if ((rc = snd_pcm_sw_params(handle_, sw)) < 0) {
+            STREAM_LOG_ERROR("virtual mic: sw params: {}", snd_strerror(rc));
+            Close();
+            return false;
+        }
+        config.sampleRate = rate;
+        config.periodFrames = unsigned(period);
+        config.periods = unsigned(buffer / period);
+        if (rate != 48000 && rate != 44100)
+            STREAM_LOG_WARN("virtual mic: device runs at {} Hz", rate);
+        return true;
+    }
+
+    void Close() override {
+        if (handle_) snd_pcm_close(handle_);
+        handle_ = nullptr;
+    }
+
+    int PollDescriptors(pollfd* fds, int max) override {
+        return snd_pcm_poll_descriptors(handle_, fds, unsigned(max));
+    }
+
+    bool Writable(pollfd* fds, int count) override {
+        unsigned short revents = 0;
+        snd_pcm_poll_descriptors_revents(handle_, fds, unsigned(count), &revents);
+        return revents & (POLLOUT | POLLERR);
+    }
+
+    long Available() override {
+        // -EPIPE once the device has run dry.
+        return long(snd_pcm_avail_update(handle_));
+    }
+
+    long WriteFrames(const int16_t* data, unsigned long frames) override {
+        return long(mmap_ ? snd_pcm_mmap_writei(handle_, data, frames) : snd_pcm_writei(handle_, data, frames));
+    }
+
+    bool Recover(int err) override {
+        return snd_pcm_recover(handle_, err, 1) == 0;
+    }
+
+private:
+    std::string deviceName_;
+    snd_pcm_t* handle_ = nullptr;
+    bool mmap_ = false;
+};
+
+std::unique_ptr<PcmBackend> createAlsaPcmBackend(const std::string& device) {
+    return std::make_unique<AlsaPcmBackend>(device);
+}
@@ -0,0 +1,313 @@
+#include "../../include/FrameBus.h"
+#include "../../include/Logger.h"
+#include "../../include/ThreadTopology.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace stream {
+namespace {
+
+constexpr size_t kPage = 4096;
+
+size_t headerBytes(uint32_t slotCount) {
+    size_t bytes = sizeof(framebus::Header) + (slotCount - 1) * sizeof(framebus::SlotHeader);
+    return (bytes + kPage - 1) & ~(kPage - 1);
+}
+
+size_t roundToPage(size_t bytes) { return (bytes + kPage - 1) & ~(kPage - 1); }
+
+// Sent once per connection alongside the two descriptors.
+struct Hello {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t mappedBytes;
+};
+
+bool sendFds(int socketFd, const Hello& hello, int memFd, int eventFd) {
+    iovec iov{const_cast<Hello*>(&hello), sizeof(hello)};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    int fds[2] = {memFd, eventFd};
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    return sendmsg(socketFd, &msg, MSG_NOSIGNAL) == ssize_t(sizeof(hello));
+}
+
+bool receiveFds(int socketFd, Hello& hello, int& memFd, int& eventFd) {
+    iovec iov{&hello, sizeof(hello)};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(socketFd, &msg, MSG_CMSG_CLOEXEC) != ssize_t(sizeof(hello))) return false;
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int))) return false;
+    int fds[2];
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    memFd = fds[0];
+    eventFd = fds[1];
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<FrameBusWriter> FrameBusWriter::create(const std::string& socketPath, uint32_t slotCount,
+                                                       uint32_t slotBytes) {
+    sockaddr_un addr{};
+    if (slotCount < 2 || slotBytes == 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+        log_error("Frame bus: invalid parameters for " + socketPath);
+        return nullptr;
+    }
+    std::unique_ptr<FrameBusWriter> bus(new FrameBusWriter());
+    bus->slotCount_ = slotCount;
+    bus->slotBytes_ = uint32_t(roundToPage(slotBytes));
+    size_t headerSize = headerBytes(slotCount);
+    bus->mappedBytes_ = headerSize + size_t(slotCount) * bus->slotBytes_;
+
+    bus->memFd_ = memfd_create("stream-frame-bus", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (bus->memFd_ < 0 || ftruncate(bus->memFd_, off_t(bus->mappedBytes_)) < 0) {
+        log_error(std::string("Frame bus: memfd: ") + strerror(errno));
+        return nullptr;
+    }
+    // Consumers get the same fd; stop them from resizing it under us.
+    fcntl(bus->memFd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    void* mem = mmap(nullptr, bus->mappedBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, bus->memFd_, 0);
+    if (mem == MAP_FAILED) {
+        log_error(std::string("Frame bus: mmap: ") + strerror(errno));
+        return nullptr;
+    }
+    // Slots are written by publish() on the capture thread; keep them on
+    // its node. Consumers on other nodes read each frame once.
+    threadTopology().bindToNode(mem, bus->mappedBytes_, ThreadRole::Capture);
+    bus->base_ = static_cast<uint8_t*>(mem);
+    bus->header_ = new (mem) framebus::Header{};
+    bus->header_->magic = framebus::kMagic;
+    bus->header_->version = framebus::kVersion;
+    bus->header_->slotCount = slotCount;
+    bus->header_->slotBytes = bus->slotBytes_;
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        framebus::SlotHeader* slot = new (&bus->header_->slots[i]) framebus::SlotHeader{};
+        slot->dataOffset = headerSize + uint64_t(i) * bus->slotBytes_;
+    }
+
+    bus->listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bus->listenFd_ < 0 || bind(bus->listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(bus->listenFd_, 8) < 0) {
+        log_error("Frame bus: bind " + socketPath + ": " + strerror(errno));
+        return nullptr;
+    }
+    bus->path_ = socketPath;
+    bus->wakeFd_ = eventfd(0, EFD_CLOEXEC);
+    bus->thread_ = std::thread(&FrameBusWriter::run, bus.get());
+    return bus;
+}
+
+FrameBusWriter::~FrameBusWriter() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        (void)!write(wakeFd_, &one, sizeof(one));
+        thread_.join();
+    }
+    for (const Consumer& c : consumers_) {
+        close(c.socketFd);
+        close(c.eventFd);
+    }
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        unlink(path_.c_str());
+    }
+    if (wakeFd_ >= 0) close(wakeFd_);
+    if (base_) munmap(base_, mappedBytes_);
+    if (memFd_ >= 0) close(memFd_);
+}
+
+uint8_t* FrameBusWriter::beginFrame() {
+    framebus::SlotHeader& slot = header_->slots[nextIndex_ % slotCount_];
+    // Odd sequence marks the slot as being rewritten; the release fence
+    // keeps the data writes below from moving ahead of it.
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return base_ + slot.dataOffset;
+}
+
+void FrameBusWriter::commitFrame(const FrameBusInfo& info) {
+    framebus::SlotHeader& slot = header_->slots[nextIndex_ % slotCount_];
+    slot.info = info;
+    slot.info.index = nextIndex_;
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    header_->latest.store(nextIndex_, std::memory_order_release);
+    ++nextIndex_;
+    notify();
+}
+
+bool FrameBusWriter::publish(const uint8_t* data, const FrameBusInfo& info) {
+    if (info.size > slotBytes_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    {
+        // Nobody to copy for.
+        std::lock_guard<std::mutex> lock(consumersMutex_);
+        if (consumers_.empty()) return true;
+    }
+    memcpy(beginFrame(), data, info.size);
+    commitFrame(info);
+    return true;
+}
+
+size_t FrameBusWriter::consumers() const {
+    std::lock_guard<std::mutex> lock(consumersMutex_);
+    return consumers_.size();
+}
+
+void FrameBusWriter::notify() {
+    uint64_t one = 1;
+    std::lock_guard<std::mutex> lock(consumersMutex_);
+    for (const Consumer& c : consumers_)
+        (void)!write(c.eventFd, &one, sizeof(one));
+}
+
+void FrameBusWriter::run() {
+    ThreadScope scope(ThreadRole::Control, "frame-bus");
+    std::vector<pollfd> fds;
+    for (;;) {
+        fds.clear();
+        fds.push_back({listenFd_, POLLIN, 0});
+        fds.push_back({wakeFd_, POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lock(consumersMutex_);
+            for (const Consumer& c : consumers_) fds.push_back({c.socketFd, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) return;
+
+        // Consumers never send anything; readable means they hung up.
+        for (size_t i = 2; i < fds.size(); ++i) {
+            if (!fds[i].revents) continue;
+            std::lock_guard<std::mutex> lock(consumersMutex_);
+            auto it = std::find_if(consumers_.begin(), consumers_.end(),
+                                   [&](const Consumer& c) { return c.socketFd == fds[i].fd; });
+            if (it != consumers_.end()) {
+                close(it->socketFd);
+                close(it->eventFd);
+                consumers_.erase(it);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int client = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) continue;
+            int efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            Hello hello{framebus::kMagic, framebus::kVersion, mappedBytes_};
+            if (efd < 0 || !sendFds(client, hello, memFd_, efd)) {
+                log_error("Frame bus: failed to hand descriptors to consumer");
+                if (efd >= 0) close(efd);
+                close(client);
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(consumersMutex_);
+            consumers_.push_back({client, efd});
+            STREAM_LOG_INFO("frame bus: consumer connected ({} total)", consumers_.size());
+        }
+    }
+}
+
+std::unique_ptr<FrameBusReader> FrameBusReader::connect(const std::string& socketPath) {
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) return nullptr;
+    std::unique_ptr<FrameBusReader> reader(new FrameBusReader());
+    reader->socketFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    if (reader->socketFd_ < 0 ||
+        ::connect(reader->socketFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        log_error("Frame bus: connect " + socketPath + ": " + strerror(errno));
+        return nullptr;
+    }
+    Hello hello{};
+    int memFd = -1;
+    if (!receiveFds(reader->socketFd_, hello, memFd, reader->eventFd_) || hello.magic != framebus::kMagic ||
+        hello.version != framebus::kVersion) {
+        log_error("Frame bus: bad handshake from " + socketPath);
+        if (memFd >= 0) close(memFd);
+        return nullptr;
+    }
+    void* mem = mmap(nullptr, hello.mappedBytes, PROT_READ, MAP_SHARED, memFd, 0);
+    close(memFd);
+    if (mem == MAP_FAILED) {
+        log_error(std::string("Frame bus: mmap: ") + strerror(errno));
+        return nullptr;
+    }
+    reader->mappedBytes_ = hello.mappedBytes;
+    reader->base_ = static_cast<const uint8_t*>(mem);
+    reader->header_ = static_cast<const framebus::Header*>(mem);
+    return reader;
+}
+
+FrameBusReader::~FrameBusReader() {
+    if (base_) munmap(const_cast<uint8_t*>(base_), mappedBytes_);
+    if (eventFd_ >= 0) close(eventFd_);
+    if (socketFd_ >= 0) close(socketFd_);
+}
+
+bool FrameBusReader::wait(int timeoutMs) {
+    pollfd fds[2] = {{eventFd_, POLLIN, 0}, {socketFd_, POLLIN, 0}};
+    for (;;) {
+        int n = poll(fds, 2, timeoutMs);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        if (fds[1].revents) {
+            closed_ = true;
+            return false;
+        }
+        uint64_t count;
+        (void)!read(eventFd_, &count, sizeof(count));
+        return true;
+    }
+}
+
+bool FrameBusReader::acquireLatest(View& view) const {
+    uint64_t latest = header_->latest.load(std::memory_order_acquire);
+    if (latest == 0) return false;
+    uint32_t slotIndex = uint32_t(latest % header_->slotCount);
+    const framebus::SlotHeader& slot = header_->slots[slotIndex];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) return false;
+    view.info = slot.info;
+    view.slot = slotIndex;
+    view.seq = seq;
+    view.data = base_ + slot.dataOffset;
+    // The metadata copy above must be checked like the pixels are.
+    return stillValid(view) && view.info.index == latest && view.info.size <= header_->slotBytes;
+}
+
+bool FrameBusReader::stillValid(const View& view) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header_->slots[view.slot].seq.load(std::memory_order_relaxed) == view.seq;
+}
+
+}
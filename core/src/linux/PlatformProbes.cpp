@@ -0,0 +1,209 @@
+#include "../../include/Capabilities.h"
+#include "../../include/Config.h"
+#include "../../include/V4L2VirtualCamera.h"
+#include <X11/Xlib.h>
+#include <X11/extensions/XShm.h>
+#include <alsa/asoundlib.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+namespace stream {
+
+namespace {
+
+// One X connection answers both the display and the XShm probe.
+struct XProbe {
+    bool display = false;
+    std::string displayDetail;
+    bool shm = false;
+    std::string shmDetail;
+};
+
+bool g_shmAttachFailed = false;
+int onShmAttachError(Display*, XErrorEvent*) {
+    g_shmAttachFailed = true;
+    return 0;
+}
+
+XProbe runXProbe() {
+    XProbe probe;
+    Display* display = XOpenDisplay(nullptr);
+    if (!display) {
+        const char* name = getenv("DISPLAY");
+        probe.displayDetail = std::string("cannot open display ") + (name ? name : "(DISPLAY unset)");
+        probe.shmDetail = "no X display";
+        return probe;
+    }
+    Screen* screen = DefaultScreenOfDisplay(display);
+    probe.display = true;
+    probe.displayDetail = std::string(DisplayString(display)) + " " + std::to_string(WidthOfScreen(screen)) + "x" +
+                          std::to_string(HeightOfScreen(screen)) + " (" + ServerVendor(display) + ")";
+
+    int major = 0, minor = 0;
+    Bool pixmaps = False;
+    if (!XShmQueryVersion(display, &major, &minor, &pixmaps)) {
+        probe.shmDetail = "MIT-SHM extension missing";
+    } else {
+        // The extension is advertised to remote clients too; only an
+        // actual attach tells us the server can see our segments.
+        XShmSegmentInfo info{};
+        info.shmid = shmget(IPC_PRIVATE, 4096, IPC_CREAT | 0600);
+        info.shmaddr = info.shmid >= 0 ? static_cast<char*>(shmat(info.shmid, nullptr, 0)) : nullptr;
+        if (!info.shmaddr || info.shmaddr == reinterpret_cast<char*>(-1)) {
+            probe.shmDetail = "shmget/shmat failed";
+        } else {
+            g_shmAttachFailed = false;
+            auto previous = XSetErrorHandler(onShmAttachError);
+            XShmAttach(display, &info);
+            XSync(display, False);
+            XSetErrorHandler(previous);
+            if (!g_shmAttachFailed) XShmDetach(display, &info);
+            shmdt(info.shmaddr);
+            probe.shm = !g_shmAttachFailed;
+            probe.shmDetail = "MIT-SHM " + std::to_string(major) + "." + std::to_string(minor) +
+                              (probe.shm ? "" : ", attach refused (remote display?)");
+        }
+        if (info.shmid >= 0) shmctl(info.shmid, IPC_RMID, nullptr);
+    }
+    XCloseDisplay(display);
+    return probe;
+}
+
+const XProbe& xProbe() {
+    static const XProbe probe = runXProbe();
+    return probe;
+}
+
+// libva is loaded at probe time so the core doesn't need it to link or
+// start; only the handful of calls below are used.
+using VADisplay = void*;
+using VAStatus = int;
+constexpr int kVAProfileH264Main = 6;
+constexpr int kVAProfileH264High = 7;
+constexpr int kVAProfileH264ConstrainedBaseline = 13;
+constexpr int kVAEntrypointEncSlice = 6;
+constexpr int kVAEntrypointEncSliceLP = 8;
+
+bool probeVaapi(std::string& detail) {
+    void* va = dlopen("libva.so.2", RTLD_NOW | RTLD_LOCAL);
+    void* vaDrm = va ? dlopen("libva-drm.so.2", RTLD_NOW | RTLD_LOCAL) : nullptr;
+    if (!vaDrm) {
+        detail = "libva not installed";
+        if (va) dlclose(va);
+        return false;
+    }
+    auto getDisplay = reinterpret_cast<VADisplay (*)(int)>(dlsym(vaDrm, "vaGetDisplayDRM"));
+    auto initialize = reinterpret_cast<VAStatus (*)(VADisplay, int*, int*)>(dlsym(va, "vaInitialize"));
+    auto terminate = reinterpret_cast<VAStatus (*)(VADisplay)>(dlsym(va, "vaTerminate"));
+    auto maxEntrypoints = reinterpret_cast<int (*)(VADisplay)>(dlsym(va, "vaMaxNumEntrypoints"));
+    auto queryEntrypoints =
+        reinterpret_cast<VAStatus (*)(VADisplay, int, int*, int*)>(dlsym(va, "vaQueryConfigEntrypoints"));
+    auto vendor = reinterpret_cast<const char* (*)(VADisplay)>(dlsym(va, "vaQueryVendorString"));
+
+    bool ok = false;
+    detail = "no render node with H.264 encode";
+    if (getDisplay && initialize && terminate && maxEntrypoints && queryEntrypoints) {
+        for (int node = 128; node < 136 && !ok; ++node) {
+            std::string path = "/dev/dri/renderD" + std::to_string(node);
+            int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+            if (fd < 0) continue;
+            VADisplay display = getDisplay(fd);
+            int major = 0, minor = 0;
+            if (display && initialize(display, &major, &minor) == 0) {
+                std::vector<int> entrypoints(size_t(std::max(maxEntrypoints(display), 1)));
+                for (int profile : {kVAProfileH264High, kVAProfileH264Main, kVAProfileH264ConstrainedBaseline}) {
+                    int count = 0;
+                    if (queryEntrypoints(display, profile, entrypoints.data(), &count) != 0) continue;
+                    for (int i = 0; i < count && !ok; ++i) {
+                        if (entrypoints[i] == kVAEntrypointEncSlice || entrypoints[i] == kVAEntrypointEncSliceLP) {
+                            ok = true;
+                            detail = "H.264 encode on " + path +
+                                     (entrypoints[i] == kVAEntrypointEncSliceLP ? " (low-power)" : "") +
+                                     (vendor ? std::string(", ") + vendor(display) : std::string());
+                        }
+                    }
+                    if (ok) break;
+                }
+                terminate(display);
+            }
+            close(fd);
+        }
+    }
+    dlclose(vaDrm);
+    dlclose(va);
+    return ok;
+}
+
+bool probeAlsa(const StreamConfig& config, std::string& detail) {
+    if (!config.audio.enabled) {
+        detail = "audio disabled in config";
+        return false;
+    }
+    snd_pcm_t* pcm = nullptr;
+    int rc = snd_pcm_open(&pcm, config.audio.device.c_str(), SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK);
+    if (rc < 0) {
+        detail = config.audio.device + ": " + snd_strerror(rc);
+        return false;
+    }
+    snd_pcm_close(pcm);
+    detail = "capture device " + config.audio.device;
+    return true;
+}
+
+// Only looks for the daemon's socket; whether the portal grants a
+// screencast is up to the user when capture starts.
+bool probePipeWire(std::string& detail) {
+#ifdef HAVE_PIPEWIRE
+    const char* remote = getenv("PIPEWIRE_REMOTE");
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    std::string socket = remote && *remote == '/' ? remote
+                       : std::string(runtime ? runtime : "/run/user/" + std::to_string(getuid())) + "/" +
+                             (remote && *remote ? remote : "pipewire-0");
+    std::error_code ec;
+    if (!std::filesystem::exists(socket, ec)) {
+        detail = "no daemon at " + socket;
+        return false;
+    }
+    detail = socket;
+    return true;
+#else
+    detail = "built without PipeWire support";
+    return false;
+#endif
+}
+
+bool probeV4L2Loopback(std::string& detail) {
+    if (!V4L2VirtualCamera::LoopbackAvailable(&detail)) return false;
+    // v4l2loopback devices are the only video nodes without a parent bus.
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/virtual/video4linux", ec))
+        detail += (detail.empty() ? "/dev/" : ", /dev/") + entry.path().filename().string();
+    if (detail.empty()) detail = "module loaded, no devices";
+    return true;
+}
+
+}
+
+void addPlatformProbes(CapabilityProbes& probes, const StreamConfig& config) {
+    probes.add("x11.display", [](std::string& detail) {
+        detail = xProbe().displayDetail;
+        return xProbe().display;
+    });
+    probes.add("x11.xshm", [](std::string& detail) {
+        detail = xProbe().shmDetail;
+        return xProbe().shm;
+    });
+    probes.add("pipewire", probePipeWire);
+    probes.add("vaapi", probeVaapi);
+    probes.add("alsa", [config](std::string& detail) { return probeAlsa(config, detail); });
+    probes.add("v4l2loopback", probeV4L2Loopback);
+}
+
+}
@@ -1,42 +1,338 @@
+#include "../../include/V4L2VirtualCamera.h"
+#include "../../include/ColorConvert.h"
+#include "../../include/ThreadTopology.h"
+#include "../../include/Logger.h"
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <linux/videodev2.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
 #include <cstring>
-#include <iostream>
+#include <filesystem>
 
-class V4L2VirtualCamera {
-public:
-    V4L2VirtualCamera(const std::string& devicePath) : devicePath_(devicePath), fd_(-1) {}
+static int Xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
 
-    bool Open() {
-        fd_ = open(devicePath_.c_str(), O_WRONLY);
-        if (fd_ < 0) {
-            perror("Failed to open v4l2loopback device");
+static uint32_t FourccFor(stream::FramePixelFormat format) {
+    switch (format) {
+    case stream::FramePixelFormat::NV12: return V4L2_PIX_FMT_NV12;
+    case stream::FramePixelFormat::I420: return V4L2_PIX_FMT_YUV420;
+    case stream::FramePixelFormat::YUYV: return V4L2_PIX_FMT_YUYV;
+    default: return 0;
+    }
+}
+
+V4L2VirtualCamera::V4L2VirtualCamera(const std::string& devicePath) : devicePath_(devicePath), fd_(-1) {}
+
+V4L2VirtualCamera::~V4L2VirtualCamera() {
+    DetachFrameBus();
+    Close();
+}
+
+bool V4L2VirtualCamera::LoopbackAvailable(std::string* reason) {
+    std::error_code ec;
+    if (std::filesystem::exists("/sys/module/v4l2loopback", ec))
+        return true;
+    if (reason)
+        *reason = "v4l2loopback module not loaded (try: sudo modprobe v4l2loopback exclusive_caps=1)";
+    return false;
+}
+
+bool V4L2VirtualCamera::Open() {
+    fd_ = open(devicePath_.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd_ < 0) {
+        std::string reason;
+        if (errno == ENOENT && !LoopbackAvailable(&reason))
+            STREAM_LOG_ERROR("v4l2: {}: {}", devicePath_, reason);
+        else
+            STREAM_LOG_ERROR("v4l2: cannot open {}: {}", devicePath_, strerror(errno));
+        return false;
+    }
+    v4l2_capability cap{};
+    if (Xioctl(fd_, VIDIOC_QUERYCAP, &cap) < 0 ||
+        !((cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps : cap.capabilities) & V4L2_CAP_VIDEO_OUTPUT)) {
+        STREAM_LOG_ERROR("v4l2: {} is not a video output device (driver {})", devicePath_,
+                         reinterpret_cast<const char*>(cap.driver));
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool V4L2VirtualCamera::Configure(int width, int height, stream::FramePixelFormat format, int bufferCount) {
+    uint32_t fourcc = FourccFor(format);
+    if (fd_ < 0 || !fourcc || width <= 0 || height <= 0 || (width | height) & 1) {
+        STREAM_LOG_ERROR("v4l2: unsupported format {}x{}", width, height);
+        return false;
+    }
+    ReleaseBuffers();
+
+    v4l2_format fmt{};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = uint32_t(width);
+    fmt.fmt.pix.height = uint32_t(height);
+    fmt.fmt.pix.pixelformat = fourcc;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix.colorspace = V4L2_COLORSPACE_SRGB;
+    if (Xioctl(fd_, VIDIOC_S_FMT, &fmt) < 0) {
+        STREAM_LOG_ERROR("v4l2: VIDIOC_S_FMT: {}", strerror(errno));
+        return false;
+    }
+    if (fmt.fmt.pix.pixelformat != fourcc || int(fmt.fmt.pix.width) != width || int(fmt.fmt.pix.height) != height) {
+        STREAM_LOG_ERROR("v4l2: driver changed the requested format");
+        return false;
+    }
+    width_ = width;
+    height_ = height;
+    format_ = format;
+    int minLine = format == stream::FramePixelFormat::YUYV ? width * 2 : width;
+    bytes_per_line_ = std::max(int(fmt.fmt.pix.bytesperline), minLine);
+    size_t planar = size_t(bytes_per_line_) * height;
+    frame_bytes_ = fmt.fmt.pix.sizeimage ? fmt.fmt.pix.sizeimage
+                                         : format == stream::FramePixelFormat::YUYV ? planar : planar * 3 / 2;
+
+    v4l2_requestbuffers req{};
+    req.count = uint32_t(bufferCount);
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (Xioctl(fd_, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+        STREAM_LOG_WARN("v4l2: mmap streaming unavailable, falling back to write()");
+        write_buffer_.resize(frame_bytes_);
+        return true;
+    }
+    for (uint32_t i = 0; i < req.count; ++i) {
+        v4l2_buffer buf{};
+        buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (Xioctl(fd_, VIDIOC_QUERYBUF, &buf) < 0) {
+            STREAM_LOG_ERROR("v4l2: VIDIOC_QUERYBUF: {}", strerror(errno));
+            ReleaseBuffers();
+            return false;
+        }
+        void* mem = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, buf.m.offset);
+        if (mem == MAP_FAILED) {
+            STREAM_LOG_ERROR("v4l2: mmap: {}", strerror(errno));
+            ReleaseBuffers();
+            return false;
+        }
+        buffers_.push_back({static_cast<uint8_t*>(mem), buf.length});
+    }
+    frame_bytes_ = std::min(frame_bytes_, buffers_[0].length);
+    int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    if (Xioctl(fd_, VIDIOC_STREAMON, &type) < 0) {
+        STREAM_LOG_ERROR("v4l2: VIDIOC_STREAMON: {}", strerror(errno));
+        ReleaseBuffers();
+        return false;
+    }
+    streaming_ = true;
+    return true;
+}
+
+void V4L2VirtualCamera::ReleaseBuffers() {
+    if (streaming_) {
+        int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        Xioctl(fd_, VIDIOC_STREAMOFF, &type);
+        streaming_ = false;
+    }
+    for (const MappedBuffer& b : buffers_)
+        munmap(b.data, b.length);
+    if (!buffers_.empty()) {
+        v4l2_requestbuffers req{};
+        req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        req.memory = V4L2_MEMORY_MMAP;
+        Xioctl(fd_, VIDIOC_REQBUFS, &req);
+    }
+    buffers_.clear();
+    write_buffer_.clear();
+    free_index_ = -1;
+    queued_ = 0;
+}
+
+uint8_t* V4L2VirtualCamera::AcquireBuffer() {
+    if (!streaming_)
+        return write_buffer_.empty() ? nullptr : write_buffer_.data();
+    if (free_index_ >= 0)
+        return buffers_[free_index_].data;
+    // Buffers we have never queued are free for the taking.
+    if (queued_ < buffers_.size()) {
+        free_index_ = int(queued_);
+        return buffers_[free_index_].data;
+    }
+    // Otherwise wait for the driver to hand one back. If the reader side
+    // stalls, give up after a frame or two rather than blocking capture.
+    pollfd pfd{fd_, POLLOUT, 0};
+    if (poll(&pfd, 1, 50) <= 0)
+        return nullptr;
+    v4l2_buffer buf{};
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if (Xioctl(fd_, VIDIOC_DQBUF, &buf) < 0) {
+        if (errno != EAGAIN)
+            STREAM_LOG_EVERY_MS(stream::LogLevel::Error, 1000, "v4l2: VIDIOC_DQBUF: {}", strerror(errno));
+        return nullptr;
+    }
+    free_index_ = int(buf.index);
+    return buffers_[free_index_].data;
+}
+
+bool V4L2VirtualCamera::QueueBuffer(size_t bytesUsed, uint64_t timestampMicros) {
+    if (!streaming_) {
+        if (write(fd_, write_buffer_.data(), bytesUsed) != (ssize_t)bytesUsed) {
+            STREAM_LOG_EVERY_MS(stream::LogLevel::Error, 1000, "v4l2: write: {}", strerror(errno));
             return false;
         }
         return true;
     }
+    if (free_index_ < 0)
+        return false;
+    v4l2_buffer buf{};
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = uint32_t(free_index_);
+    buf.bytesused = uint32_t(bytesUsed);
+    buf.field = V4L2_FIELD_NONE;
+    buf.timestamp.tv_sec = time_t(timestampMicros / 1000000);
+    buf.timestamp.tv_usec = suseconds_t(timestampMicros % 1000000);
+    if (Xioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
+        STREAM_LOG_EVERY_MS(stream::LogLevel::Error, 1000, "v4l2: VIDIOC_QBUF: {}", strerror(errno));
+        return false;
+    }
+    if (size_t(free_index_) >= queued_)
+        queued_ = size_t(free_index_) + 1;
+    free_index_ = -1;
+    return true;
+}
 
-    bool WriteFrame(const uint8_t* data, size_t size) {
+bool V4L2VirtualCamera::WriteFrameBGRA(const uint8_t* bgra, int stride, uint64_t timestampMicros) {
+    uint8_t* dst = AcquireBuffer();
+    if (!dst)
+        return false;
+    const int w = width_, h = height_, line = bytes_per_line_;
+    switch (format_) {
+    case stream::FramePixelFormat::YUYV:
+        ConvertBGRAtoYUYV(bgra, stride, w, h, dst, line);
+        break;
+    case stream::FramePixelFormat::NV12:
+        ConvertBGRAtoNV12(bgra, stride, w, h, dst, line, dst + size_t(line) * h, line);
+        break;
+    case stream::FramePixelFormat::I420: {
+        // The existing converter wants packed input.
+        if (stride != w * 4)
+            return false;
+        uint8_t* u = dst + size_t(line) * h;
+        uint8_t* v = u + size_t(line / 2) * (h / 2);
+        ConvertBGRAtoI420(bgra, w, h, dst, line, u, line / 2, v, line / 2);
+        break;
+    }
+    default:
+        return false;
+    }
+    return QueueBuffer(frame_bytes_, timestampMicros);
+}
+
+bool V4L2VirtualCamera::WriteFrame(const uint8_t* data, size_t size) {
+    if (frame_bytes_ == 0) {
+        // Not configured: raw write() in whatever format the device has.
         if (write(fd_, data, size) != (ssize_t)size) {
-            perror("Failed to write frame to v4l2loopback");
+            STREAM_LOG_EVERY_MS(stream::LogLevel::Error, 1000, "v4l2: write: {}", strerror(errno));
             return false;
         }
         return true;
     }
+    uint8_t* dst = AcquireBuffer();
+    if (!dst || size > frame_bytes_)
+        return false;
+    memcpy(dst, data, size);
+    return QueueBuffer(size, 0);
+}
 
-    void Close() {
-        if (fd_ >= 0)
-            close(fd_);
-        fd_ = -1;
-    }
+void V4L2VirtualCamera::Close() {
+    ReleaseBuffers();
+    if (fd_ >= 0)
+        close(fd_);
+    fd_ = -1;
+    frame_bytes_ = 0;
+}
 
-    ~V4L2VirtualCamera() {
-        Close();
+bool V4L2VirtualCamera::AttachFrameBus(const std::string& busSocketPath) {
+    DetachFrameBus();
+    bus_ = stream::FrameBusReader::connect(busSocketPath);
+    if (!bus_) return false;
+    bus_socket_ = busSocketPath;
+    bus_running_ = true;
+    bus_thread_ = std::thread(&V4L2VirtualCamera::BusLoop, this);
+    return true;
+}
+
+void V4L2VirtualCamera::DetachFrameBus() {
+    bus_running_ = false;
+    if (bus_thread_.joinable())
+        bus_thread_.join();
+    bus_.reset();
+}
+
+// Retries with exponential backoff until the bus is back or
+// DetachFrameBus() is called.
+bool V4L2VirtualCamera::ReconnectFrameBus() {
+    bus_.reset();
+    auto delay = std::chrono::milliseconds(50);
+    while (bus_running_) {
+        bus_ = stream::FrameBusReader::connect(bus_socket_);
+        if (bus_)
+            return true;
+        // Sleep in short steps so a detach isn't held up by the backoff.
+        for (auto slept = std::chrono::milliseconds(0); slept < delay && bus_running_;
+             slept += std::chrono::milliseconds(50))
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        delay = std::min(delay * 2, std::chrono::milliseconds(2000));
     }
+    return false;
+}
 
-private:
-    std::string devicePath_;
-    int fd_;
-};
+void V4L2VirtualCamera::BusLoop() {
+    stream::ThreadScope scope(stream::ThreadRole::Control, "v4l2-camera");
+    uint64_t lastIndex = 0;
+    while (bus_running_) {
+        // Short timeout so DetachFrameBus() is noticed promptly.
+        if (!bus_->wait(100)) {
+            if (bus_->closed()) {
+                // The producer replaces the ring when frames outgrow it.
+                STREAM_LOG_INFO("v4l2: frame bus producer went away, reconnecting");
+                if (!ReconnectFrameBus())
+                    break;
+                lastIndex = 0;
+            }
+            continue;
+        }
+        stream::FrameBusReader::View view;
+        if (!bus_->acquireLatest(view) || view.info.index == lastIndex)
+            continue;
+        lastIndex = view.info.index;
+        // Bus frames are BGRA; (re)negotiate when the size changes.
+        if (view.info.format != stream::FramePixelFormat::BGRA)
+            continue;
+        // The device takes even sizes only; odd frames lose their last
+        // column or row, so compare against what was configured.
+        int width = int(view.info.width) & ~1, height = int(view.info.height) & ~1;
+        if (width != width_ || height != height_) {
+            if (!Configure(width, height, format_))
+                break;
+        }
+        // Conversion reads the shared slot directly into the driver buffer.
+        // If the producer lapped us meanwhile the frame is mixed; it is
+        // already queued, so just count it.
+        WriteFrameBGRA(view.data, int(view.info.stride), view.info.timestamp);
+        if (!bus_->stillValid(view))
+            torn_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
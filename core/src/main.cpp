@@ -2,127 +2,342 @@
 #include "../include/Encoder.h"
 #include "../include/WebRTCSession.h"
 #include "../include/InputInjector.h"
+#include "../include/InputChannel.h"
 #include "../include/SignalingClient.h"
+#include "../include/SignalingProtocol.h"
 #include "../include/Logger.h"
-#include <fstream>
-#include <nlohmann/json.hpp>
+#include "../include/PipelineStats.h"
+#include "../include/Config.h"
+#include "../include/EncodePipeline.h"
+#include "../include/ThreadTopology.h"
+#include "../include/EventLoop.h"
+#ifdef __linux__
+#include "../include/AudioCapture.h"
+#include "../include/FrameBus.h"
+#endif
+#include <filesystem>
 #include "../include/HealthCheck.h"
+#include "../include/Capabilities.h"
+#include "../include/Startup.h"
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <cstdio>
+#include <random>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#ifdef __linux__
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#endif
+
+// Random per-process id used to tag our signaling messages.
+static std::string makeSessionId() {
+    std::random_device rd;
+    std::uniform_int_distribution<uint32_t> dist;
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%08x%08x", dist(rd), dist(rd));
+    return buf;
+}
+
+// Threads pick up their role's policy when they start; running ones are
+// moved on a config reload.
+static void applyThreadPolicies(const stream::StreamConfig& config) {
+    for (int role = 0; role < stream::kThreadRoleCount; ++role)
+        stream::threadTopology().setPolicy(stream::ThreadRole(role), config.threads.forRole(stream::ThreadRole(role)));
+}
 
 // Entry point for the native core engine
 int main(int argc, char** argv) {
     // Load config
-    nlohmann::json config;
-    try {
-        std::ifstream f("config.json");
-        if (f) f >> config;
-        else stream::log_info("No config.json found, using defaults");
-    } catch (...) {
-        stream::log_error("Failed to load config.json");
-    }
-
-    // Health check: try to create all major subsystems
-    if (!stream::health_check()) {
-        stream::log_error("Health check failed");
+    const std::string configPath = "config.json";
+    stream::StreamConfig config;
+    std::vector<std::string> configErrors;
+    if (!std::filesystem::exists(configPath)) {
+        stream::log_info("No config.json found, using defaults");
+    } else if (!stream::loadConfig(configPath, config, configErrors)) {
+        for (const auto& e : configErrors) stream::log_error("config.json: " + e);
         return 1;
     }
+    stream::setLogLevel(stream::parseLogLevel(config.logLevel));
+    applyThreadPolicies(config);
+#ifdef __linux__
+    // SIGINT/SIGTERM are read from a signalfd on the main loop; blocked here,
+    // before any thread starts, so every thread inherits the mask.
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+#endif
 
-    // Create platform modules
-    auto capture = createPlatformCapture();
-    if (!capture) {
-        stream::log_error("Failed to create capture module");
-        return 1;
-    }
-    auto encoder = createPlatformEncoder();
-    if (!encoder) {
-        stream::log_error("Failed to create encoder module");
-        return 1;
-    }
-    auto input = stream::createPlatformInputInjector();
-    if (!input) {
-        stream::log_error("Failed to create input injector");
-        return 1;
-    }
-    std::unique_ptr<stream::SignalingClient> signaling(stream::createWebSocketSignalingClient());
-    if (!signaling) {
-        stream::log_error("Failed to create signaling client");
-        return 1;
-    }
-    auto webrtc = createWebRTCSession();
-    if (!webrtc) {
-        stream::log_error("Failed to create WebRTC session");
+    // Independent subsystems come up concurrently; each costs display
+    // connections, threads or factory setup. The health check's probes run
+    // alongside and are cached for later lookups.
+    stream::StartupOrchestrator startup;
+    // Signaling, config reloads and shutdown are dispatched here, on the main
+    // thread. Declared before the clients that post to it, so it outlives them.
+    stream::EventLoop loop;
+    std::unique_ptr<Capture> capture;
+    std::unique_ptr<Encoder> encoder;
+    std::unique_ptr<stream::InputInjector> input;
+    std::unique_ptr<stream::SignalingClient> signaling;
+    std::unique_ptr<WebRTCSession> webrtc;
+    startup.add("health", [&] { return stream::health_check(config); });
+    startup.add("capture", [&] { return (capture = createPlatformCapture(config.capture.backend)) != nullptr; });
+    startup.add("encoder", [&] { return (encoder = createPlatformEncoder()) != nullptr; });
+    startup.add("input", [&] { return (input = stream::createPlatformInputInjector()) != nullptr; });
+    startup.add("signaling", [&] {
+        signaling.reset(stream::createWebSocketSignalingClient());
+        return signaling != nullptr;
+    });
+    // The PeerConnectionFactory is created on the first peer, not here.
+    startup.add("webrtc", [&] {
+        webrtc = createWebRTCSession();
+        if (!webrtc) return false;
+        webrtc->Configure(config);
+        webrtc->Init();
+        return true;
+    });
+    if (!startup.run()) {
+        startup.logTimeline();
         return 1;
     }
 
-    // Connect signaling events to WebRTC
+    // Remote input arrives on the WebRTC "input" data channel and is
+    // injected from the channel's own thread.
+    stream::InputChannel inputChannel(*input);
+    webrtc->SetOnInputMessage([&](const uint8_t* data, size_t size) {
+        inputChannel.onMessage(data, size);
+    });
+    webrtc->SetOnInputReset([&] { inputChannel.reset(); });
+    inputChannel.start();
+
+    // Connect signaling events to WebRTC. Local candidates are trickled in
+    // batches so a gathering burst costs one frame per window.
+    const std::string sessionId = makeSessionId();
+    stream::CandidateBatcher candidateBatcher(std::chrono::milliseconds(20),
+        [&](std::vector<stream::IceCandidateInfo>&& candidates) {
+            stream::SignalingMessage msg;
+            msg.type = stream::SignalingMessage::Type::Candidates;
+            msg.session = sessionId;
+            msg.candidates = std::move(candidates);
+            signaling->send(stream::encodeSignalingMessage(msg));
+        });
     webrtc->SetOnOfferCreated([&](const std::string& offerSdp) {
         stream::log_info("Sending offer to signaling server");
-        signaling->send(std::string("offer:") + offerSdp);
+        stream::SignalingMessage msg;
+        msg.type = stream::SignalingMessage::Type::Offer;
+        msg.session = sessionId;
+        msg.sdp = offerSdp;
+        signaling->send(stream::encodeSignalingMessage(msg));
     });
-    webrtc->SetOnIceCandidate([&](const std::string& candidate) {
-        stream::log_info("Sending ICE candidate to signaling server");
-        signaling->send(std::string("candidate:") + candidate);
+    webrtc->SetOnIceCandidate([&](const std::string& candidate, const std::string& mid, int mlineIndex) {
+        candidateBatcher.add({candidate, mid, mlineIndex});
     });
-    signaling->onMessage([&](const std::string& msg) {
-        // Parse and route signaling messages (offer/answer/candidate)
-        if (msg.rfind("answer:", 0) == 0) {
-            std::string sdp = msg.substr(7);
-            webrtc->SetRemoteDescription(sdp);
+    webrtc->SetOnIceGatheringDone([&]() {
+        candidateBatcher.flush();
+    });
+    signaling->onMessage([&](const std::string& text) {
+        stream::SignalingMessage msg;
+        if (!stream::parseSignalingMessage(text, msg)) {
+            stream::log_info("Ignoring signaling message: " + text.substr(0, 64));
+            return;
+        }
+        if (!msg.session.empty() && msg.session != sessionId) {
+            stream::log_info("Ignoring signaling message for session " + msg.session);
+            return;
+        }
+        switch (msg.type) {
+        case stream::SignalingMessage::Type::Answer:
+            webrtc->SetRemoteDescription(msg.sdp);
             stream::log_info("Received and set remote answer");
-        } else if (msg.rfind("candidate:", 0) == 0) {
-            std::string candidate = msg.substr(10);
-            webrtc->AddRemoteIceCandidate(candidate);
-            stream::log_info("Received and added remote ICE candidate");
-        } else if (msg.rfind("offer:", 0) == 0) {
+            break;
+        case stream::SignalingMessage::Type::Offer:
             // For completeness: handle incoming offer (if acting as callee)
-            std::string sdp = msg.substr(6);
-            webrtc->SetRemoteDescription(sdp);
+            webrtc->SetRemoteDescription(msg.sdp);
             stream::log_info("Received and set remote offer");
-            // Optionally create and send answer here
-        } else {
-            stream::log_info("Received signaling message: " + msg);
+            break;
+        case stream::SignalingMessage::Type::Candidates:
+            for (const auto& c : msg.candidates)
+                webrtc->AddRemoteIceCandidate(c.candidate, c.mid, c.mlineIndex);
+            stream::log_info("Added " + std::to_string(msg.candidates.size()) + " remote ICE candidate(s)");
+            break;
+        case stream::SignalingMessage::Type::Bye:
+            stream::log_info("Remote peer left");
+            break;
+        case stream::SignalingMessage::Type::Unknown:
+            break;
         }
     });
-    signaling->connect("ws://localhost:8080");
 
     // Wire up capture -> encode -> webrtc
-    bool encoderStarted = encoder->Start(1280, 720, 30, [&](const EncodedFrame& frame) {
+    capture->SetFrameRate(config.capture.framerate);
+    if (config.capture.target().kind != CaptureTarget::Kind::Screen && !capture->SetTarget(config.capture.target()))
+        stream::log_error("Capture backend does not support this capture target, capturing the full screen");
+    capture->SetCursorCallback([&](const CursorData& cursor) {
+        webrtc->SendCursorUpdate(cursor);
+    });
+#ifdef __linux__
+    // Captured frames are also published on the shared-memory frame bus for
+    // local consumers. Created on the first frame, once its size is known;
+    // only the capture thread touches it.
+    std::unique_ptr<stream::FrameBusWriter> frameBus;
+    bool frameBusFailed = config.frameBusSocket.empty();
+    std::unique_ptr<AudioCapture> audioCapture;
+#endif
+    stream::StatsServer statsServer(webrtc->Stats());
+
+    // Second phase: start everything. Only capture has to wait, for the
+    // encoder it feeds.
+    startup.add("signaling.connect", [&] {
+        signaling->attach(loop);
+        signaling->connect(config.signalingUrl);
+        return true;
+    });
+    // Resizes, pacing and rate changes between capture and the encoder.
+    stream::EncodePipeline encodePipeline;
+    Encoder::EncodedCallback onEncoded = [&](const EncodedFrame& frame) {
+        if (startup.markFirstFrame())
+            STREAM_LOG_INFO("Time to first encoded frame: {}ms", startup.timeToFirstFrame().count() / 1000);
         // Push encoded frame to WebRTC
         webrtc->PushEncodedFrame(frame);
-        stream::log_info("Encoded frame ready, timestamp: " + std::to_string(frame.timestamp));
+        STREAM_LOG_EVERY_MS(stream::LogLevel::Info, 1000, "Encoded frame ready, timestamp: {}", frame.timestamp);
+    };
+    startup.add("encoder.start", [&] {
+        stream::EncodePipeline::Settings settings;
+        settings.width = config.capture.width;
+        settings.height = config.capture.height;
+        settings.framerate = config.capture.framerate;
+        settings.bitrate = config.encode.bitrate;
+        settings.vfr = config.encode.vfr;
+        return encodePipeline.start(*encoder, settings, onEncoded);
     });
-    if (!encoderStarted) {
-        stream::log_error("Failed to start encoder");
-        return 1;
+    startup.add("capture.start", [&] {
+        return capture->Start([&](const FrameData& frame) {
+#ifdef __linux__
+            // Slots are sized for the first frame; a larger one needs a new
+            // ring, and consumers reconnect to it.
+            if (frameBus && frame.size > frameBus->slotBytes())
+                frameBus.reset();
+            if (!frameBus && !frameBusFailed) {
+                frameBus = stream::FrameBusWriter::create(config.frameBusSocket, 4, uint32_t(frame.size));
+                frameBusFailed = !frameBus;
+            }
+            if (frameBus) {
+                stream::FrameBusInfo info{};
+                info.timestamp = frame.timestamp;
+                info.width = uint32_t(frame.width);
+                info.height = uint32_t(frame.height);
+                info.stride = uint32_t(frame.stride);
+                info.size = uint32_t(frame.size);
+                info.format = stream::FramePixelFormat::BGRA;
+                frameBus->publish(frame.data, info);
+            }
+#endif
+            encodePipeline.onFrame(frame);
+        });
+    }, {"encoder.start"});
+#ifdef __linux__
+    if (config.audio.enabled && stream::capabilities().available("alsa")) {
+        startup.add("audio", [&] {
+            audioCapture = createPlatformAudioCapture(config.audio.device);
+            if (audioCapture->Start([&](const AudioFrame& frame) { webrtc->PushAudioFrame(frame); }))
+                return true;
+            stream::log_error("Audio capture unavailable, streaming video only");
+            audioCapture.reset();
+            return false;
+        }, {}, false);
     }
-    bool captureStarted = capture->Start([&](const FrameData& frame) {
-        encoder->EncodeFrame(frame.data, frame.stride);
-    });
-    if (!captureStarted) {
-        stream::log_error("Failed to start capture");
+#endif
+    // Local stats endpoint: connect to the socket to read one JSON snapshot.
+    startup.add("stats", [&] { return statsServer.start(config.statsSocket); }, {}, false);
+    bool started = startup.run();
+    startup.logTimeline();
+    if (!started)
         return 1;
-    }
 
-    stream::log_info("Core started. Running main loop...");
-    // Main loop (simulate running)
-    for (int i = 0; i < 1000; ++i) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        // Poll signaling, handle input injection, etc.
-        // If your signaling client has a poll/process method, call it here:
-        // signaling->poll();
-        // Example: handle input injection from remote (pseudo-code):
-        // if (signaling->hasInputEvent()) {
-        //     auto event = signaling->getInputEvent();
-        //     if (event.type == "mouse") input->injectMouse(event.x, event.y, event.button, event.down);
-        //     if (event.type == "keyboard") input->injectKeyboard(event.key, event.down);
-        // }
+    // Edits to config.json take effect without a restart where the pipeline
+    // allows it; everything else is logged and picked up on the next start.
+    // Applied on the main loop, one reload at a time.
+    stream::ConfigWatcher configWatcher(configPath, config,
+        [&](const stream::StreamConfig& prevConfig, const stream::StreamConfig& curConfig) {
+            loop.post([&, prev = prevConfig, cur = curConfig] {
+                stream::ConfigDiff diff = stream::diffConfig(prev, cur);
+                stream::setLogLevel(stream::parseLogLevel(cur.logLevel));
+                // The encoder belongs to the capture thread; rates are
+                // handed over and applied before its next frame.
+                if (diff.bitrate) encodePipeline.setBitrate(cur.encode.bitrate);
+                if (diff.vfr) encodePipeline.setVfr(cur.encode.vfr);
+                if (diff.threads) applyThreadPolicies(cur);
+                if (diff.framerate) {
+                    capture->SetFrameRate(cur.capture.framerate);
+                    encodePipeline.setFramerate(cur.capture.framerate);
+                }
+                if (diff.target && !capture->SetTarget(cur.capture.target()))
+                    stream::log_error("Capture backend cannot switch to this target live; restart to apply");
+                for (const auto& key : diff.restartRequired)
+                    stream::log_info("config: " + key + " changed, takes effect after restart");
+            });
+        });
+    configWatcher.start();
+
+#ifdef __linux__
+    int signalFd = signalfd(-1, &stopSignals, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (signalFd < 0 || !loop.watch(signalFd, [&] {
+            signalfd_siginfo info;
+            if (read(signalFd, &info, sizeof(info)) == sizeof(info))
+                stream::log_info(std::string("Received ") + strsignal(int(info.ssi_signo)) + ", stopping");
+            loop.stop();
+        })) {
+        stream::log_error("Cannot watch for SIGINT/SIGTERM");
+        return 1;
     }
+#else
+    static std::atomic<bool> stopRequested{false};
+    std::signal(SIGINT, [](int) { stopRequested = true; });
+    std::signal(SIGTERM, [](int) { stopRequested = true; });
+    loop.addTimer(std::chrono::milliseconds(100), [&] {
+        if (stopRequested) loop.stop();
+    }, std::chrono::milliseconds(100));
+#endif
+
+    stream::log_info("Core started. Running main loop until SIGINT/SIGTERM...");
+    // Sleeps until there is something to do: no polling while idle.
+    loop.run();
+#ifdef __linux__
+    loop.unwatch(signalFd);
+    close(signalFd);
+#endif
 
     // Cleanup
+    configWatcher.stop();
+    for (const auto& t : stream::threadTopology().usage())
+        STREAM_LOG_INFO("Thread {} ({}): {}ms CPU", t.name, stream::threadRoleName(t.role), t.cpuMicros / 1000);
     capture->Stop();
+#ifdef __linux__
+    frameBus.reset();
+    if (audioCapture) {
+        stream::log_info("Audio: last capture-to-send latency " +
+                         std::to_string(audioCapture->LatencyMicros()) + "us");
+        audioCapture->Stop();
+    }
+#endif
     encoder->Stop();
+    inputChannel.stop();
+    auto inputStats = inputChannel.stats();
+    stream::log_info("Input: " + std::to_string(inputStats.injected) + " events injected, " +
+                     std::to_string(inputStats.coalescedMoves) + " moves coalesced, latency mean " +
+                     std::to_string(inputStats.meanLatencyMicros) + "us max " +
+                     std::to_string(inputStats.maxLatencyMicros) + "us");
+    auto sigStats = signaling->metrics();
+    stream::log_info("Signaling: " + std::to_string(sigStats.messagesReceived) + " received, " +
+                     std::to_string(sigStats.messagesSent) + " sent, " +
+                     std::to_string(sigStats.reconnects) + " reconnects, queue depth in/out " +
+                     std::to_string(sigStats.inboundQueueDepth) + "/" + std::to_string(sigStats.outboundQueueDepth));
     stream::log_info("Core stopped.");
+    stream::flushLogs();
     return 0;
 }
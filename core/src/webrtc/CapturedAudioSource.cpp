@@ -0,0 +1,19 @@
+#include "CapturedAudioSource.h"
+#include <algorithm>
+
+void CapturedAudioSource::PushAudio(const AudioFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto* sink : sinks_)
+        sink->OnData(frame.data, 16, frame.sampleRate, size_t(frame.channels), frame.frames);
+}
+
+void CapturedAudioSource::AddSink(webrtc::AudioTrackSinkInterface* sink) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::find(sinks_.begin(), sinks_.end(), sink) == sinks_.end())
+        sinks_.push_back(sink);
+}
+
+void CapturedAudioSource::RemoveSink(webrtc::AudioTrackSinkInterface* sink) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sinks_.erase(std::remove(sinks_.begin(), sinks_.end(), sink), sinks_.end());
+}
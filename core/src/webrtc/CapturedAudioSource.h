@@ -0,0 +1,25 @@
+#pragma once
+
+#include "AudioCapture.h"
+#include "api/media_stream_interface.h"
+#include "api/notifier.h"
+#include <mutex>
+#include <vector>
+
+// Audio source fed by AudioCapture. Each 10 ms frame is handed to the
+// track's sinks, which is how the send stream (and its Opus encoder) pulls
+// audio from a local source.
+class CapturedAudioSource : public webrtc::Notifier<webrtc::AudioSourceInterface> {
+public:
+    // Called from the capture thread.
+    void PushAudio(const AudioFrame& frame);
+
+    SourceState state() const override { return kLive; }
+    bool remote() const override { return false; }
+    void AddSink(webrtc::AudioTrackSinkInterface* sink) override;
+    void RemoveSink(webrtc::AudioTrackSinkInterface* sink) override;
+
+private:
+    std::mutex mutex_;
+    std::vector<webrtc::AudioTrackSinkInterface*> sinks_;
+};
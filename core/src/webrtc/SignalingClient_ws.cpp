@@ -1,12 +1,15 @@
 #include "SignalingClient.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "MpscQueue.h"
+#include "ThreadTopology.h"
 #include <websocketpp/config/asio_no_tls_client.hpp>
 #include <websocketpp/client.hpp>
+#include <algorithm>
 #include <thread>
-#include <queue>
 #include <mutex>
-#include <condition_variable>
 #include <atomic>
-#include <iostream>
+#include <random>
 
 using websocketpp::connection_hdl;
 using message_ptr = websocketpp::config::asio_client::message_type::ptr;
@@ -15,6 +18,12 @@ namespace stream
 {
     using ws_client = websocketpp::client<websocketpp::config::asio_client>;
 
+    // The asio thread never runs user code: received messages are pushed onto
+    // a lock-free queue and handed to callbacks on a separate dispatcher
+    // thread (or the attached event loop), and send() only enqueues and posts
+    // a drain to the asio thread, so a slow SetRemoteDescription can't stall socket I/O. Dropped
+    // connections are retried with exponential backoff; anything sent while
+    // disconnected is written once the connection is back.
     class WebSocketSignalingClient : public SignalingClient
     {
     public:
@@ -23,62 +32,190 @@ namespace stream
         {
             stop_flag_ = true;
             if (ws_thread_.joinable())
+            {
+                ws_.stop_perpetual();
+                ws_.get_io_service().post([this]()
+                                          {
+                    websocketpp::lib::error_code ec;
+                    if (hdl_.lock())
+                        ws_.close(hdl_, websocketpp::close::status::going_away, "", ec);
+                    if (reconnect_timer_)
+                        reconnect_timer_->cancel(); });
                 ws_thread_.join();
+            }
+            inbound_signal_.fetch_add(1, std::memory_order_release);
+            inbound_signal_.notify_one();
+            if (dispatch_thread_.joinable())
+                dispatch_thread_.join();
         }
 
         void connect(const std::string &url) override
         {
+            url_ = url;
             ws_.init_asio();
+            ws_.start_perpetual();
             ws_.set_open_handler([this](connection_hdl hdl)
                                  {
-            std::lock_guard<std::mutex> lock(mutex_);
             hdl_ = hdl;
-            std::cout << "WebSocket connected\n"; });
+            connected_ = true;
+            backoff_ms_ = kInitialBackoffMs;
+            STREAM_LOG_INFO("WebSocket connected");
+            drainOutbound(); });
             ws_.set_message_handler([this](connection_hdl, message_ptr msg)
                                     {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (on_message_) on_message_(msg->get_payload()); });
-            ws_.set_fail_handler([](connection_hdl)
-                                 { std::cerr << "WebSocket connection failed\n"; });
-            ws_.set_close_handler([](connection_hdl)
-                                  { std::cerr << "WebSocket closed\n"; });
+            inbound_.push(std::move(msg->get_raw_payload()));
+            received_.fetch_add(1, std::memory_order_relaxed);
+            // One drain per burst: later messages ride on the pending one.
+            if (loop_ && !drain_posted_.exchange(true, std::memory_order_acq_rel))
+                loop_->post([this]() { drainInbound(); });
+            inbound_signal_.fetch_add(1, std::memory_order_release);
+            inbound_signal_.notify_one(); });
+            ws_.set_fail_handler([this](connection_hdl)
+                                 {
+            STREAM_LOG_WARN("WebSocket connection failed");
+            scheduleReconnect(); });
+            ws_.set_close_handler([this](connection_hdl)
+                                  {
+            STREAM_LOG_WARN("WebSocket closed");
+            scheduleReconnect(); });
+
+            if (!loop_)
+                dispatch_thread_ = std::thread([this]()
+                                               {
+                    ThreadScope scope(ThreadRole::Control, "signaling");
+                    dispatchLoop(); });
+            openConnection();
+            ws_thread_ = std::thread([this]()
+                                     {
+                ThreadScope scope(ThreadRole::Network, "websocket");
+                ws_.run(); });
+        }
+
+        void send(const std::string &msg) override
+        {
+            outbound_.push(msg);
+            if (ws_thread_.joinable())
+                ws_.get_io_service().post([this]()
+                                          { drainOutbound(); });
+        }
+
+        void onMessage(std::function<void(const std::string &)> cb) override
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            on_message_ = std::move(cb);
+        }
+
+        void attach(EventLoop &loop) override { loop_ = &loop; }
+
+        SignalingMetrics metrics() const override
+        {
+            SignalingMetrics m{};
+            m.inboundQueueDepth = inbound_.size();
+            m.outboundQueueDepth = outbound_.size();
+            m.messagesReceived = received_.load(std::memory_order_relaxed);
+            m.messagesSent = sent_.load(std::memory_order_relaxed);
+            m.reconnects = reconnects_.load(std::memory_order_relaxed);
+            m.connected = connected_.load(std::memory_order_relaxed);
+            return m;
+        }
+
+    private:
+        static constexpr long kInitialBackoffMs = 250;
+        static constexpr long kMaxBackoffMs = 10000;
+
+        ws_client ws_;
+        std::string url_;
+        connection_hdl hdl_;                 // asio thread only
+        ws_client::timer_ptr reconnect_timer_; // asio thread only
+        long backoff_ms_ = kInitialBackoffMs;  // asio thread only
+        std::function<void(const std::string &)> on_message_;
+        std::mutex callback_mutex_;          // guards on_message_; never taken on the asio thread
+        MpscQueue<std::string> inbound_;
+        MpscQueue<std::string> outbound_;
+        std::atomic<uint32_t> inbound_signal_{0};
+        std::atomic<uint64_t> received_{0};
+        std::atomic<uint64_t> sent_{0};
+        std::atomic<uint64_t> reconnects_{0};
+        std::atomic<bool> connected_{false};
+        EventLoop *loop_ = nullptr;             // set before connect()
+        std::atomic<bool> drain_posted_{false};
+        std::thread ws_thread_;
+        std::thread dispatch_thread_;
+        std::atomic<bool> stop_flag_;
+
+        // asio thread
+        void openConnection()
+        {
             websocketpp::lib::error_code ec;
-            auto con = ws_.get_connection(url, ec);
+            auto con = ws_.get_connection(url_, ec);
             if (ec)
             {
-                std::cerr << "WebSocket connection error: " << ec.message() << "\n";
+                STREAM_LOG_ERROR("WebSocket connection error: {}", ec.message());
                 return;
             }
             ws_.connect(con);
-            ws_thread_ = std::thread([this]()
-                                     { ws_.run(); });
         }
 
-        void send(const std::string &msg) override
+        // asio thread
+        void scheduleReconnect()
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (hdl_.lock())
+            connected_ = false;
+            hdl_.reset();
+            if (stop_flag_)
+                return;
+            // Jitter keeps a fleet of clients from reconnecting in lockstep
+            // after a signaling server restart.
+            static thread_local std::mt19937 rng{std::random_device{}()};
+            long delay = std::uniform_int_distribution<long>(backoff_ms_ / 2, backoff_ms_)(rng);
+            backoff_ms_ = std::min(backoff_ms_ * 2, kMaxBackoffMs);
+            reconnects_.fetch_add(1, std::memory_order_relaxed);
+            STREAM_LOG_INFO("WebSocket reconnecting in {} ms", delay);
+            reconnect_timer_ = ws_.set_timer(delay, [this](const websocketpp::lib::error_code &ec)
+                                             {
+                if (!ec && !stop_flag_)
+                    openConnection(); });
+        }
+
+        // asio thread: the only place that writes to the socket.
+        void drainOutbound()
+        {
+            if (!hdl_.lock())
+                return;
+            while (auto msg = outbound_.pop())
             {
                 websocketpp::lib::error_code ec;
-                ws_.send(hdl_, msg, websocketpp::frame::opcode::text, ec);
+                ws_.send(hdl_, *msg, websocketpp::frame::opcode::text, ec);
                 if (ec)
-                    std::cerr << "WebSocket send error: " << ec.message() << "\n";
+                {
+                    STREAM_LOG_EVERY_MS(stream::LogLevel::Error, 1000, "WebSocket send error: {}", ec.message());
+                    break;
+                }
+                sent_.fetch_add(1, std::memory_order_relaxed);
             }
         }
 
-        void onMessage(std::function<void(const std::string &)> cb) override
+        void drainInbound()
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            on_message_ = std::move(cb);
+            // Cleared first, so a message pushed during the drain posts again.
+            drain_posted_.store(false, std::memory_order_release);
+            while (auto msg = inbound_.pop())
+            {
+                std::lock_guard<std::mutex> lock(callback_mutex_);
+                if (on_message_)
+                    on_message_(*msg);
+            }
         }
 
-    private:
-        ws_client ws_;
-        connection_hdl hdl_;
-        std::function<void(const std::string &)> on_message_;
-        std::mutex mutex_;
-        std::thread ws_thread_;
-        std::atomic<bool> stop_flag_;
+        void dispatchLoop()
+        {
+            uint32_t seen = inbound_signal_.load(std::memory_order_acquire);
+            while (!stop_flag_)
+            {
+                drainInbound();
+                inbound_signal_.wait(seen, std::memory_order_acquire);
+                seen = inbound_signal_.load(std::memory_order_acquire);
+            }
+        }
     };
 
     SignalingClient *createWebSocketSignalingClient() { return new WebSocketSignalingClient(); }
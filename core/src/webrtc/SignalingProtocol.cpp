@@ -0,0 +1,170 @@
+#include "SignalingProtocol.h"
+#include <nlohmann/json.hpp>
+
+namespace stream {
+namespace {
+
+const char* typeName(SignalingMessage::Type type) {
+    switch (type) {
+    case SignalingMessage::Type::Offer: return "offer";
+    case SignalingMessage::Type::Answer: return "answer";
+    case SignalingMessage::Type::Candidates: return "candidates";
+    case SignalingMessage::Type::Bye: return "bye";
+    case SignalingMessage::Type::Unknown: break;
+    }
+    return "unknown";
+}
+
+SignalingMessage::Type typeFromName(std::string_view name) {
+    if (name == "offer") return SignalingMessage::Type::Offer;
+    if (name == "answer") return SignalingMessage::Type::Answer;
+    if (name == "candidates") return SignalingMessage::Type::Candidates;
+    if (name == "bye") return SignalingMessage::Type::Bye;
+    return SignalingMessage::Type::Unknown;
+}
+
+bool parseLegacy(std::string_view text, SignalingMessage& out) {
+    auto take = [&](std::string_view prefix) {
+        if (text.substr(0, prefix.size()) != prefix) return false;
+        text.remove_prefix(prefix.size());
+        return true;
+    };
+    out = SignalingMessage{};
+    out.version = 0;
+    if (take("offer:")) {
+        out.type = SignalingMessage::Type::Offer;
+        out.sdp.assign(text);
+    } else if (take("answer:")) {
+        out.type = SignalingMessage::Type::Answer;
+        out.sdp.assign(text);
+    } else if (take("candidate:")) {
+        out.type = SignalingMessage::Type::Candidates;
+        out.candidates.push_back({std::string(text), "0", 0});
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Moves a string member out of the parsed document rather than copying it;
+// SDP blobs are the bulk of every message.
+bool takeString(nlohmann::json& obj, const char* key, std::string& out) {
+    auto it = obj.find(key);
+    if (it == obj.end() || !it->is_string()) return false;
+    out = std::move(it->get_ref<std::string&>());
+    return true;
+}
+
+} // namespace
+
+std::string encodeSignalingMessage(const SignalingMessage& msg) {
+    nlohmann::json j;
+    j["v"] = kSignalingProtocolVersion;
+    j["type"] = typeName(msg.type);
+    if (!msg.session.empty()) j["session"] = msg.session;
+    if (!msg.sdp.empty()) j["sdp"] = msg.sdp;
+    if (!msg.candidates.empty()) {
+        nlohmann::json list = nlohmann::json::array();
+        for (const auto& c : msg.candidates)
+            list.push_back({{"c", c.candidate}, {"mid", c.mid}, {"idx", c.mlineIndex}});
+        j["candidates"] = std::move(list);
+    }
+    return j.dump();
+}
+
+bool parseSignalingMessage(std::string_view text, SignalingMessage& out) {
+    if (text.empty() || text.front() != '{')
+        return parseLegacy(text, out);
+
+    nlohmann::json j = nlohmann::json::parse(text.begin(), text.end(), nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return false;
+
+    out = SignalingMessage{};
+    auto version = j.find("v");
+    if (version == j.end() || !version->is_number_integer()) return false;
+    out.version = version->get<int>();
+    if (out.version > kSignalingProtocolVersion) return false;
+
+    auto type = j.find("type");
+    if (type == j.end() || !type->is_string()) return false;
+    out.type = typeFromName(type->get_ref<const std::string&>());
+    takeString(j, "session", out.session);
+
+    switch (out.type) {
+    case SignalingMessage::Type::Offer:
+    case SignalingMessage::Type::Answer:
+        return takeString(j, "sdp", out.sdp);
+    case SignalingMessage::Type::Candidates: {
+        auto list = j.find("candidates");
+        if (list == j.end() || !list->is_array()) return false;
+        out.candidates.reserve(list->size());
+        for (auto& c : *list) {
+            if (!c.is_object()) return false;
+            IceCandidateInfo info;
+            if (!takeString(c, "c", info.candidate)) return false;
+            takeString(c, "mid", info.mid);
+            auto idx = c.find("idx");
+            if (idx != c.end() && idx->is_number_integer()) info.mlineIndex = idx->get<int>();
+            out.candidates.push_back(std::move(info));
+        }
+        return true;
+    }
+    case SignalingMessage::Type::Bye:
+        return true;
+    case SignalingMessage::Type::Unknown:
+        break;
+    }
+    return false;
+}
+
+CandidateBatcher::CandidateBatcher(std::chrono::milliseconds window, FlushCallback callback)
+    : window_(window), callback_(std::move(callback)), thread_(&CandidateBatcher::run, this) {}
+
+CandidateBatcher::~CandidateBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    flush();
+}
+
+void CandidateBatcher::add(IceCandidateInfo candidate) {
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first = pending_.empty();
+        if (first) deadline_ = Clock::now() + window_;
+        pending_.push_back(std::move(candidate));
+    }
+    if (first) cv_.notify_one();
+}
+
+void CandidateBatcher::flush() {
+    std::vector<IceCandidateInfo> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.swap(pending_);
+    }
+    if (!batch.empty()) callback_(std::move(batch));
+}
+
+void CandidateBatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (pending_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        if (cv_.wait_until(lock, deadline_) == std::cv_status::timeout && !pending_.empty()) {
+            std::vector<IceCandidateInfo> batch;
+            batch.swap(pending_);
+            lock.unlock();
+            callback_(std::move(batch));
+            lock.lock();
+        }
+    }
+}
+
+}
@@ -0,0 +1,130 @@
+#include "StatsCollector.h"
+#include "ThreadTopology.h"
+#include <algorithm>
+
+StatsCollector::StatsCollector(stream::StatsPublisher& publisher, std::chrono::milliseconds interval)
+    : publisher_(publisher), interval_(interval) {}
+
+StatsCollector::~StatsCollector() { Stop(); }
+
+void StatsCollector::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    callback_ = rtc::make_ref_counted<Callback>(this);
+    running_ = true;
+    thread_ = std::thread(&StatsCollector::Run, this);
+}
+
+void StatsCollector::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (thread_.joinable())
+        thread_.join();
+    if (callback_) {
+        callback_->Detach();
+        callback_ = nullptr;
+    }
+    peer_connection_ = nullptr;
+}
+
+void StatsCollector::SetPeerConnection(rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peer_connection_ = peer_connection;
+}
+
+void StatsCollector::Run() {
+    stream::ThreadScope scope(stream::ThreadRole::Control, "stats-collect");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (cv_.wait_for(lock, interval_, [this] { return !running_; }))
+            break;
+        auto peer_connection = peer_connection_;
+        auto callback = callback_;
+        lock.unlock();
+        // GetStats is asynchronous; the report arrives on the signaling
+        // thread, so this thread only ever sleeps and posts. Without a peer
+        // the counters alone are published from here, through the same
+        // callback so rounds never overlap.
+        if (peer_connection)
+            peer_connection->GetStats(callback.get());
+        else
+            callback->OnStatsDelivered(nullptr);
+        lock.lock();
+    }
+}
+
+void StatsCollector::OnReport(const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
+    auto& counters = stream::pipelineCounters();
+    stream::StatsSnapshot s{};
+    s.timestampMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    uint64_t captured = counters.framesCaptured.load(std::memory_order_relaxed);
+    uint64_t encoded = counters.framesEncoded.load(std::memory_order_relaxed);
+    uint64_t skipped = counters.framesSkipped.load(std::memory_order_relaxed);
+    uint64_t bytes = counters.bytesEncoded.load(std::memory_order_relaxed);
+    uint64_t encode_us = counters.encodeMicros.load(std::memory_order_relaxed);
+    uint64_t grab_us = counters.grabMicros.load(std::memory_order_relaxed);
+    if (last_time_us_ && s.timestampMicros > last_time_us_) {
+        double seconds = (s.timestampMicros - last_time_us_) / 1e6;
+        s.captureFps = (captured - last_captured_) / seconds;
+        s.encodeFps = (encoded - last_encoded_) / seconds;
+        s.skippedFps = (skipped - last_skipped_) / seconds;
+        s.encodedKbps = (bytes - last_bytes_) * 8 / 1000.0 / seconds;
+        if (encoded > last_encoded_)
+            s.encodeMsAvg = (encode_us - last_encode_us_) / 1000.0 / (encoded - last_encoded_);
+        if (captured > last_captured_)
+            s.grabMsAvg = (grab_us - last_grab_us_) / 1000.0 / (captured - last_captured_);
+    }
+    last_time_us_ = s.timestampMicros;
+    last_captured_ = captured;
+    last_encoded_ = encoded;
+    last_skipped_ = skipped;
+    last_bytes_ = bytes;
+    last_encode_us_ = encode_us;
+    last_grab_us_ = grab_us;
+    s.keyFrames = counters.keyFramesEncoded.load(std::memory_order_relaxed);
+    s.iceConnectionState = counters.iceConnectionState.load(std::memory_order_relaxed);
+    s.signalingState = counters.signalingState.load(std::memory_order_relaxed);
+    s.timeToFirstFrameMs = counters.timeToFirstFrameMicros.load(std::memory_order_relaxed) / 1000.0;
+
+    if (!report) {
+        publisher_.publish(s);
+        return;
+    }
+
+    // What the receiver tells us about our outgoing streams.
+    for (const auto* remote : report->GetStatsOfType<webrtc::RTCRemoteInboundRtpStreamStats>()) {
+        if (remote->round_trip_time.is_defined())
+            s.rttMs = *remote->round_trip_time * 1000.0;
+        if (remote->packets_lost.is_defined())
+            s.packetsLost += *remote->packets_lost;
+        if (remote->fraction_lost.is_defined())
+            s.fractionLost = std::max(s.fractionLost, *remote->fraction_lost);
+        if (remote->jitter.is_defined())
+            s.jitterMs = std::max(s.jitterMs, *remote->jitter * 1000.0);
+    }
+    for (const auto* out : report->GetStatsOfType<webrtc::RTCOutboundRtpStreamStats>()) {
+        if (out->frames_sent.is_defined())
+            s.framesSent += *out->frames_sent;
+    }
+    // Our own jitter buffer, for anything the viewer sends back.
+    for (const auto* in : report->GetStatsOfType<webrtc::RTCInboundRtpStreamStats>()) {
+        if (in->jitter_buffer_delay.is_defined() && in->jitter_buffer_emitted_count.is_defined() &&
+            *in->jitter_buffer_emitted_count > 0)
+            s.jitterBufferDelayMs = std::max(s.jitterBufferDelayMs,
+                *in->jitter_buffer_delay * 1000.0 / *in->jitter_buffer_emitted_count);
+    }
+    for (const auto* pair : report->GetStatsOfType<webrtc::RTCIceCandidatePairStats>()) {
+        if (!pair->nominated.is_defined() || !*pair->nominated) continue;
+        if (s.rttMs == 0 && pair->current_round_trip_time.is_defined())
+            s.rttMs = *pair->current_round_trip_time * 1000.0;
+        if (pair->available_outgoing_bitrate.is_defined())
+            s.availableOutgoingKbps = *pair->available_outgoing_bitrate / 1000.0;
+    }
+
+    publisher_.publish(s);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "PipelineStats.h"
+#include "api/peer_connection_interface.h"
+#include "api/stats/rtc_stats_collector_callback.h"
+#include "api/stats/rtcstats_objects.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Publishes the internal capture/encode counters on a fixed interval. Once
+// a peer connection is set, each round polls GetStats and merges its report
+// in; everything after the request then runs on WebRTC's signaling thread,
+// which delivers the report.
+class StatsCollector {
+public:
+    StatsCollector(stream::StatsPublisher& publisher, std::chrono::milliseconds interval);
+    ~StatsCollector();
+
+    void Start();
+    void Stop();
+    // Null until a peer connects, or again once it is gone.
+    void SetPeerConnection(rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection);
+
+private:
+    // Ref-counted by WebRTC and may outlive the collector: a report can
+    // still be in flight when Stop() returns, so it is dropped once the
+    // callback is detached.
+    class Callback : public webrtc::RTCStatsCollectorCallback {
+    public:
+        explicit Callback(StatsCollector* owner) : owner_(owner) {}
+        void OnStatsDelivered(const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (owner_) owner_->OnReport(report);
+        }
+        // Waits for a report being handled; none reaches the owner after.
+        void Detach() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            owner_ = nullptr;
+        }
+    private:
+        std::mutex mutex_;
+        StatsCollector* owner_;
+    };
+
+    void Run();
+    void OnReport(const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report);
+
+    stream::StatsPublisher& publisher_;
+    std::chrono::milliseconds interval_;
+    rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection_;
+    rtc::scoped_refptr<Callback> callback_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    std::thread thread_;
+
+    // Previous counter values, for rates.
+    uint64_t last_time_us_ = 0;
+    uint64_t last_captured_ = 0;
+    uint64_t last_encoded_ = 0;
+    uint64_t last_skipped_ = 0;
+    uint64_t last_bytes_ = 0;
+    uint64_t last_encode_us_ = 0;
+    uint64_t last_grab_us_ = 0;
+};
@@ -1,4 +1,3 @@
-#include <iostream>
 #include "../include/WebRTCSession.h"
 #include "Capture.h"
 #include "Encoder.h"
@@ -6,6 +5,8 @@
 #include "SignalingClient.h"
 #include "FrameVideoSource.h"
 #include "ColorConvert.h"
+#include "CursorProtocol.h"
+#include "ThreadTopology.h"
 #include <chrono>
 #include <thread>
 
@@ -23,27 +24,98 @@ WebRTCSession::~WebRTCSession() {
     Stop();
 }
 
+void WebRTCSession::Configure(const stream::StreamConfig& config) {
+    config_ = config;
+}
+
+// The factory spins up three threads and the codec factories, which is most
+// of the session's startup cost and useless until someone connects, so
+// Init() only prepares the sources. The factory and peer connection are
+// created by the first call that needs them.
 bool WebRTCSession::Init() {
-    signaling_thread_->Start();
-    worker_thread_->Start();
-    network_thread_->Start();
+    audio_source_ = rtc::make_ref_counted<CapturedAudioSource>();
+    audio_track_source_ = audio_source_;
+    StartStats();
+    return true;
+}
 
-    peer_connection_factory_ = webrtc::CreatePeerConnectionFactory(
-        network_thread_, worker_thread_, signaling_thread_,
-        nullptr, webrtc::CreateBuiltinAudioEncoderFactory(),
-        webrtc::CreateBuiltinAudioDecoderFactory(),
-        webrtc::CreateBuiltinVideoEncoderFactory(),
-        webrtc::CreateBuiltinVideoDecoderFactory(), nullptr, nullptr);
+// The pipeline counters are published from the start, not just once a peer
+// connects; the peer connection's report is merged in when there is one.
+void WebRTCSession::StartStats() {
+    std::lock_guard<std::mutex> lock(factory_mutex_);
+    if (stats_collector_)
+        return;
+    stats_collector_ = std::make_unique<StatsCollector>(stats_publisher_, std::chrono::seconds(1));
+    stats_collector_->Start();
+}
 
+bool WebRTCSession::EnsurePeerConnection() {
+    std::lock_guard<std::mutex> lock(factory_mutex_);
+    if (peer_connection_)
+        return true;
+
+    auto t0 = std::chrono::steady_clock::now();
     if (!peer_connection_factory_) {
-        std::cerr << "Failed to create PeerConnectionFactory" << std::endl;
-        return false;
+        // Media and packets go through the worker and network threads; the
+        // signaling thread only runs API calls.
+        struct {
+            rtc::Thread* thread;
+            stream::ThreadRole role;
+            const char* name;
+        } threads[] = {
+            {signaling_thread_, stream::ThreadRole::Control, "rtc-signaling"},
+            {worker_thread_, stream::ThreadRole::Network, "rtc-worker"},
+            {network_thread_, stream::ThreadRole::Network, "rtc-network"},
+        };
+        for (const auto& t : threads) {
+            t.thread->SetName(t.name, nullptr);
+            t.thread->Start();
+            t.thread->PostTask([role = t.role, name = t.name] { stream::threadTopology().enter(role, name); });
+        }
+
+        peer_connection_factory_ = webrtc::CreatePeerConnectionFactory(
+            network_thread_, worker_thread_, signaling_thread_,
+            nullptr, webrtc::CreateBuiltinAudioEncoderFactory(),
+            webrtc::CreateBuiltinAudioDecoderFactory(),
+            webrtc::CreateBuiltinVideoEncoderFactory(),
+            webrtc::CreateBuiltinVideoDecoderFactory(), nullptr, nullptr);
+
+        if (!peer_connection_factory_) {
+            STREAM_LOG_ERROR("Failed to create PeerConnectionFactory");
+            return false;
+        }
     }
 
-    return CreatePeerConnection();
+    if (!CreatePeerConnection())
+        return false;
+
+    if (audio_track_source_)
+        AttachAudioTrack();
+    if (video_track_source_)
+        AttachVideoTrack();
+
+    if (stats_collector_)
+        stats_collector_->SetPeerConnection(peer_connection_);
+    STREAM_LOG_INFO("Peer connection ready in {}ms", std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count());
+    return true;
 }
 
 void WebRTCSession::Close() {
+    std::lock_guard<std::mutex> lock(factory_mutex_);
+    if (stats_collector_) {
+        stats_collector_->Stop();
+        stats_collector_.reset();
+    }
+    if (input_channel_) {
+        input_channel_->UnregisterObserver();
+        input_channel_ = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> cursorLock(cursor_mutex_);
+        cursor_channel_ = nullptr;
+        cursor_shape_channel_ = nullptr;
+    }
     if (peer_connection_) {
         peer_connection_ = nullptr;
     }
@@ -54,12 +126,103 @@ bool WebRTCSession::CreatePeerConnection() {
     webrtc::PeerConnectionInterface::RTCConfiguration config;
     config.sdp_semantics = webrtc::SdpSemantics::kUnifiedPlan;
     webrtc::PeerConnectionInterface::IceServer stun_server;
-    stun_server.uri = "stun:stun.l.google.com:19302";
+    stun_server.uri = config_.stunServer;
     config.servers.push_back(stun_server);
 
     peer_connection_ = peer_connection_factory_->CreatePeerConnection(
         config, nullptr, nullptr, this);
-    return peer_connection_ != nullptr;
+    if (!peer_connection_) return false;
+
+    CreateCursorChannels();
+
+    // Input is latency-critical and the protocol carries its own sequence
+    // numbers, so never let SCTP hold a fresh event behind a lost one.
+    webrtc::DataChannelInit inputInit;
+    inputInit.ordered = false;
+    inputInit.maxRetransmits = 0;
+    auto input = peer_connection_->CreateDataChannelOrError("input", &inputInit);
+    if (input.ok()) {
+        AttachInputChannel(input.MoveValue());
+    } else {
+        STREAM_LOG_ERROR("Failed to create input data channel: {}", input.error().message());
+    }
+    return true;
+}
+
+void WebRTCSession::AttachInputChannel(rtc::scoped_refptr<webrtc::DataChannelInterface> channel) {
+    if (input_channel_) input_channel_->UnregisterObserver();
+    input_channel_ = channel;
+    OnInputReset onReset;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        onReset = on_input_reset_;
+    }
+    if (onReset) onReset();
+    input_channel_->RegisterObserver(&input_observer_);
+}
+
+void WebRTCSession::InputChannelObserver::OnMessage(const webrtc::DataBuffer& buffer) {
+    if (!buffer.binary) return;
+    OnInputMessage onMessage;
+    {
+        std::lock_guard<std::mutex> lock(session_->mutex_);
+        onMessage = session_->on_input_message_;
+    }
+    if (onMessage) onMessage(buffer.data.cdata(), buffer.data.size());
+}
+
+void WebRTCSession::CreateCursorChannels() {
+    // Positions are superseded by the next one, so a lost or late packet is
+    // never worth retransmitting.
+    webrtc::DataChannelInit positionInit;
+    positionInit.ordered = false;
+    positionInit.maxRetransmits = 0;
+    auto position = peer_connection_->CreateDataChannelOrError("cursor", &positionInit);
+    if (position.ok()) {
+        std::lock_guard<std::mutex> lock(cursor_mutex_);
+        cursor_channel_ = position.MoveValue();
+    } else {
+        STREAM_LOG_ERROR("Failed to create cursor data channel: {}", position.error().message());
+    }
+
+    webrtc::DataChannelInit shapeInit;
+    auto shape = peer_connection_->CreateDataChannelOrError("cursor-shape", &shapeInit);
+    if (shape.ok()) {
+        std::lock_guard<std::mutex> lock(cursor_mutex_);
+        cursor_shape_channel_ = shape.MoveValue();
+    } else {
+        STREAM_LOG_ERROR("Failed to create cursor shape data channel: {}", shape.error().message());
+    }
+}
+
+void WebRTCSession::SendCursorUpdate(const CursorData& cursor) {
+    // The channels appear once a peer connects, on another thread.
+    rtc::scoped_refptr<webrtc::DataChannelInterface> positionChannel, shapeChannel;
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex_);
+        positionChannel = cursor_channel_;
+        shapeChannel = cursor_shape_channel_;
+    }
+    // Keep the latest shape around so a viewer whose channel opens after
+    // the shape last changed still gets it.
+    if (cursor.pixels)
+        stream::encodeCursorShape(cursor, cursor_shape_payload_);
+    if (!cursor_shape_payload_.empty() && last_cursor_shape_serial_ != cursor.serial &&
+        shapeChannel && shapeChannel->state() == webrtc::DataChannelInterface::kOpen) {
+        if (shapeChannel->Send(webrtc::DataBuffer(
+                rtc::CopyOnWriteBuffer(cursor_shape_payload_.data(), cursor_shape_payload_.size()), true)))
+            last_cursor_shape_serial_ = cursor.serial;
+    }
+
+    if (!positionChannel || positionChannel->state() != webrtc::DataChannelInterface::kOpen)
+        return;
+    // Don't queue stale positions behind a congested link; the next update
+    // replaces this one anyway.
+    if (positionChannel->buffered_amount() > 16 * stream::kCursorPositionSize)
+        return;
+    std::vector<uint8_t> payload;
+    stream::encodeCursorPosition(cursor, payload);
+    positionChannel->Send(webrtc::DataBuffer(rtc::CopyOnWriteBuffer(payload.data(), payload.size()), true));
 }
 
 void WebRTCSession::SetOnOfferCreated(OnOfferCreated callback) {
@@ -72,7 +235,24 @@ void WebRTCSession::SetOnIceCandidate(OnIceCandidate callback) {
     on_ice_candidate_ = callback;
 }
 
+void WebRTCSession::SetOnIceGatheringDone(OnIceGatheringDone callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_ice_gathering_done_ = callback;
+}
+
+void WebRTCSession::SetOnInputMessage(OnInputMessage callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_input_message_ = callback;
+}
+
+void WebRTCSession::SetOnInputReset(OnInputReset callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_input_reset_ = callback;
+}
+
 void WebRTCSession::CreateOffer() {
+    if (!EnsurePeerConnection())
+        return;
     webrtc::PeerConnectionInterface::RTCOfferAnswerOptions options;
     peer_connection_->CreateOffer(this, options);
 }
@@ -90,14 +270,16 @@ void WebRTCSession::OnSuccess(webrtc::SessionDescriptionInterface* desc) {
 }
 
 void WebRTCSession::OnFailure(webrtc::RTCError error) {
-    std::cerr << "Failed to create offer: " << error.message() << std::endl;
+    STREAM_LOG_ERROR("Failed to create offer: {}", error.message());
 }
 
 void WebRTCSession::SetRemoteDescription(const std::string& sdp) {
+    if (!EnsurePeerConnection())
+        return;
     webrtc::SdpParseError error;
     auto session_desc = webrtc::CreateSessionDescription(webrtc::SdpType::kAnswer, sdp, &error);
     if (!session_desc) {
-        std::cerr << "Failed to parse remote SDP: " << error.description << std::endl;
+        STREAM_LOG_ERROR("Failed to parse remote SDP: {}", error.description);
         return;
     }
 
@@ -107,50 +289,88 @@ void WebRTCSession::SetRemoteDescription(const std::string& sdp) {
     );
 }
 
-void WebRTCSession::AddRemoteIceCandidate(const std::string& candidate) {
+void WebRTCSession::AddRemoteIceCandidate(const std::string& candidate, const std::string& mid, int mlineIndex) {
+    if (!EnsurePeerConnection())
+        return;
     webrtc::SdpParseError error;
     std::unique_ptr<webrtc::IceCandidateInterface> ice_candidate(
-        webrtc::CreateIceCandidate("0", 0, candidate, &error));
+        webrtc::CreateIceCandidate(mid, mlineIndex, candidate, &error));
     if (!ice_candidate) {
-        std::cerr << "Failed to parse ICE candidate: " << error.description << std::endl;
+        STREAM_LOG_ERROR("Failed to parse ICE candidate: {}", error.description);
         return;
     }
     peer_connection_->AddIceCandidate(ice_candidate.get());
 }
 
-void WebRTCSession::OnSignalingChange(webrtc::PeerConnectionInterface::SignalingState new_state) {}
-void WebRTCSession::OnIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionState new_state) {}
-void WebRTCSession::OnIceGatheringChange(webrtc::PeerConnectionInterface::IceGatheringState new_state) {}
+void WebRTCSession::OnSignalingChange(webrtc::PeerConnectionInterface::SignalingState new_state) {
+    stream::pipelineCounters().signalingState.store(new_state, std::memory_order_relaxed);
+    stream::log_info(std::string("Signaling state: ") +
+                     webrtc::PeerConnectionInterface::AsString(new_state).data());
+}
+
+void WebRTCSession::OnIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionState new_state) {
+    stream::pipelineCounters().iceConnectionState.store(new_state, std::memory_order_relaxed);
+    stream::log_info(std::string("ICE connection state: ") +
+                     webrtc::PeerConnectionInterface::AsString(new_state).data());
+}
+void WebRTCSession::OnIceGatheringChange(webrtc::PeerConnectionInterface::IceGatheringState new_state) {
+    if (new_state == webrtc::PeerConnectionInterface::kIceGatheringComplete && on_ice_gathering_done_)
+        on_ice_gathering_done_();
+}
 
 void WebRTCSession::OnIceCandidate(const webrtc::IceCandidateInterface* candidate) {
     std::string sdp;
     candidate->ToString(&sdp);
     if (on_ice_candidate_) {
-        on_ice_candidate_(sdp);
+        on_ice_candidate_(sdp, candidate->sdp_mid(), candidate->sdp_mline_index());
     }
 }
 
-void WebRTCSession::OnDataChannel(rtc::scoped_refptr<webrtc::DataChannelInterface> channel) {}
+void WebRTCSession::OnDataChannel(rtc::scoped_refptr<webrtc::DataChannelInterface> channel) {
+    // A viewer may open its own input channel instead of using ours.
+    if (channel->label() == "input")
+        AttachInputChannel(channel);
+}
 void WebRTCSession::OnRenegotiationNeeded() {}
 
 void WebRTCSession::AddVideoSource(rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> source) {
-    video_track_ = peer_connection_factory_->CreateVideoTrack("video", source);
+    std::lock_guard<std::mutex> lock(factory_mutex_);
+    video_track_source_ = source;
+    if (peer_connection_)
+        AttachVideoTrack();
+}
+
+void WebRTCSession::AttachVideoTrack() {
+    video_track_ = peer_connection_factory_->CreateVideoTrack("video", video_track_source_);
     auto result = peer_connection_->AddTrack(video_track_, {"stream_id"});
     if (!result.ok()) {
-        std::cerr << "Failed to add video track." << std::endl;
+        STREAM_LOG_ERROR("Failed to add video track.");
     }
 }
 
+void WebRTCSession::PushAudioFrame(const AudioFrame& frame) {
+    if (audio_source_)
+        audio_source_->PushAudio(frame);
+}
+
 void WebRTCSession::AddAudioSource(rtc::scoped_refptr<webrtc::AudioSourceInterface> source) {
-    audio_track_ = peer_connection_factory_->CreateAudioTrack("audio", source);
+    std::lock_guard<std::mutex> lock(factory_mutex_);
+    audio_track_source_ = source;
+    if (peer_connection_)
+        AttachAudioTrack();
+}
+
+void WebRTCSession::AttachAudioTrack() {
+    audio_track_ = peer_connection_factory_->CreateAudioTrack("audio", audio_track_source_);
     auto result = peer_connection_->AddTrack(audio_track_, {"stream_id"});
     if (!result.ok()) {
-        std::cerr << "Failed to add audio track." << std::endl;
+        STREAM_LOG_ERROR("Failed to add audio track.");
     }
 }
 
 bool WebRTCSession::Start(const std::string& signalingUrl, const std::string& streamId) {
-    Logger::Info("WebRTC Session starting...");
+    STREAM_LOG_INFO("WebRTC Session starting...");
+    StartStats();
 
     // Create modules
     capture_ = std::unique_ptr<Capture>(CreateCapture());
@@ -161,39 +381,59 @@ bool WebRTCSession::Start(const std::string& signalingUrl, const std::string& st
     auto video_source = rtc::make_ref_counted<FrameVideoSource>();
     AddVideoSource(video_source);
 
+    // Messages are handled on the session loop as they arrive.
+    signaling_->attach(loop_);
     if (!signaling_->Connect()) {
-        Logger::Error("Failed to connect signaling");
+        STREAM_LOG_ERROR("Failed to connect signaling");
         return false;
     }
 
-    if (!encoder_->Start(1920, 1080, 30, 
-        [this, video_source](const EncodedFrame& frame) {
-            // Convert BGRA to I420 and push to WebRTC
-            int width = 1920, height = 1080;
-            rtc::scoped_refptr<webrtc::I420Buffer> buffer =
-                webrtc::I420Buffer::Create(width, height);
-            ConvertBGRAtoI420(frame.data, width, height,
-                buffer->MutableDataY(), buffer->StrideY(),
-                buffer->MutableDataU(), buffer->StrideU(),
-                buffer->MutableDataV(), buffer->StrideV());
-            webrtc::VideoFrame videoFrame = webrtc::VideoFrame::Builder()
-                .set_video_frame_buffer(buffer)
-                .set_timestamp_us(frame.timestamp)
-                .set_rotation(webrtc::kVideoRotation_0)
-                .build();
-            video_source->PushFrame(videoFrame);
-        })) {
-        Logger::Error("Failed to start encoder");
+    if (config_.capture.target().kind != CaptureTarget::Kind::Screen)
+        capture_->SetTarget(config_.capture.target());
+    capture_->SetFrameRate(config_.capture.framerate);
+    auto onEncoded = [this, video_source](const EncodedFrame& frame) {
+        const int width = encode_pipeline_.width(), height = encode_pipeline_.height();
+        // Convert BGRA to I420 and push to WebRTC
+        rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+            webrtc::I420Buffer::Create(width, height);
+        ConvertBGRAtoI420(frame.data, width, height,
+            buffer->MutableDataY(), buffer->StrideY(),
+            buffer->MutableDataU(), buffer->StrideU(),
+            buffer->MutableDataV(), buffer->StrideV());
+        webrtc::VideoFrame videoFrame = webrtc::VideoFrame::Builder()
+            .set_video_frame_buffer(buffer)
+            .set_timestamp_us(frame.timestamp)
+            .set_rotation(webrtc::kVideoRotation_0)
+            .build();
+        video_source->PushFrame(videoFrame);
+    };
+    stream::EncodePipeline::Settings settings;
+    settings.width = config_.capture.width;
+    settings.height = config_.capture.height;
+    settings.framerate = config_.capture.framerate;
+    settings.bitrate = config_.encode.bitrate;
+    settings.vfr = config_.encode.vfr;
+    if (!encode_pipeline_.start(*encoder_, settings, onEncoded)) {
+        STREAM_LOG_ERROR("Failed to start encoder");
         return false;
     }
 
-    if (!capture_->Start([this](const FrameData& frame) {
-        encoder_->EncodeFrame(frame.data, frame.stride);
-    })) {
-        Logger::Error("Failed to start capture");
+    capture_->SetCursorCallback([this](const CursorData& cursor) {
+        SendCursorUpdate(cursor);
+    });
+    // New capture sizes are followed in place where the encoder can; the
+    // track just sees frames of the new size, so nothing is renegotiated.
+    if (!capture_->Start([this](const FrameData& frame) { encode_pipeline_.onFrame(frame); })) {
+        STREAM_LOG_ERROR("Failed to start capture");
         return false;
     }
 
+    if (config_.audio.enabled) {
+        audio_capture_ = createPlatformAudioCapture(config_.audio.device);
+        if (!audio_capture_ || !audio_capture_->Start([this](const AudioFrame& frame) { PushAudioFrame(frame); }))
+            STREAM_LOG_WARN("Audio capture unavailable, streaming video only");
+    }
+
     running_ = true;
     processingThread_ = std::thread(&WebRTCSession::CaptureAndSendLoop, this);
     return true;
@@ -201,21 +441,22 @@ bool WebRTCSession::Start(const std::string& signalingUrl, const std::string& st
 
 void WebRTCSession::Stop() {
     running_ = false;
+    loop_.stop();
     if (processingThread_.joinable())
         processingThread_.join();
 
     if (capture_) capture_->Stop();
+    if (audio_capture_) audio_capture_->Stop();
     if (encoder_) encoder_->Stop();
     if (signaling_) signaling_->Disconnect();
 
-    Logger::Info("WebRTC Session stopped.");
+    STREAM_LOG_INFO("WebRTC Session stopped.");
 }
 
 void WebRTCSession::CaptureAndSendLoop() {
-    while (running_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        signaling_->ProcessMessages();
-    }
+    stream::ThreadScope scope(stream::ThreadRole::Control, "session-pump");
+    // Blocks until a signaling message or timer is due; Stop() ends it.
+    loop_.run();
 }
 
 void WebRTCSession::OnEncodedFrame(const EncodedFrame& frame) {
@@ -0,0 +1,20 @@
+#pragma once
+#include <iostream>
+
+// The unit tests are plain programs: expect() reports a failed check and
+// carries on, and main() ends with `return report("Name test");`.
+inline int failures = 0;
+
+inline void expect(bool cond, const char* what) {
+    if (!cond) {
+        std::cout << "[TEST] FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+inline int report(const char* name) {
+    if (failures == 0) {
+        std::cout << "[TEST] " << name << " PASSED." << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
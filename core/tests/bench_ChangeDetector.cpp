@@ -0,0 +1,65 @@
+// Cost of the tile change detector on 4K BGRA frames. Not part of ctest.
+// Two cases per row stride: a static desktop and one where a sixth of the
+// width and height (a 640x360 video at 4K, ~3% of the screen) changes
+// every frame. Reported as time per
+// frame and share of one core at 60 fps:
+//   ./bench_ChangeDetector [width] [height]
+#include "../include/ChangeDetector.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    const int width = argc > 1 ? atoi(argv[1]) : 3840;
+    const int height = argc > 2 ? atoi(argv[2]) : 2160;
+    const int stride = width * 4;
+    const int frames = 240;
+
+    // Two buffers, as a double-buffered capture hands them over, so every
+    // frame is read from memory rather than cache.
+    std::vector<uint8_t> buffers[2];
+    for (auto& b : buffers) {
+        b.resize(size_t(stride) * height);
+        for (size_t i = 0; i < b.size(); ++i) b[i] = uint8_t(i * 131 + (i >> 12));
+    }
+
+    printf("%dx%d\n", width, height);
+    for (int rowStride : {1, 2, 4, 8}) {
+        for (bool video : {false, true}) {
+            stream::TileChangeDetector detector({rowStride});
+            buffers[1] = buffers[0];
+            size_t dirty = 0;
+            double total = 0;
+            for (int i = 0; i < frames; ++i) {
+                std::vector<uint8_t>& b = buffers[i & 1];
+                if (video) {
+                    for (int y = height / 10; y < height / 10 + height / 6; ++y)
+                        for (int x = width / 10; x < width / 10 + width / 6; x += 3)
+                            b[size_t(y) * stride + size_t(x) * 4] = uint8_t(i + x);
+                } else if (i > 1) {
+                    b = buffers[(i & 1) ^ 1]; // outside the timed part
+                }
+                FrameData f{};
+                f.data = b.data();
+                f.width = width;
+                f.height = height;
+                f.stride = stride;
+                f.size = b.size();
+                auto t0 = Clock::now();
+                size_t n = detector.process(f);
+                double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+                if (i > 0) { // the first frame hashes everything
+                    total += ms;
+                    dirty += n;
+                }
+            }
+            double perFrame = total / (frames - 1);
+            printf("rowStride %d %-7s %6.3f ms/frame  %5.1f%% of a core at 60 fps  %5.1f dirty tiles/frame\n",
+                   rowStride, video ? "video" : "static", perFrame, perFrame * 60 / 10, double(dirty) / (frames - 1));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Savings of the VFR pacer on a synthetic, mostly static desktop. Not part
+// of ctest. Ten seconds at 60 fps: a cursor blinks every 500ms for the
+// first five, with a second of typing at the start and a half-second
+// scroll at 3s, which is long enough to be refined once it stops. The last
+// five seconds are idle, so only keepalive refreshes go out. Each frame
+// goes through change detection, then (if the pacer lets it) the BGRA to
+// I420 conversion every encoder input pays, standing in for the encoder.
+// Reported with pacing off and on:
+//   ./bench_FramePacer [width] [height]
+#include "../include/ChangeDetector.h"
+#include "../include/ColorConvert.h"
+#include "../include/FramePacer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    const int width = argc > 1 ? atoi(argv[1]) : 1920;
+    const int height = argc > 2 ? atoi(argv[2]) : 1080;
+    const int stride = width * 4;
+    const int fps = 60;
+    const int frames = 10 * fps;
+    const uint64_t frameMicros = 1000000 / fps;
+
+    std::vector<uint8_t> desktop(size_t(stride) * height);
+    for (size_t i = 0; i < desktop.size(); ++i) desktop[i] = uint8_t(i * 131 + (i >> 12));
+    std::vector<uint8_t> y(size_t(width) * height), u(y.size() / 4), v(y.size() / 4);
+
+    printf("%dx%d, %d frames\n", width, height, frames);
+    for (bool vfr : {false, true}) {
+        std::vector<uint8_t> screen = desktop;
+        stream::TileChangeDetector detector;
+        stream::FramePacer pacer({vfr});
+        size_t encoded = 0, dirtyTiles = 0;
+        double detectMs = 0, encodeMs = 0;
+        for (int i = 0; i < frames; ++i) {
+            uint64_t t = uint64_t(i) * frameMicros;
+            // Cursor: a 2x20 bar toggling twice a second until the idle part.
+            if (t < 5000000 && t % 500000 < frameMicros) {
+                for (int row = 200; row < 220; ++row)
+                    for (int x = 300; x < 302; ++x) screen[size_t(row) * stride + size_t(x) * 4] ^= 0xff;
+            }
+            // Typing: one 8x16 glyph every 100ms during the first second.
+            if (t < 1000000 && t % 100000 < frameMicros) {
+                int column = int(t % 1000000 / 100000);
+                for (int row = 400; row < 416; ++row)
+                    for (int x = 100 + column * 8; x < 108 + column * 8; ++x)
+                        screen[size_t(row) * stride + size_t(x) * 4 + 1] = uint8_t(i);
+            }
+            // Scroll: the middle half of the screen moves up 8 rows a frame
+            // for half a second, new content coming in at the bottom.
+            if (t >= 3000000 && t < 3500000) {
+                int top = height / 4, rows = height / 2;
+                uint8_t* region = screen.data() + size_t(top) * stride;
+                memmove(region, region + size_t(8) * stride, size_t(rows - 8) * stride);
+                for (size_t b = size_t(rows - 8) * stride; b < size_t(rows) * stride; ++b)
+                    region[b] = uint8_t(b * 7 + i);
+            }
+
+            FrameData f{};
+            f.data = screen.data();
+            f.width = width;
+            f.height = height;
+            f.stride = stride;
+            f.size = screen.size();
+            f.timestamp = t;
+            auto t0 = Clock::now();
+            detector.process(f);
+            auto t1 = Clock::now();
+            detectMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            if (pacer.decide(f) == stream::FramePacer::Decision::Drop) continue;
+            ConvertBGRAtoI420(f.data, width, height, y.data(), width, u.data(), width / 2, v.data(), width / 2);
+            encodeMs += std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+            ++encoded;
+            if (i > 0) dirtyTiles += f.dirtyTileCount; // the first frame is all dirty
+        }
+        double seconds = double(frames) / fps;
+        const auto& s = pacer.stats();
+        printf("vfr %-3s  %5.1f frames/s to the encoder (%zu: %llu changed, %llu refine, %llu refresh)\n"
+               "         detect %5.2f ms/s, encoder input %6.2f ms/s, %4.1f%% of a core, %.1f dirty tiles/s sent\n",
+               vfr ? "on" : "off", encoded / seconds, encoded, (unsigned long long)s.encoded,
+               (unsigned long long)s.refined, (unsigned long long)s.refreshed, detectMs / seconds, encodeMs / seconds,
+               (detectMs + encodeMs) / seconds / 10, dirtyTiles / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Cold-start benchmark: time to first encoded frame with the old serial
+// sequence versus the startup orchestrator with a lazy PeerConnectionFactory.
+// Not part of ctest. Subsystems are stand-ins that sleep for typical init
+// costs (in ms, scaled by the optional argument), so the numbers compare
+// the sequencing, not any particular machine:
+//   ./bench_Startup [scale]
+#include "../include/Startup.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static double g_scale = 1.0;
+
+static bool cost(int ms) {
+    std::this_thread::sleep_for(std::chrono::microseconds(int64_t(ms * 1000 * g_scale)));
+    return true;
+}
+
+// Rough costs on a desktop with VAAPI: probes, X connection + XShm,
+// VAAPI context, uinput device, websocket client, and the factory with its
+// three threads and codec factories.
+static bool probes() { return cost(30); }
+static bool createCapture() { return cost(15); }
+static bool createEncoder() { return cost(40); }
+static bool createInput() { return cost(5); }
+static bool createSignaling() { return cost(10); }
+static bool createPeerConnectionFactory() { return cost(120); }
+static bool connectSignaling() { return cost(25); }
+static bool startEncoder() { return cost(20); }
+static bool startCapture() { return cost(5); }
+static void firstFrame() { cost(16); } // one capture interval plus encode
+
+static double Millis(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) g_scale = atof(argv[1]);
+    const int runs = 5;
+    double serial = 0, orchestrated = 0;
+
+    for (int i = 0; i < runs; ++i) {
+        // The previous sequence: everything in order, factory up front.
+        auto t0 = Clock::now();
+        probes();
+        createCapture();
+        createEncoder();
+        createInput();
+        createSignaling();
+        createPeerConnectionFactory();
+        connectSignaling();
+        startEncoder();
+        startCapture();
+        firstFrame();
+        serial += Millis(t0);
+
+        stream::StartupOrchestrator startup;
+        startup.add("health", probes);
+        startup.add("capture", createCapture);
+        startup.add("encoder", createEncoder);
+        startup.add("input", createInput);
+        startup.add("signaling", createSignaling);
+        startup.run();
+        startup.add("signaling.connect", connectSignaling);
+        startup.add("encoder.start", startEncoder);
+        startup.add("capture.start", startCapture, {"encoder.start"});
+        startup.run();
+        firstFrame();
+        startup.markFirstFrame();
+        orchestrated += startup.timeToFirstFrame().count() / 1000.0;
+    }
+
+    std::cout << "[BENCH] Serial startup, time to first frame: " << serial / runs << " ms" << std::endl;
+    std::cout << "[BENCH] Orchestrated startup, time to first frame: " << orchestrated / runs << " ms" << std::endl;
+    std::cout << "[BENCH] Speedup: " << serial / orchestrated << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Throughput benchmark for the v4l2loopback output path. Not part of ctest:
+// it needs a loopback device, e.g.
+//   sudo modprobe v4l2loopback video_nr=10 exclusive_caps=1
+//   ./bench_V4L2VirtualCamera /dev/video10 1280 720
+#include "../include/V4L2VirtualCamera.h"
+#include "../include/ColorConvert.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double Seconds(Clock::time_point since) {
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+int main(int argc, char** argv) {
+    const char* device = argc > 1 ? argv[1] : "/dev/video10";
+    const int width = argc > 2 ? atoi(argv[2]) : 1280;
+    const int height = argc > 3 ? atoi(argv[3]) : 720;
+    const int frames = 300;
+
+    std::vector<uint8_t> bgra(size_t(width) * height * 4);
+    for (size_t i = 0; i < bgra.size(); ++i) bgra[i] = uint8_t(i * 7);
+
+    // Baseline of the old path: convert into a staging buffer, then write().
+    std::vector<uint8_t> staging(size_t(width) * height * 2);
+    auto t0 = Clock::now();
+    for (int i = 0; i < frames; ++i)
+        ConvertBGRAtoYUYV(bgra.data(), width * 4, width, height, staging.data(), width * 2);
+    double convertOnly = Seconds(t0);
+    std::cout << "[BENCH] YUYV conversion only: " << frames / convertOnly << " fps" << std::endl;
+
+    std::string reason;
+    if (!V4L2VirtualCamera::LoopbackAvailable(&reason)) {
+        std::cout << "[BENCH] Skipping device runs: " << reason << std::endl;
+        return 0;
+    }
+
+    {
+        V4L2VirtualCamera cam(device);
+        if (!cam.Open()) return 1;
+        t0 = Clock::now();
+        for (int i = 0; i < frames; ++i) {
+            ConvertBGRAtoYUYV(bgra.data(), width * 4, width, height, staging.data(), width * 2);
+            cam.WriteFrame(staging.data(), staging.size());
+        }
+        std::cout << "[BENCH] write(): " << frames / Seconds(t0) << " fps" << std::endl;
+    }
+
+    const stream::FramePixelFormat formats[] = {stream::FramePixelFormat::YUYV, stream::FramePixelFormat::NV12,
+                                                stream::FramePixelFormat::I420};
+    const char* names[] = {"YUYV", "NV12", "I420"};
+    for (int f = 0; f < 3; ++f) {
+        V4L2VirtualCamera cam(device);
+        if (!cam.Open() || !cam.Configure(width, height, formats[f])) {
+            std::cout << "[BENCH] " << names[f] << ": not supported by device" << std::endl;
+            continue;
+        }
+        int written = 0;
+        t0 = Clock::now();
+        for (int i = 0; i < frames; ++i)
+            written += cam.WriteFrameBGRA(bgra.data(), width * 4, uint64_t(i) * 33333) ? 1 : 0;
+        std::cout << "[BENCH] mmap " << names[f] << (cam.Streaming() ? "" : " (write fallback)") << ": "
+                  << written / Seconds(t0) << " fps, " << frames - written << " dropped" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Grab latency of the X11 capture backend, synchronous XShmGetImage versus
+// the pipelined shared-pixmap copy. Not part of ctest: it needs an X server
+// with MIT-SHM, ideally at the size that matters, e.g.
+//   Xvfb :99 -screen 0 3840x2160x24 &
+//   DISPLAY=:99 ./bench_X11Capture [fps] [encode_ms]
+// Every frame is converted to NV12 like the v4l2 path does, then the
+// callback sleeps for encode_ms to stand in for the encoder.
+#include "../include/ColorConvert.h"
+#include "../include/PipelineStats.h"
+#include "../src/capture/LinuxCaptureBackends.h"
+#include <X11/Xlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+    double fps = 0;
+    double grabMs = 0;  // capture thread blocked on the server, per frame
+    double ageMs = 0;   // grab issued -> callback entered
+};
+
+static Result Run(bool pipelined, int fps, int encodeMs) {
+    auto capture = createX11Capture(pipelined);
+    capture->SetFrameRate(fps);
+
+    std::vector<uint8_t> y, uv;
+    std::atomic<uint64_t> frames{0};
+    uint64_t ageTotal = 0;
+    auto& counters = stream::pipelineCounters();
+    uint64_t grabBefore = counters.grabMicros.load();
+
+    auto start = Clock::now();
+    capture->Start([&](const FrameData& frame) {
+        ageTotal += NowMicros() - frame.timestamp;
+        int w = frame.width & ~1, h = frame.height & ~1;
+        y.resize(size_t(w) * h);
+        uv.resize(size_t(w) * h / 2);
+        ConvertBGRAtoNV12(frame.data, frame.stride, w, h, y.data(), w, uv.data(), w);
+        std::this_thread::sleep_for(std::chrono::milliseconds(encodeMs));
+        frames.fetch_add(1);
+    });
+    std::this_thread::sleep_for(std::chrono::seconds(5));
+    capture->Stop();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result r;
+    uint64_t n = std::max<uint64_t>(frames.load(), 1);
+    r.fps = frames.load() / seconds;
+    r.grabMs = (counters.grabMicros.load() - grabBefore) / 1000.0 / n;
+    r.ageMs = ageTotal / 1000.0 / n;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    const int fps = argc > 1 ? atoi(argv[1]) : 60;
+    const int encodeMs = argc > 2 ? atoi(argv[2]) : 8;
+
+    Display* display = XOpenDisplay(nullptr);
+    if (!display) {
+        std::cout << "No X display, skipping." << std::endl;
+        return 0;
+    }
+    std::cout << "Screen " << DisplayWidth(display, 0) << "x" << DisplayHeight(display, 0) << ", target " << fps
+              << " fps, encode " << encodeMs << " ms" << std::endl;
+    XCloseDisplay(display);
+
+    for (bool pipelined : {false, true}) {
+        Result r = Run(pipelined, fps, encodeMs);
+        printf("%-13s %6.1f fps  grab %6.2f ms/frame  frame age %6.2f ms\n",
+               pipelined ? "pipelined" : "XShmGetImage", r.fps, r.grabMs, r.ageMs);
+    }
+    return 0;
+}
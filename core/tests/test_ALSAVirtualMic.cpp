@@ -0,0 +1,213 @@
+#include "../include/ALSAVirtualMic.h"
+#include "TestUtil.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Simulated playback device. The test drives "hardware time" with tick(),
+// which plays one period; the eventfd stands in for the PCM poll descriptor.
+class FakePcm : public PcmBackend {
+public:
+    struct State {
+        std::mutex mutex;
+        std::deque<int16_t> queued;
+        std::vector<int16_t> played;
+        PcmConfig config;
+        bool xrun = false;
+        int eventFd = -1;
+    };
+    explicit FakePcm(State& s) : s_(s) {}
+
+    bool Open(PcmConfig& config) override {
+        std::lock_guard<std::mutex> lock(s_.mutex);
+        s_.config = config;
+        s_.eventFd = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+        return true;
+    }
+    void Close() override {
+        std::lock_guard<std::mutex> lock(s_.mutex);
+        if (s_.eventFd >= 0) close(s_.eventFd);
+        s_.eventFd = -1;
+    }
+    int PollDescriptors(pollfd* fds, int) override {
+        fds[0] = {s_.eventFd, POLLIN, 0};
+        return 1;
+    }
+    bool Writable(pollfd* fds, int) override {
+        uint64_t v;
+        (void)!read(fds[0].fd, &v, sizeof(v));
+        return fds[0].revents & POLLIN;
+    }
+    long Available() override {
+        std::lock_guard<std::mutex> lock(s_.mutex);
+        if (s_.xrun) return -EPIPE;
+        return long(bufferFrames() - s_.queued.size() / s_.config.channels);
+    }
+    long WriteFrames(const int16_t* data, unsigned long frames) override {
+        std::lock_guard<std::mutex> lock(s_.mutex);
+        if (s_.xrun) return -EPIPE;
+        unsigned long room = bufferFrames() - s_.queued.size() / s_.config.channels;
+        frames = std::min(frames, room);
+        s_.queued.insert(s_.queued.end(), data, data + frames * s_.config.channels);
+        return long(frames);
+    }
+    bool Recover(int) override {
+        std::lock_guard<std::mutex> lock(s_.mutex);
+        s_.xrun = false;
+        s_.queued.clear();
+        signal();
+        return true;
+    }
+
+    // Plays one period; runs dry -> xrun.
+    static void tick(State& s) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        size_t samples = size_t(s.config.periodFrames) * s.config.channels;
+        if (s.queued.size() < samples) {
+            s.xrun = true;
+        } else {
+            s.played.insert(s.played.end(), s.queued.begin(), s.queued.begin() + samples);
+            s.queued.erase(s.queued.begin(), s.queued.begin() + samples);
+        }
+        signal(s);
+    }
+
+private:
+    State& s_;
+    size_t bufferFrames() const { return size_t(s_.config.periodFrames) * s_.config.periods; }
+    void signal() { signal(s_); }
+    static void signal(State& s) {
+        uint64_t one = 1;
+        (void)!write(s.eventFd, &one, sizeof(one));
+    }
+};
+
+static void settle() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
+
+int main() {
+    FakePcm::State state;
+    ALSAVirtualMic mic(std::make_unique<FakePcm>(state));
+    ALSAVirtualMic::Params params;
+    params.sampleRate = 48000;
+    params.channels = 1;
+    params.periodMicros = 10000;
+    params.periods = 2;
+    expect(mic.Open(params), "open");
+    expect(mic.Config().periodFrames == 480, "10 ms period at 48 kHz");
+
+    std::cout << "[TEST] Virtual mic keeps order and never runs dry" << std::endl;
+    const int period = 480;
+    std::vector<int16_t> chunk(period);
+    int16_t next = 1;
+    for (int i = 0; i < 50; ++i) {
+        for (auto& s : chunk) s = next++;
+        expect(mic.Write(chunk.data(), period) == size_t(period), "write accepted");
+        settle();
+        FakePcm::tick(state);
+    }
+    settle();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        int16_t expectNext = 1;
+        bool ordered = true;
+        for (int16_t s : state.played) {
+            if (s == 0) continue; // silence
+            ordered = ordered && s == expectNext;
+            expectNext = int16_t(s + 1);
+        }
+        expect(ordered, "samples played in order without loss");
+        expect(state.played.size() == size_t(50 * period), "one period per tick");
+    }
+    expect(mic.GetStats().xruns == 0, "no xruns while fed");
+
+    std::cout << "[TEST] Virtual mic pads with silence when starved" << std::endl;
+    uint64_t silenceBefore = mic.GetStats().silenceFrames;
+    for (int i = 0; i < 5; ++i) {
+        FakePcm::tick(state);
+        settle();
+    }
+    expect(mic.GetStats().silenceFrames > silenceBefore, "silence inserted");
+    expect(mic.GetStats().xruns == 0, "starvation did not cause xruns");
+
+    std::cout << "[TEST] Virtual mic trims the backlog left by an underrun" << std::endl;
+    // The device is full of padding, so a burst after the gap would sit in
+    // the ring for good; all but the 20 ms target is dropped.
+    std::vector<int16_t> burst(size_t(6) * period, -5);
+    expect(mic.Write(burst.data(), burst.size()) == burst.size(), "burst accepted");
+    for (int i = 0; i < 8; ++i) {
+        FakePcm::tick(state);
+        settle();
+    }
+    expect(mic.GetStats().trimmedFrames > 0, "backlog trimmed");
+    {
+        // At most a refill's worth plus the 20 ms target of the 60 ms burst
+        // is played; the rest would have been added latency.
+        std::lock_guard<std::mutex> lock(state.mutex);
+        size_t burstPlayed = size_t(std::count(state.played.begin(), state.played.end(), int16_t(-5)));
+        expect(burstPlayed >= size_t(period) && burstPlayed <= size_t(3 * period), "latency back to target");
+    }
+
+    std::cout << "[TEST] Virtual mic recovers from xrun" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.xrun = true;
+        uint64_t one = 1;
+        (void)!write(state.eventFd, &one, sizeof(one));
+    }
+    settle();
+    expect(mic.GetStats().xruns == 1, "xrun counted");
+    for (auto& s : chunk) s = 7;
+    mic.Write(chunk.data(), period);
+    settle();
+    FakePcm::tick(state);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        expect(!state.xrun, "stream running after recovery");
+    }
+
+    std::cout << "[TEST] Virtual mic drops when the producer runs ahead" << std::endl;
+    std::vector<int16_t> flood(48000, 1);
+    size_t accepted = mic.Write(flood.data(), flood.size());
+    expect(accepted < flood.size() && mic.GetStats().droppedFrames == flood.size() - accepted, "overflow counted");
+
+    mic.Close();
+
+    std::cout << "[TEST] Virtual mic keeps whole frames with odd channel counts" << std::endl;
+    {
+        FakePcm::State state3;
+        ALSAVirtualMic mic3(std::make_unique<FakePcm>(state3));
+        ALSAVirtualMic::Params params3;
+        params3.channels = 3; // ring capacity is a power of two, not a multiple of 3
+        expect(mic3.Open(params3), "open 3 channels");
+        std::vector<int16_t> frames(size_t(48000) * 3);
+        for (size_t i = 0; i < frames.size(); ++i) frames[i] = int16_t(1 + i % 3);
+        mic3.Write(frames.data(), 48000);
+        mic3.Write(frames.data(), 480);
+        for (int i = 0; i < 10; ++i) {
+            FakePcm::tick(state3);
+            settle();
+            mic3.Write(frames.data(), 480);
+        }
+        mic3.Close();
+        std::lock_guard<std::mutex> lock(state3.mutex);
+        bool aligned = !state3.played.empty();
+        size_t audible = 0;
+        for (size_t i = 0; i + 2 < state3.played.size(); i += 3) {
+            const int16_t* f = &state3.played[i];
+            aligned = aligned && ((f[0] == 1 && f[1] == 2 && f[2] == 3) || (f[0] == 0 && f[1] == 0 && f[2] == 0));
+            audible += f[0] != 0;
+        }
+        expect(aligned, "interleaving preserved when the ring fills");
+        // A stray sample would also wedge the refill at the ring's wrap.
+        expect(audible >= size_t(8) * 480, "audio keeps flowing");
+    }
+
+    return report("Virtual mic test");
+}
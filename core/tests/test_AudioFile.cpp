@@ -0,0 +1,137 @@
+#include "../include/AudioFile.h"
+#include "../include/AudioRecorder.h"
+#include "../include/WireFormat.h"
+#include "TestUtil.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+static std::vector<uint8_t> slurp(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+}
+
+// Writes `frames` stereo frames whose left sample is the frame number.
+static void writeRamp(const std::string& path, stream::AudioContainer container, size_t frames) {
+    stream::AudioFileWriter w;
+    stream::AudioFormat format;
+    format.sampleRate = 48000;
+    format.channels = 2;
+    expect(w.open(path, format, container), "writer opened");
+    std::vector<int16_t> chunk;
+    for (size_t i = 0; i < frames;) {
+        size_t n = std::min<size_t>(480, frames - i);
+        chunk.resize(n * 2);
+        for (size_t j = 0; j < n; ++j) {
+            chunk[j * 2] = int16_t(i + j);
+            chunk[j * 2 + 1] = int16_t(-int(i + j));
+        }
+        w.write(chunk.data(), n);
+        i += n;
+    }
+    expect(w.frames() == frames, "writer counted frames");
+    expect(w.close(), "writer closed");
+}
+
+static void checkRamp(const std::string& path, stream::AudioContainer container, size_t frames) {
+    stream::AudioFileReader r;
+    expect(r.open(path), "reader opened");
+    expect(r.container() == container, "container detected");
+    expect(r.format().sampleRate == 48000 && r.format().channels == 2 && r.format().bitsPerSample == 16,
+           "format parsed");
+    expect(r.totalFrames() == frames, "frame count");
+    // Frame-accurate seek.
+    expect(r.seek(12345), "seek");
+    const int16_t* data = nullptr;
+    size_t n = r.read(data, 10);
+    expect(n == 10 && data[0] == int16_t(12345) && data[1] == int16_t(-12345) && data[18] == int16_t(12354),
+           "samples after seek");
+    expect(r.seek(frames - 3) && r.read(data, 10) == 3 && r.read(data, 10) == 0, "read stops at the end");
+    expect(!r.seek(frames + 1), "seek past end rejected");
+}
+
+int main() {
+    const std::string base = "/tmp/stream-audiofile-" + std::to_string(getpid());
+    const size_t frames = 48000;
+
+    std::cout << "[TEST] WAV round trip" << std::endl;
+    writeRamp(base + ".wav", stream::AudioContainer::Wav, frames);
+    {
+        auto bytes = slurp(base + ".wav");
+        using stream::wire::getLE16;
+        using stream::wire::getLE32;
+        expect(!memcmp(bytes.data(), "RIFF", 4) && getLE32(&bytes[4]) == bytes.size() - 8, "RIFF size");
+        expect(!memcmp(&bytes[12], "JUNK", 4), "ds64 space reserved");
+        // fmt body starts after RIFF(12) + JUNK(36) + fmt header(8).
+        expect(getLE16(&bytes[56 + 2]) == 2, "channel count is a 2-byte field");
+        expect(getLE32(&bytes[56 + 4]) == 48000, "sample rate");
+        expect(getLE32(&bytes[76]) == frames * 4, "data size");
+    }
+    checkRamp(base + ".wav", stream::AudioContainer::Wav, frames);
+
+    std::cout << "[TEST] RF64 round trip" << std::endl;
+    writeRamp(base + ".rf64.wav", stream::AudioContainer::RF64, frames);
+    {
+        auto bytes = slurp(base + ".rf64.wav");
+        expect(!memcmp(bytes.data(), "RF64", 4) && !memcmp(&bytes[12], "ds64", 4), "RF64 header");
+        expect(stream::wire::getLE64(&bytes[28]) == frames * 4, "ds64 data size");
+    }
+    checkRamp(base + ".rf64.wav", stream::AudioContainer::RF64, frames);
+
+    std::cout << "[TEST] W64 round trip" << std::endl;
+    writeRamp(base + ".w64", stream::AudioContainer::W64, frames);
+    checkRamp(base + ".w64", stream::AudioContainer::W64, frames);
+
+    std::cout << "[TEST] Reader skips unknown chunks" << std::endl;
+    {
+        // Hand-built WAV with a LIST chunk (odd size, padded) before fmt.
+        std::vector<uint8_t> f(12 + 8 + 5 + 1 + 8 + 16 + 8 + 8);
+        auto put = [&](size_t at, const char* s) { memcpy(&f[at], s, 4); };
+        put(0, "RIFF");
+        stream::wire::putLE32(&f[4], uint32_t(f.size() - 8));
+        put(8, "WAVE");
+        put(12, "LIST");
+        stream::wire::putLE32(&f[16], 5);
+        put(26, "fmt ");
+        stream::wire::putLE32(&f[30], 16);
+        stream::wire::putLE16(&f[34], 1);
+        stream::wire::putLE16(&f[36], 1);
+        stream::wire::putLE32(&f[38], 16000);
+        stream::wire::putLE16(&f[48], 16);
+        put(50, "data");
+        stream::wire::putLE32(&f[54], 8);
+        stream::wire::putLE16(&f[58], 7);
+        std::ofstream(base + ".list.wav", std::ios::binary).write(reinterpret_cast<const char*>(f.data()), f.size());
+        stream::AudioFileReader r;
+        const int16_t* data = nullptr;
+        expect(r.open(base + ".list.wav") && r.format().sampleRate == 16000 && r.totalFrames() == 4 &&
+               r.read(data, 1) == 1 && data[0] == 7, "chunk walk");
+    }
+
+    std::cout << "[TEST] Replay is paced against absolute deadlines" << std::endl;
+    {
+        int calls = 0;
+        uint64_t lastTs = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        // Each callback burns 3 ms; with relative sleeps that would add up.
+        AudioRecorder::playRecording(base + ".wav", [&](const std::vector<int16_t>& s, uint64_t ts) {
+            ++calls;
+            lastTs = ts;
+            expect(s.size() == 480 * 2, "10 ms chunk");
+            auto busy = std::chrono::steady_clock::now() + std::chrono::milliseconds(3);
+            while (std::chrono::steady_clock::now() < busy) {}
+        }, 48000, 2, 10);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "[TEST] 1.0 s of audio replayed in " << secs << " s" << std::endl;
+        expect(calls == 100 && lastTs == 990, "all chunks with frame-derived timestamps");
+        expect(secs < 1.05, "no accumulated drift");
+    }
+
+    for (const char* ext : {".wav", ".rf64.wav", ".w64", ".list.wav"}) std::remove((base + ext).c_str());
+    return report("Audio file test");
+}
@@ -0,0 +1,64 @@
+#include "../include/Capabilities.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+int main() {
+    std::cout << "[TEST] Probes run in parallel" << std::endl;
+    stream::CapabilityProbes probes;
+    std::atomic<int> runs{0};
+    for (const char* name : {"a", "b", "c", "d"}) {
+        probes.add(name, [&, name](std::string& detail) {
+            ++runs;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            detail = std::string("probed ") + name;
+            return name[0] != 'c';
+        });
+    }
+    auto t0 = Clock::now();
+    auto results = probes.results();
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::cout << "[TEST] 4 x 50 ms probes took " << secs << " s" << std::endl;
+    expect(secs < 0.15, "probes overlapped");
+    expect(results.size() == 4 && results[0].name == "a" && results[3].name == "d", "registration order kept");
+    expect(results[1].available && !results[2].available && results[1].detail == "probed b", "results reported");
+    expect(results[0].elapsed >= std::chrono::milliseconds(50), "timings recorded");
+
+    std::cout << "[TEST] Results are cached" << std::endl;
+    t0 = Clock::now();
+    expect(probes.available("a") && !probes.available("c"), "cached lookups");
+    probes.run();
+    probes.results();
+    expect(runs == 4, "each probe ran once");
+    expect(Clock::now() - t0 < std::chrono::milliseconds(10), "cached lookups don't wait");
+    probes.add("a", [](std::string&) { return false; });
+    expect(probes.available("a"), "finished probes are not replaced");
+
+    std::cout << "[TEST] Lazy and unknown probes" << std::endl;
+    probes.add("lazy", [&](std::string&) {
+        ++runs;
+        return true;
+    });
+    expect(probes.available("lazy") && runs == 5, "lookup runs a pending probe");
+    auto unknown = probes.result("missing");
+    expect(!unknown.available && unknown.name == "missing", "unknown probe unavailable");
+
+    std::cout << "[TEST] Concurrent lookups share one run" << std::endl;
+    stream::CapabilityProbes shared;
+    std::atomic<int> sharedRuns{0};
+    shared.add("slow", [&](std::string&) {
+        ++sharedRuns;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return true;
+    });
+    std::thread others[4];
+    for (auto& t : others) t = std::thread([&] { shared.available("slow"); });
+    for (auto& t : others) t.join();
+    expect(sharedRuns == 1, "single run under contention");
+
+    return report("Capabilities test");
+}
@@ -0,0 +1,145 @@
+#include "../include/ChangeDetector.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+struct Image {
+    int width, height, stride;
+    std::vector<uint8_t> pixels;
+    Image(int w, int h) : width(w), height(h), stride(w * 4 + 32), pixels(size_t(stride) * h) {
+        for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = uint8_t(i * 131 + (i >> 9));
+    }
+    FrameData frame(uint32_t generation = 1) {
+        FrameData f{};
+        f.data = pixels.data();
+        f.width = width;
+        f.height = height;
+        f.stride = stride;
+        f.size = pixels.size();
+        f.generation = generation;
+        return f;
+    }
+    void poke(int x, int y) { pixels[size_t(y) * stride + size_t(x) * 4 + 1] ^= 0x5a; }
+};
+
+static bool tileDirty(const FrameData& f, int tx, int ty) {
+    size_t tile = size_t(ty) * f.tileColumns + tx;
+    return (f.dirtyTiles[tile / 64] >> (tile % 64)) & 1;
+}
+
+int main() {
+    std::cout << "[TEST] First frame and static frames" << std::endl;
+    {
+        Image img(200, 130); // partial tiles on both edges: 4 x 3
+        stream::TileChangeDetector detector;
+        FrameData f = img.frame();
+        expect(detector.process(f) == 12 && f.tileColumns == 4 && f.tileRows == 3, "first frame dirty everywhere");
+        for (int i = 0; i < 8; ++i) {
+            f = img.frame();
+            expect(detector.process(f) == 0 && f.dirtyTileCount == 0, "unchanged frame is clean");
+        }
+    }
+
+    std::cout << "[TEST] Every row checked with rowStride 1" << std::endl;
+    {
+        Image img(200, 130);
+        stream::TileChangeDetector detector({1});
+        FrameData f = img.frame();
+        detector.process(f);
+        img.poke(199, 129); // last pixel, in the partial corner tile
+        f = img.frame();
+        expect(detector.process(f) == 1 && tileDirty(f, 3, 2), "single pixel in the corner tile");
+        img.poke(64, 63);
+        img.poke(0, 64);
+        f = img.frame();
+        expect(detector.process(f) == 2 && tileDirty(f, 1, 0) && tileDirty(f, 0, 1), "changes on tile edges");
+        f = img.frame();
+        expect(detector.process(f) == 0, "clean again");
+    }
+
+    std::cout << "[TEST] Sampled rows" << std::endl;
+    {
+        Image img(256, 128);
+        stream::TileChangeDetector detector({4});
+        FrameData f = img.frame();
+        detector.process(f);
+        // A change as tall as the stride always covers a sampled row.
+        for (int y = 10; y < 14; ++y) img.poke(70, y);
+        f = img.frame();
+        expect(detector.process(f) == 1 && tileDirty(f, 1, 0), "4-row change caught at once");
+
+        // A one-row change is caught within rowStride frames, exactly once.
+        img.poke(200, 100);
+        int seen = 0, within = 0;
+        for (int i = 0; i < 8; ++i) {
+            f = img.frame();
+            if (detector.process(f)) {
+                ++seen;
+                within = i;
+                expect(tileDirty(f, 3, 1), "right tile");
+            }
+        }
+        expect(seen == 1 && within < 4, "one-row change reported once within the stride");
+    }
+
+    std::cout << "[TEST] Geometry changes" << std::endl;
+    {
+        Image img(128, 128);
+        stream::TileChangeDetector detector;
+        FrameData f = img.frame(1);
+        detector.process(f);
+        f = img.frame(2);
+        expect(detector.process(f) == 4, "new generation is dirty everywhere");
+        Image bigger(192, 128);
+        f = bigger.frame(2);
+        expect(detector.process(f) == 6 && f.tileColumns == 3, "new size is dirty everywhere");
+        detector.reset();
+        f = bigger.frame(2);
+        expect(detector.process(f) == 6, "reset forces a full frame");
+    }
+
+    std::cout << "[TEST] Hash sees every byte" << std::endl;
+    {
+        std::vector<uint8_t> row(252, 7); // three blocks and a 15-pixel tail
+        uint64_t base = stream::TileChangeDetector::hashSpan(row.data(), row.size());
+        bool all = true;
+        for (size_t i = 0; i < row.size(); ++i) {
+            row[i] ^= 0x80;
+            all = all && stream::TileChangeDetector::hashSpan(row.data(), row.size()) != base;
+            row[i] ^= 0x80;
+        }
+        expect(all, "single bit flips change the hash");
+    }
+
+    std::cout << "[TEST] Hash implementations agree" << std::endl;
+    {
+        using Impl = stream::TileChangeDetector::HashImpl;
+        std::mt19937_64 rng(47);
+        std::vector<uint8_t> pixels(4 * 1000 + 4);
+        std::vector<uint64_t> want(16), got(16), picked(16);
+        int compared = 0;
+        bool same = true;
+        for (int round = 0; round < 400; ++round) {
+            for (auto& b : pixels) b = uint8_t(rng());
+            // Any width up to 1000 pixels, so every tail length and partial
+            // block is covered, at an unaligned start half the time.
+            size_t bytes = size_t(rng() % 1000 + 1) * 4;
+            const uint8_t* row = pixels.data() + (round & 1) * 4;
+            size_t tiles = (bytes + 255) / 256;
+            expect(stream::TileChangeDetector::hashRowWith(Impl::Scalar, row, bytes, want.data()), "scalar always built");
+            stream::TileChangeDetector::hashRow(row, bytes, picked.data());
+            same = same && std::equal(want.begin(), want.begin() + tiles, picked.begin());
+            for (Impl impl : {Impl::Sse2, Impl::Avx2}) {
+                if (!stream::TileChangeDetector::hashRowWith(impl, row, bytes, got.data())) continue;
+                ++compared;
+                same = same && std::equal(want.begin(), want.begin() + tiles, got.begin());
+            }
+        }
+        std::cout << "[TEST] " << compared << " SIMD rows compared with scalar" << std::endl;
+        expect(same, "SIMD and selected hashes match scalar");
+    }
+
+    return report("ChangeDetector test");
+}
@@ -0,0 +1,150 @@
+#include "../include/Config.h"
+#include "TestUtil.h"
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+static void writeFile(const std::string& path, const std::string& text) {
+    // Write-then-rename, the way most editors save.
+    std::string tmp = path + ".tmp";
+    std::ofstream(tmp) << text;
+    std::filesystem::rename(tmp, path);
+}
+
+int main() {
+    std::cout << "[TEST] Config parsing" << std::endl;
+    {
+        stream::StreamConfig c;
+        std::vector<std::string> errors;
+        auto j = nlohmann::json::parse(R"({
+            "signaling_url": "wss://example.org/signal",
+            "log_level": "debug",
+            "capture": {"framerate": 30, "resolution": "1280x720",
+                        "region": {"x": 10, "y": 20, "width": 640, "height": 480},
+                        "backend": "pipewire", "pipewire_node": 42},
+            "encode": {"bitrate": 4000000, "hardware": false, "vfr": false},
+            "threads": {"capture": {"cpus": "2-3,6", "scheduler": "fifo", "priority": 20},
+                        "audio": {"scheduler": "other"}}
+        })");
+        expect(stream::parseConfig(j, c, errors), "valid config accepted");
+        expect(c.signalingUrl == "wss://example.org/signal", "signaling url");
+        expect(c.capture.framerate == 30 && c.capture.width == 1280 && c.capture.height == 720, "capture");
+        expect(c.capture.region.x == 10 && c.capture.region.height == 480, "region");
+        expect(c.capture.backend.backend == "pipewire" && c.capture.backend.pipewireNode == 42, "capture backend");
+        expect(c.encode.bitrate == 4000000 && !c.encode.hardware && !c.encode.vfr, "encode");
+        expect(c.threads.capture.cpus == std::vector<int>{2, 3, 6} && c.threads.capture.scheduler == "fifo" &&
+               c.threads.capture.priority == 20, "capture thread policy");
+        expect(c.threads.audio.scheduler == "other" && c.threads.network.cpus.empty(), "other thread policies");
+        expect(c.stunServer == stream::StreamConfig{}.stunServer, "missing key keeps default");
+    }
+    {
+        stream::StreamConfig c;
+        c.capture.framerate = 42;
+        std::vector<std::string> errors;
+        auto j = nlohmann::json::parse(R"({
+            "signaling_url": "http://nope",
+            "log_level": "loud",
+            "capture": {"framerate": 0, "resolution": "big", "backend": "wayland"},
+            "encode": {"bitrate": "fast"}
+        })");
+        expect(!stream::parseConfig(j, c, errors), "invalid config rejected");
+        expect(errors.size() == 6, "every problem reported");
+        expect(c.capture.framerate == 42, "output untouched on failure");
+    }
+    {
+        stream::StreamConfig c;
+        std::vector<std::string> errors;
+        auto j = nlohmann::json::parse(R"({"capture": {"monitor": "primary"}})");
+        expect(stream::parseConfig(j, c, errors), "monitor target accepted");
+        CaptureTarget t = c.capture.target();
+        expect(t.kind == CaptureTarget::Kind::Monitor && t.monitor.empty(), "primary monitor target");
+        j = nlohmann::json::parse(R"({"capture": {"window": 4194311}})");
+        expect(stream::parseConfig(j, c, errors), "window target accepted");
+        t = c.capture.target();
+        expect(t.kind == CaptureTarget::Kind::Window && t.window == 4194311, "window target");
+        j = nlohmann::json::parse(R"({"capture": {"window": 42, "region": {"width": 640, "height": 480}}})");
+        expect(!stream::parseConfig(j, c, errors), "conflicting targets rejected");
+        expect(stream::StreamConfig{}.capture.target().kind == CaptureTarget::Kind::Screen, "full screen by default");
+    }
+    {
+        stream::StreamConfig c;
+        std::vector<std::string> errors;
+        auto j = nlohmann::json::parse(R"({"threads": {"capture": {"cpus": "2-x"},
+                                                       "audio": {"scheduler": "rr", "priority": 0}}})");
+        expect(!stream::parseConfig(j, c, errors) && errors.size() == 2, "bad CPU list and missing priority");
+        std::vector<int> cpus;
+        expect(stream::parseCpuList("", cpus) && cpus.empty(), "empty CPU list");
+        expect(stream::parseCpuList("3,0-1,1", cpus) && cpus == std::vector<int>{0, 1, 3}, "CPU list sorted");
+        expect(!stream::parseCpuList("3-1", cpus) && !stream::parseCpuList("1,,2", cpus), "bad CPU lists");
+    }
+
+    std::cout << "[TEST] Config diff" << std::endl;
+    {
+        stream::StreamConfig a, b;
+        b.encode.bitrate = a.encode.bitrate / 2;
+        b.capture.region = {0, 0, 800, 600};
+        b.capture.width = 1280;
+        stream::ConfigDiff d = stream::diffConfig(a, b);
+        expect(d.bitrate && d.target && !d.framerate, "live changes detected");
+        b.capture.region = {};
+        b.capture.monitor = "DP-1";
+        expect(stream::diffConfig(a, b).target, "monitor change is live");
+        b.threads.capture.cpus = {1};
+        expect(stream::diffConfig(a, b).threads, "thread policy change is live");
+        b.encode.vfr = false;
+        expect(stream::diffConfig(a, b).vfr && stream::diffConfig(a, b).restartRequired.size() == 1,
+               "vfr toggle is live");
+        expect(d.restartRequired.size() == 1 && d.restartRequired[0] == "capture.resolution",
+               "resolution needs a restart");
+    }
+
+#ifdef __linux__
+    std::cout << "[TEST] Config reload" << std::endl;
+    {
+        auto dir = std::filesystem::temp_directory_path() / ("stream-config-" + std::to_string(getpid()));
+        std::filesystem::create_directories(dir);
+        std::string path = (dir / "config.json").string();
+        writeFile(path, R"({"encode": {"bitrate": 8000000}})");
+
+        std::atomic<int> reloads{0};
+        std::atomic<int> bitrate{0};
+        stream::StreamConfig initial;
+        std::vector<std::string> errors;
+        expect(stream::loadConfig(path, initial, errors), "initial load");
+        stream::ConfigWatcher watcher(path, initial, [&](const stream::StreamConfig&, const stream::StreamConfig& cur) {
+            bitrate = cur.encode.bitrate;
+            ++reloads;
+        });
+        expect(watcher.start(), "watcher started");
+
+        auto waitFor = [&](int n) {
+            for (int i = 0; i < 200 && reloads < n; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        };
+        auto t0 = std::chrono::steady_clock::now();
+        writeFile(path, R"({"encode": {"bitrate": 2000000}})");
+        waitFor(1);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+        expect(reloads == 1 && bitrate == 2000000, "edit applied");
+        std::cout << "[TEST] reload took " << ms << " ms" << std::endl;
+
+        writeFile(path, R"({"encode": {"bitrate": -1}})");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        expect(reloads == 1 && watcher.current().encode.bitrate == 2000000, "invalid edit ignored");
+
+        std::ofstream(dir / "other.json") << "{}";
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        expect(reloads == 1, "unrelated file ignored");
+
+        watcher.stop();
+        std::filesystem::remove_all(dir);
+    }
+#endif
+
+    return report("Config test");
+}
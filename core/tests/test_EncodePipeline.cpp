@@ -0,0 +1,129 @@
+#include "../include/EncodePipeline.h"
+#include "TestUtil.h"
+#include <iostream>
+#include <thread>
+
+// Records what the pipeline asks of the encoder, and from which thread.
+class FakeEncoder : public Encoder {
+public:
+    bool Start(int w, int h, int f, EncodedCallback cb) override {
+        ++starts;
+        width = w;
+        height = h;
+        fps = f;
+        callback = cb;
+        return true;
+    }
+    void EncodeFrame(const uint8_t*, int) override {
+        ++encoded;
+        callback({{0, 0, 0, 1}, encoded == 1, 0});
+    }
+    void Stop() override { ++stops; }
+    bool SetBitrate(int b) override {
+        bitrate = b;
+        rateThread = std::this_thread::get_id();
+        return true;
+    }
+    bool SetFramerate(int f) override {
+        fps = f;
+        rateThread = std::this_thread::get_id();
+        return true;
+    }
+    bool Reconfigure(int w, int h) override {
+        if (w > maxWidth || h > maxHeight) return false;
+        width = w;
+        height = h;
+        return true;
+    }
+
+    int starts = 0, stops = 0, encoded = 0;
+    int width = 0, height = 0, fps = 0, bitrate = 0;
+    int maxWidth = 1920, maxHeight = 1080;
+    std::thread::id rateThread;
+    EncodedCallback callback;
+};
+
+static const uint64_t kBitmap = 0;
+
+static FrameData frame(int width, int height, uint32_t generation, size_t dirty, uint64_t micros) {
+    FrameData f{};
+    f.width = width;
+    f.height = height;
+    f.generation = generation;
+    f.timestamp = micros;
+    f.dirtyTiles = &kBitmap;
+    f.tileColumns = 1;
+    f.tileRows = 1;
+    f.dirtyTileCount = dirty;
+    return f;
+}
+
+int main() {
+    std::cout << "[TEST] Resize in place, restart above the encoder's size" << std::endl;
+    {
+        FakeEncoder encoder;
+        stream::EncodePipeline pipeline;
+        int delivered = 0;
+        stream::EncodePipeline::Settings settings;
+        settings.width = 1280;
+        settings.height = 720;
+        settings.framerate = 60;
+        settings.bitrate = 4000000;
+        expect(pipeline.start(encoder, settings, [&](const EncodedFrame&) { ++delivered; }), "started");
+        expect(encoder.width == 1280 && encoder.bitrate == 4000000, "started at configured size and rate");
+
+        pipeline.onFrame(frame(1280, 720, 1, 1, 0));
+        pipeline.onFrame(frame(1920, 1080, 2, 1, 16667));
+        expect(encoder.starts == 1 && encoder.width == 1920 && pipeline.width() == 1920, "reconfigured in place");
+
+        // Rates changed by a reload are what a restart uses.
+        pipeline.setBitrate(2000000);
+        pipeline.setFramerate(30);
+        encoder.maxWidth = 1920;
+        pipeline.onFrame(frame(2560, 1440, 3, 0, 33333));
+        expect(encoder.stops == 1 && encoder.starts == 2, "restarted when too large");
+        expect(encoder.width == 2560 && encoder.fps == 30 && encoder.bitrate == 2000000, "restart at current rates");
+        expect(encoder.encoded == 3, "frame after a restart encoded even without damage");
+        expect(delivered == 3, "callback survives the restart");
+    }
+
+    std::cout << "[TEST] Rate changes are applied on the capture thread" << std::endl;
+    {
+        FakeEncoder encoder;
+        stream::EncodePipeline pipeline;
+        stream::EncodePipeline::Settings settings;
+        settings.width = 640;
+        settings.height = 480;
+        settings.bitrate = 1000000;
+        pipeline.start(encoder, settings, [](const EncodedFrame&) {});
+        std::thread reload([&] {
+            pipeline.setBitrate(3000000);
+            pipeline.setFramerate(15);
+        });
+        reload.join();
+        expect(encoder.bitrate == 1000000 && encoder.fps == 30, "nothing applied off the capture thread");
+        std::thread capture([&] { pipeline.onFrame(frame(640, 480, 1, 1, 0)); });
+        std::thread::id captureId = capture.get_id();
+        capture.join();
+        expect(encoder.bitrate == 3000000 && encoder.fps == 15, "applied before the next frame");
+        expect(encoder.rateThread == captureId, "by the capture thread");
+    }
+
+    std::cout << "[TEST] Static frames are dropped" << std::endl;
+    {
+        FakeEncoder encoder;
+        stream::EncodePipeline pipeline;
+        stream::EncodePipeline::Settings settings;
+        settings.width = 640;
+        settings.height = 480;
+        pipeline.start(encoder, settings, [](const EncodedFrame&) {});
+        pipeline.onFrame(frame(640, 480, 1, 1, 0));
+        pipeline.onFrame(frame(640, 480, 1, 0, 16667));
+        expect(encoder.encoded == 1, "unchanged frame not encoded");
+        pipeline.setVfr(false);
+        pipeline.onFrame(frame(640, 480, 1, 0, 33333));
+        expect(encoder.encoded == 2, "every frame encoded without vfr");
+    }
+
+    return report("Encode pipeline test");
+}
@@ -0,0 +1,119 @@
+#include "../include/EventLoop.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+static double msSince(Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+}
+
+int main() {
+    std::cout << "[TEST] Posted tasks run at once, in order" << std::endl;
+    {
+        stream::EventLoop loop;
+        std::vector<int> order;
+        loop.post([&] { order.push_back(1); }); // before run()
+        std::thread runner([&] { loop.run(); });
+        std::this_thread::sleep_for(milliseconds(20)); // loop is idle now
+        auto posted = Clock::now();
+        double latency = -1;
+        loop.post([&] { order.push_back(2); });
+        loop.post([&] {
+            latency = msSince(posted);
+            order.push_back(3);
+            loop.stop();
+        });
+        runner.join();
+        expect(order == std::vector<int>({1, 2, 3}), "order kept");
+        // Generous for a loaded machine; the loop itself has no timeout.
+        expect(latency >= 0 && latency < 100, "idle loop wakes immediately");
+        std::cout << "[TEST] post-to-run latency " << latency << " ms" << std::endl;
+    }
+
+    std::cout << "[TEST] Timers" << std::endl;
+    {
+        stream::EventLoop loop;
+        auto start = Clock::now();
+        double oneShot = -1;
+        int repeats = 0, oneShotRuns = 0;
+        // Stops once both timers are done, however late a busy machine
+        // lets them run.
+        auto stopWhenDone = [&] {
+            if (oneShotRuns > 0 && repeats >= 4) loop.stop();
+        };
+        stream::EventLoop::TimerId cancelled = loop.addTimer(milliseconds(10), [&] { expect(false, "cancelled timer ran"); });
+        loop.cancelTimer(cancelled);
+        loop.addTimer(milliseconds(30), [&] {
+            oneShot = msSince(start);
+            ++oneShotRuns;
+            stopWhenDone();
+        });
+        stream::EventLoop::TimerId tick = 0;
+        tick = loop.addTimer(milliseconds(5), [&] {
+            if (++repeats == 4) loop.cancelTimer(tick);
+            stopWhenDone();
+        }, milliseconds(5));
+        stream::EventLoop::TimerId timeout = loop.addTimer(std::chrono::seconds(5), [&] {
+            expect(false, "timers ran within 5 s");
+            loop.stop();
+        });
+        loop.run();
+        loop.cancelTimer(timeout);
+        expect(oneShot >= 30, "one-shot timer never early");
+        expect(oneShotRuns == 1, "one-shot timer runs once");
+        expect(repeats == 4, "repeating timer until cancelled");
+    }
+
+#ifdef __linux__
+    std::cout << "[TEST] Watched descriptors" << std::endl;
+    {
+        stream::EventLoop loop;
+        int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        int seen = 0;
+        expect(loop.watch(fd, [&] {
+            uint64_t v;
+            (void)!read(fd, &v, sizeof(v));
+            if (++seen == 2) {
+                loop.unwatch(fd);
+                loop.stop();
+            }
+        }), "watch eventfd");
+        std::thread writer([&] {
+            for (int i = 0; i < 2; ++i) {
+                std::this_thread::sleep_for(milliseconds(10));
+                uint64_t one = 1;
+                (void)!write(fd, &one, sizeof(one));
+            }
+        });
+        loop.run();
+        writer.join();
+        close(fd);
+        expect(seen == 2, "each write dispatched");
+    }
+#endif
+
+    std::cout << "[TEST] Restart after stop" << std::endl;
+    {
+        stream::EventLoop loop;
+        loop.stop();
+        loop.run(); // returns at once
+        bool ran = false;
+        loop.post([&] {
+            ran = true;
+            loop.stop();
+        });
+        loop.run();
+        expect(ran, "second run dispatches");
+    }
+
+    return report("EventLoop test");
+}
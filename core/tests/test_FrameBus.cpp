@@ -0,0 +1,94 @@
+#include "../include/FrameBus.h"
+#include "TestUtil.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Child process: reads frames until it has seen `count` intact ones and
+// exits non-zero if any intact frame has the wrong contents.
+static int consume(const std::string& path, int count) {
+    auto reader = stream::FrameBusReader::connect(path);
+    if (!reader) return 2;
+    int seen = 0;
+    uint64_t last = 0;
+    while (seen < count) {
+        if (!reader->wait(2000)) return 3;
+        stream::FrameBusReader::View view;
+        if (!reader->acquireLatest(view) || view.info.index == last) continue;
+        // Every byte of frame N is (N & 0xff).
+        uint8_t expected = uint8_t(view.info.index);
+        bool ok = view.data[0] == expected && view.data[view.info.size - 1] == expected;
+        if (!reader->stillValid(view)) continue;
+        if (!ok) return 4;
+        last = view.info.index;
+        ++seen;
+    }
+    return 0;
+}
+
+int main() {
+    const std::string path = "/tmp/stream-framebus-test-" + std::to_string(getpid()) + ".sock";
+    const uint32_t frameBytes = 1280 * 720 * 4;
+    auto bus = stream::FrameBusWriter::create(path, 4, frameBytes);
+    expect(bus != nullptr, "writer created");
+    if (!bus) return 1;
+
+    std::cout << "[TEST] Frame bus cross-process delivery" << std::endl;
+    const int consumers = 2;
+    std::vector<pid_t> children;
+    for (int i = 0; i < consumers; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bus.release(); // the parent owns the writer
+            _exit(consume(path, 30));
+        }
+        children.push_back(pid);
+    }
+    for (int i = 0; i < 200 && bus->consumers() < size_t(consumers); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    expect(bus->consumers() == size_t(consumers), "both consumers attached");
+
+    // Publish until the children are done, zero-copy into the slot.
+    auto t0 = std::chrono::steady_clock::now();
+    int published = 0;
+    for (int remaining = consumers; remaining > 0;) {
+        stream::FrameBusInfo info{};
+        info.width = 1280;
+        info.height = 720;
+        info.stride = 1280 * 4;
+        info.size = frameBytes;
+        info.format = stream::FramePixelFormat::BGRA;
+        memset(bus->beginFrame(), uint8_t(published + 1), frameBytes);
+        bus->commitFrame(info);
+        ++published;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        int status;
+        while (waitpid(-1, &status, WNOHANG) > 0) {
+            expect(WIFEXITED(status) && WEXITSTATUS(status) == 0, "consumer saw intact frames");
+            --remaining;
+        }
+        if (std::chrono::steady_clock::now() - t0 > std::chrono::seconds(10)) {
+            expect(false, "consumers finished in time");
+            for (pid_t pid : children) kill(pid, SIGKILL);
+            break;
+        }
+    }
+    std::cout << "[TEST] Published " << published << " frames of " << frameBytes << " bytes" << std::endl;
+
+    std::cout << "[TEST] Frame bus drops oversized frames" << std::endl;
+    std::vector<uint8_t> big(bus->slotBytes() + 1);
+    stream::FrameBusInfo info{};
+    info.size = uint32_t(big.size());
+    expect(!bus->publish(big.data(), info) && bus->dropped() == 1, "oversized frame dropped");
+
+    for (int i = 0; i < 200 && bus->consumers() > 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    expect(bus->consumers() == 0, "disconnected consumers removed");
+
+    return report("Frame bus test");
+}
@@ -0,0 +1,94 @@
+#include "../include/FramePacer.h"
+#include "TestUtil.h"
+#include <iostream>
+
+using Decision = stream::FramePacer::Decision;
+
+// One word of bitmap is enough: the pacer only looks at the count.
+static const uint64_t kBitmap = 0;
+
+static FrameData frameAt(uint64_t micros, size_t dirty) {
+    FrameData f{};
+    f.timestamp = micros;
+    f.dirtyTiles = &kBitmap;
+    f.tileColumns = 1;
+    f.tileRows = 1;
+    f.dirtyTileCount = dirty;
+    return f;
+}
+
+int main() {
+    const uint64_t frame = 16667; // 60 fps
+
+    std::cout << "[TEST] Static frames are dropped, refined, then refreshed" << std::endl;
+    {
+        stream::FramePacer pacer; // 2 refines 100ms apart, refresh every 1s
+        expect(pacer.decide(frameAt(0, 1)) == Decision::Encode, "change is encoded");
+        expect(pacer.decide(frameAt(frame, 1)) == Decision::Encode, "motion is encoded");
+        int refines = 0, refreshes = 0, drops = 0;
+        uint64_t firstRefresh = 0;
+        for (uint64_t t = 2 * frame; t < 3000000; t += frame) {
+            Decision d = pacer.decide(frameAt(t, 0));
+            if (d == Decision::Refine) {
+                ++refines;
+                expect(refreshes == 0, "refines come first");
+            } else if (d == Decision::Refresh) {
+                if (!refreshes++) firstRefresh = t;
+            } else {
+                ++drops;
+            }
+        }
+        expect(refines == 2, "two refine frames");
+        expect(refreshes == 2 || refreshes == 3, "refresh about once a second");
+        expect(firstRefresh >= 1200000 + frame && firstRefresh < 1200000 + 2 * frame, "refresh a second after the last refine");
+        expect(pacer.stats().dropped == uint64_t(drops) && drops > 170, "the rest is dropped");
+    }
+
+    std::cout << "[TEST] First change goes straight through" << std::endl;
+    {
+        stream::FramePacer pacer;
+        pacer.decide(frameAt(0, 4));
+        for (uint64_t t = frame; t < 500000; t += frame) pacer.decide(frameAt(t, 0));
+        expect(pacer.decide(frameAt(500000, 1)) == Decision::Encode, "damage after a static stretch");
+        expect(pacer.decide(frameAt(500000 + frame, 1)) == Decision::Encode, "full rate while changing");
+        // Motion stopped again, so refining starts over.
+        bool refined = false;
+        for (uint64_t t = 500000 + 2 * frame; t < 800000; t += frame)
+            refined = refined || pacer.decide(frameAt(t, 0)) == Decision::Refine;
+        expect(refined, "refine after every burst");
+    }
+
+    std::cout << "[TEST] Single-frame changes are not refined" << std::endl;
+    {
+        stream::FramePacer pacer;
+        pacer.decide(frameAt(0, 1));
+        int sentFrames = 0;
+        for (uint64_t t = frame; t < 2000000; t += frame) {
+            bool blink = t % 500000 < frame; // cursor blink
+            Decision d = pacer.decide(frameAt(t, blink ? 1 : 0));
+            expect(d != Decision::Refine, "no refine after a blink");
+            if (d != Decision::Drop) ++sentFrames;
+        }
+        expect(sentFrames == 3, "only the blinks are sent");
+    }
+
+    std::cout << "[TEST] Unknown damage, forced frames and disabled pacing" << std::endl;
+    {
+        stream::FramePacer pacer;
+        pacer.decide(frameAt(0, 1));
+        FrameData unknown = frameAt(frame, 0);
+        unknown.dirtyTiles = nullptr;
+        expect(pacer.decide(unknown) == Decision::Encode, "no bitmap means changed");
+        expect(pacer.decide(frameAt(2 * frame, 0)) == Decision::Drop, "static dropped");
+        pacer.forceNext();
+        expect(pacer.decide(frameAt(3 * frame, 0)) == Decision::Encode, "forced frame encoded");
+        expect(pacer.decide(frameAt(4 * frame, 0)) == Decision::Drop, "force is one-shot");
+        pacer.setEnabled(false);
+        expect(pacer.decide(frameAt(5 * frame, 0)) == Decision::Encode, "disabled encodes everything");
+
+        stream::FramePacer fresh;
+        expect(fresh.decide(frameAt(0, 0)) == Decision::Encode, "very first frame always encoded");
+    }
+
+    return report("FramePacer test");
+}
@@ -0,0 +1,161 @@
+#include "../include/InputChannel.h"
+#include "../include/InputProtocol.h"
+#include "TestUtil.h"
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct RecordedCall {
+    bool mouse;
+    int x, y, code;
+    bool down;
+};
+
+class FakeInjector : public stream::InputInjector {
+public:
+    void injectMouse(int x, int y, int button, bool down) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        calls.push_back({true, x, y, button, down});
+    }
+    void injectKeyboard(int key, bool down) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        calls.push_back({false, 0, 0, key, down});
+    }
+    std::mutex mutex;
+    std::vector<RecordedCall> calls;
+};
+
+static stream::InputEvent move(int x, int y) {
+    stream::InputEvent ev{};
+    ev.type = stream::InputEvent::Type::MouseMove;
+    ev.x = x;
+    ev.y = y;
+    return ev;
+}
+
+static stream::InputEvent button(int code, bool down) {
+    stream::InputEvent ev{};
+    ev.type = stream::InputEvent::Type::MouseButton;
+    ev.code = code;
+    ev.down = down;
+    return ev;
+}
+
+static void waitForInjected(stream::InputChannel& channel, uint64_t n) {
+    for (int i = 0; i < 200 && channel.stats().injected < n; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+int main() {
+    std::cout << "[TEST] Running input channel test..." << std::endl;
+
+    // Round trip through the wire format.
+    std::vector<stream::InputEvent> events = {move(10, 20), button(1, true)};
+    stream::InputEvent key{};
+    key.type = stream::InputEvent::Type::Key;
+    key.code = 38;
+    key.down = true;
+    events.push_back(key);
+    std::vector<uint8_t> bytes;
+    stream::encodeInputBatch(100, events, bytes);
+    expect(bytes.size() == stream::kInputHeaderSize + 5 + 3 + 4, "encoded size");
+    std::vector<stream::InputEvent> decoded;
+    expect(stream::decodeInputBatch(bytes.data(), bytes.size(), decoded), "decode");
+    expect(decoded.size() == 3 && decoded[0].x == 10 && decoded[0].y == 20 && decoded[0].seq == 100, "decoded move");
+    expect(decoded.size() == 3 && decoded[1].code == 1 && decoded[1].down && decoded[1].seq == 101, "decoded button");
+    expect(decoded.size() == 3 && decoded[2].code == 38 && decoded[2].seq == 102, "decoded key");
+    expect(!stream::decodeInputBatch(bytes.data(), bytes.size() - 1, decoded) && decoded.size() == 3, "truncated message rejected");
+
+    // Larger batches are split by the caller, not truncated silently.
+    std::vector<stream::InputEvent> many(300, move(1, 1));
+    size_t first = stream::encodeInputBatch(0, many, bytes);
+    size_t rest = stream::encodeInputBatch(uint32_t(first), std::span(many).subspan(first), bytes);
+    expect(first == stream::kMaxInputBatch && rest == 45, "oversized batch reports what was encoded");
+    decoded.clear();
+    expect(stream::decodeInputBatch(bytes.data(), bytes.size(), decoded) && decoded.size() == 45 &&
+               decoded[0].seq == 255,
+           "remainder continues the sequence");
+
+    FakeInjector injector;
+    stream::InputChannel channel(injector);
+    channel.start();
+
+    // A run of moves collapses to its last position; the click keeps its place.
+    std::vector<stream::InputEvent> drag;
+    for (int i = 0; i < 50; ++i) drag.push_back(move(i, i));
+    drag.push_back(button(1, true));
+    drag.push_back(move(200, 100));
+    drag.push_back(button(1, false));
+    stream::encodeInputBatch(1, drag, bytes);
+    channel.onMessage(bytes.data(), bytes.size());
+    waitForInjected(channel, 4);
+    {
+        std::lock_guard<std::mutex> lock(injector.mutex);
+        expect(injector.calls.size() == 4, "coalesced to four calls");
+        if (injector.calls.size() == 4) {
+            expect(injector.calls[0].x == 49 && injector.calls[0].code == 0, "last move kept");
+            expect(injector.calls[1].code == 1 && injector.calls[1].down && injector.calls[1].x == 49, "button down at pointer");
+            expect(injector.calls[2].x == 200 && injector.calls[2].y == 100, "move after button");
+            expect(injector.calls[3].code == 1 && !injector.calls[3].down, "button up");
+        }
+    }
+
+    // A redundant resend of the button release is dropped, and a reordered
+    // move older than the last applied one is ignored.
+    std::vector<stream::InputEvent> resend = {button(1, false)};
+    stream::encodeInputBatch(53, resend, bytes);
+    channel.onMessage(bytes.data(), bytes.size());
+    std::vector<stream::InputEvent> stale = {move(5, 5)};
+    stream::encodeInputBatch(0, stale, bytes);
+    channel.onMessage(bytes.data(), bytes.size());
+    std::vector<stream::InputEvent> fresh = {move(300, 300)};
+    stream::encodeInputBatch(54, fresh, bytes);
+    channel.onMessage(bytes.data(), bytes.size());
+    waitForInjected(channel, 5);
+
+    // A key release that overtook its press: the late press is dropped.
+    key.down = false;
+    std::vector<stream::InputEvent> release = {key};
+    stream::encodeInputBatch(61, release, bytes);
+    channel.onMessage(bytes.data(), bytes.size());
+    key.down = true;
+    std::vector<stream::InputEvent> latePress = {key};
+    stream::encodeInputBatch(60, latePress, bytes);
+    channel.onMessage(bytes.data(), bytes.size());
+    waitForInjected(channel, 6);
+    channel.stop();
+
+    auto stats = channel.stats();
+    expect(stats.injected == 6, "only the fresh move and the release injected");
+    expect(stats.staleKeys == 1, "late press dropped");
+    {
+        std::lock_guard<std::mutex> lock(injector.mutex);
+        expect(!injector.calls.empty() && !injector.calls.back().mouse && !injector.calls.back().down,
+               "key left released");
+    }
+    expect(stats.duplicates >= 1, "duplicate counted");
+    expect(stats.staleMoves == 1, "stale move counted");
+
+    // A viewer that reconnects starts its sequence over at 0; after reset()
+    // its events are neither duplicates nor stale.
+    channel.start();
+    channel.reset();
+    std::vector<stream::InputEvent> reconnect = {move(7, 7), button(1, true), button(1, false)};
+    key.down = false;
+    reconnect.push_back(key);
+    stream::encodeInputBatch(0, reconnect, bytes);
+    channel.onMessage(bytes.data(), bytes.size());
+    waitForInjected(channel, 10);
+    channel.stop();
+    auto after = channel.stats();
+    expect(after.injected == 10, "reconnected viewer's input injected");
+    expect(after.duplicates == stats.duplicates && after.staleMoves == stats.staleMoves &&
+               after.staleKeys == stats.staleKeys,
+           "restarted sequence not taken as replayed or stale");
+
+    std::cout << "[TEST] Input latency mean " << stats.meanLatencyMicros << "us, max "
+              << stats.maxLatencyMicros << "us over " << stats.messages << " messages" << std::endl;
+
+    return report("Input channel test");
+}
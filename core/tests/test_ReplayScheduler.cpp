@@ -0,0 +1,152 @@
+#include "../include/ReplayScheduler.h"
+#include "../include/Encoder.h"
+#include "TestUtil.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static void busy(std::chrono::microseconds d) {
+    auto until = Clock::now() + d;
+    while (Clock::now() < until) {}
+}
+
+int main() {
+    // Wall-clock checks bound from below, where deadlines are exact, or
+    // leave room for a loaded machine, which preempts the consumer.
+    std::cout << "[TEST] Callback time does not accumulate" << std::endl;
+    {
+        // 100 items 5 ms apart, each taking 3 ms to consume. Sleeping a
+        // fixed 5 ms after every callback would add 0.495 s to whatever the
+        // consumer took; absolute deadlines overlap the two instead.
+        stream::ReplayScheduler scheduler;
+        auto t0 = Clock::now();
+        bool early = false;
+        double lastRelease = 0, consumer = 0;
+        for (uint64_t i = 0; i < 100; ++i) {
+            expect(scheduler.wait(i * 5000), "on-time items delivered");
+            lastRelease = secondsSince(t0);
+            early |= lastRelease < i * 0.005;
+            auto c0 = Clock::now();
+            busy(std::chrono::microseconds(3000));
+            if (i < 99) consumer += secondsSince(c0);
+        }
+        std::cout << "[TEST] last of a 0.495 s schedule released at " << lastRelease << " s, consumer took "
+                  << consumer << " s" << std::endl;
+        expect(!early, "no item released before its deadline");
+        expect(lastRelease < consumer + 0.45, "schedule kept");
+        expect(scheduler.stats().delivered == 100 && scheduler.stats().dropped == 0, "all delivered");
+    }
+
+    std::cout << "[TEST] Speed control" << std::endl;
+    {
+        stream::ReplayScheduler::Options options;
+        options.speed = 4.0;
+        stream::ReplayScheduler scheduler(options);
+        auto t0 = Clock::now();
+        // Starts at a non-zero media offset, as after a seek.
+        for (uint64_t i = 0; i <= 40; ++i) scheduler.wait(10000000 + i * 10000);
+        double secs = secondsSince(t0);
+        expect(secs >= 0.1 && secs < 0.3, "0.4 s of media in 0.1 s at 4x");
+
+        options.speed = 100.0;
+        expect(stream::ReplayScheduler(options).speed() == stream::ReplayScheduler::kMaxSpeed, "speed clamped high");
+        options.speed = 0.1;
+        expect(stream::ReplayScheduler(options).speed() == stream::ReplayScheduler::kMinSpeed, "speed clamped low");
+
+        options.speed = 0.0;
+        stream::ReplayScheduler fast(options);
+        t0 = Clock::now();
+        for (uint64_t i = 0; i < 1000; ++i) fast.wait(i * 1000000);
+        // Throttled, this would take 1000 s.
+        expect(fast.unthrottled() && secondsSince(t0) < 1.0, "unthrottled never sleeps");
+        expect(fast.stats().late == 0 && fast.stats().delivered == 1000, "unthrottled items are never late");
+    }
+
+    std::cout << "[TEST] Late policies" << std::endl;
+    {
+        stream::ReplayScheduler catchUp;
+        catchUp.wait(0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        for (uint64_t i = 1; i <= 5; ++i) expect(catchUp.wait(i * 10000), "catch-up delivers everything");
+        // Released late rather than rescheduled, so nothing was waited for.
+        expect(catchUp.stats().late == 5 && catchUp.stats().maxLateMicros >= 50000, "overdue items released at once");
+
+        stream::ReplayScheduler::Options options;
+        options.late = stream::ReplayScheduler::LatePolicy::Drop;
+        options.lateTolerance = std::chrono::milliseconds(20);
+        stream::ReplayScheduler drop(options);
+        drop.wait(0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        int delivered = 0;
+        for (uint64_t i = 1; i <= 30; ++i) delivered += drop.wait(i * 10000) ? 1 : 0;
+        // Items due at 10..70 ms are too late however long the sleep took;
+        // the ones due well after it are delivered on time.
+        expect(drop.stats().dropped >= 7 && delivered >= 1, "stale items dropped");
+        expect(drop.stats().dropped == uint64_t(30 - delivered), "drops counted");
+        expect(!drop.wait(10000, true) && drop.wait(10000, false), "non-droppable items always delivered");
+    }
+
+    std::cout << "[TEST] Encoder replay keeps the stream decodable" << std::endl;
+    {
+        // SPS, PPS, IDR, then 9 P pictures; repeated twice at 100 fps.
+        const std::string path = "/tmp/stream-replay-" + std::to_string(getpid()) + ".h264";
+        {
+            std::ofstream f(path, std::ios::binary);
+            auto nal = [&](uint8_t header) { f.write("\0\0\0\1", 4).put(char(header)).put('\x88'); };
+            for (int gop = 0; gop < 2; ++gop) {
+                nal(0x67);
+                nal(0x68);
+                nal(0x65);
+                for (int i = 0; i < 9; ++i) nal(0x41);
+            }
+        }
+        int pictures = 0, keyframes = 0;
+        uint64_t lastTs = 0;
+        auto t0 = Clock::now();
+        Encoder::playRecording(path, [&](const EncodedFrame& frame) {
+            int type = frame.data[4] & 0x1F;
+            if (type == 1 || type == 5) {
+                ++pictures;
+                lastTs = frame.timestamp;
+            }
+            keyframes += frame.isKeyFrame ? 1 : 0;
+        }, 100);
+        double secs = secondsSince(t0);
+        expect(pictures == 20 && keyframes == 2, "parameter sets don't count as pictures");
+        expect(lastTs == 190000, "timestamps are media time");
+        expect(secs >= 0.19 && secs < 0.5, "paced at fps");
+
+        // A consumer that stalls mid-GOP: the rest of that GOP is dropped
+        // and replay resumes at the next IDR.
+        stream::ReplayScheduler::Options options;
+        options.late = stream::ReplayScheduler::LatePolicy::Drop;
+        options.lateTolerance = std::chrono::milliseconds(5);
+        int afterStall = 0;
+        bool stalled = false, sawIdrAfterStall = false, pBeforeIdr = false;
+        Encoder::playRecording(path, [&](const EncodedFrame& frame) {
+            int type = frame.data[4] & 0x1F;
+            if (stalled) {
+                if (type == 5) sawIdrAfterStall = true;
+                if (type == 1 && !sawIdrAfterStall) pBeforeIdr = true;
+                ++afterStall;
+            }
+            if (type == 1 && !stalled && frame.timestamp == 30000) {
+                stalled = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(40));
+            }
+        }, 100, options);
+        expect(sawIdrAfterStall && !pBeforeIdr, "resumed at keyframe");
+        std::remove(path.c_str());
+    }
+
+    return report("Replay scheduler test");
+}
@@ -0,0 +1,84 @@
+#include "../include/Resampler.h"
+#include "TestUtil.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+static std::vector<int16_t> sine(int rate, int channels, double freq, double seconds, double amplitude) {
+    size_t frames = size_t(rate * seconds);
+    std::vector<int16_t> out(frames * channels);
+    for (size_t i = 0; i < frames; ++i)
+        for (int c = 0; c < channels; ++c)
+            out[i * channels + c] = int16_t(amplitude * std::sin(2 * M_PI * freq * double(i) / rate));
+    return out;
+}
+
+// Amplitude of `freq` in one channel, by correlation (single DFT bin).
+static double toneLevel(const std::vector<int16_t>& s, int channels, int channel, int rate, double freq,
+                        size_t skipFrames) {
+    double re = 0, im = 0;
+    size_t n = 0;
+    for (size_t i = skipFrames; i < s.size() / channels; ++i, ++n) {
+        double w = 2 * M_PI * freq * double(i) / rate;
+        re += s[i * channels + channel] * std::cos(w);
+        im += s[i * channels + channel] * std::sin(w);
+    }
+    return 2 * std::sqrt(re * re + im * im) / double(n);
+}
+
+int main() {
+    std::cout << "[TEST] Resample 44.1 kHz -> 48 kHz" << std::endl;
+    {
+        auto in = sine(44100, 2, 1000, 1.0, 10000);
+        stream::Resampler rs(44100, 48000, 2);
+        std::vector<int16_t> out;
+        // Odd block sizes exercise the history carried between calls.
+        for (size_t pos = 0; pos < in.size() / 2;) {
+            size_t n = std::min<size_t>(441 + pos % 7, in.size() / 2 - pos);
+            rs.process(in.data() + pos * 2, n, out);
+            pos += n;
+        }
+        size_t frames = out.size() / 2;
+        expect(frames > 47950 && frames <= 48000, "output length follows the ratio");
+        double level = toneLevel(out, 2, 0, 48000, 1000, 1000);
+        expect(std::abs(level - 10000) < 200, "1 kHz tone preserved");
+        expect(toneLevel(out, 2, 1, 48000, 1000, 1000) > 9800, "second channel");
+        expect(toneLevel(out, 2, 0, 48000, 1100, 1000) < 100, "no energy at the wrong frequency");
+    }
+
+    std::cout << "[TEST] Resample 48 kHz -> 16 kHz rejects aliases" << std::endl;
+    {
+        // 20 kHz at 48 kHz must not fold back into the 16 kHz output.
+        auto in = sine(48000, 1, 20000, 0.5, 10000);
+        stream::Resampler rs(48000, 16000, 1);
+        std::vector<int16_t> out;
+        rs.process(in.data(), in.size(), out);
+        expect(out.size() > 7900 && out.size() <= 8000, "downsampled length");
+        expect(toneLevel(out, 1, 0, 16000, 4000, 200) < 100, "alias at 4 kHz suppressed");
+    }
+
+    std::cout << "[TEST] Equal rates pass through" << std::endl;
+    {
+        auto in = sine(48000, 2, 440, 0.01, 5000);
+        stream::Resampler rs(48000, 48000, 2);
+        std::vector<int16_t> out;
+        rs.process(in.data(), in.size() / 2, out);
+        expect(out == in, "identical samples");
+    }
+
+    {
+        auto in = sine(44100, 2, 1000, 10.0, 10000);
+        stream::Resampler rs(44100, 48000, 2);
+        std::vector<int16_t> out;
+        out.reserve(in.size() * 2);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t pos = 0; pos < in.size() / 2; pos += 441)
+            rs.process(in.data() + pos * 2, std::min<size_t>(441, in.size() / 2 - pos), out);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "[TEST] 10 s of stereo 44.1->48 kHz in " << secs * 1000 << " ms ("
+                  << 10.0 / secs << "x real time)" << std::endl;
+    }
+
+    return report("Resampler test");
+}
@@ -0,0 +1,119 @@
+#include "../include/SignalingProtocol.h"
+#include "TestUtil.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// Length-prefixed frames over a socketpair stand in for the WebSocket, so
+// the comparison below counts one syscall and one parse per frame.
+static void writeFrame(int fd, const std::string& payload) {
+    uint32_t len = uint32_t(payload.size());
+    std::string frame(reinterpret_cast<const char*>(&len), 4);
+    frame += payload;
+    (void)!write(fd, frame.data(), frame.size());
+}
+
+static bool readFrame(int fd, std::string& payload) {
+    uint32_t len = 0;
+    if (recv(fd, &len, 4, MSG_WAITALL) != 4) return false;
+    payload.resize(len);
+    return len == 0 || recv(fd, payload.data(), len, MSG_WAITALL) == ssize_t(len);
+}
+
+// Sends one offer plus `count` candidates and returns the time until the
+// receiver has parsed all of them.
+static double measureSetup(bool batched, int count, int& frames) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::atomic<int> received{0};
+    frames = 0;
+    std::thread receiver([&] {
+        std::string text;
+        while (readFrame(fds[1], text)) {
+            stream::SignalingMessage msg;
+            if (stream::parseSignalingMessage(text, msg))
+                received += msg.type == stream::SignalingMessage::Type::Candidates ? int(msg.candidates.size()) : 0;
+            if (received == count) break;
+        }
+    });
+
+    std::string sdp(3000, 'x');
+    std::string candidate = "candidate:842163049 1 udp 1677729535 203.0.113.7 46154 typ srflx raddr 10.0.0.2 rport 46154";
+    auto start = std::chrono::steady_clock::now();
+    if (batched) {
+        stream::SignalingMessage offer;
+        offer.type = stream::SignalingMessage::Type::Offer;
+        offer.session = "bench";
+        offer.sdp = sdp;
+        writeFrame(fds[0], stream::encodeSignalingMessage(offer));
+        ++frames;
+        stream::CandidateBatcher batcher(std::chrono::milliseconds(5), [&](std::vector<stream::IceCandidateInfo>&& list) {
+            stream::SignalingMessage msg;
+            msg.type = stream::SignalingMessage::Type::Candidates;
+            msg.session = "bench";
+            msg.candidates = std::move(list);
+            writeFrame(fds[0], stream::encodeSignalingMessage(msg));
+            ++frames;
+        });
+        for (int i = 0; i < count; ++i) batcher.add({candidate, "0", 0});
+        batcher.flush(); // gathering complete
+    } else {
+        writeFrame(fds[0], "offer:" + sdp);
+        ++frames;
+        for (int i = 0; i < count; ++i) {
+            writeFrame(fds[0], "candidate:" + candidate);
+            ++frames;
+        }
+    }
+    receiver.join();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    close(fds[0]);
+    close(fds[1]);
+    return ms;
+}
+
+int main() {
+    std::cout << "[TEST] Running signaling protocol test..." << std::endl;
+
+    stream::SignalingMessage msg;
+    msg.type = stream::SignalingMessage::Type::Candidates;
+    msg.session = "abc";
+    msg.candidates = {{"candidate:1 1 udp 1 10.0.0.1 1 typ host", "video", 1}, {"candidate:2", "0", 0}};
+    stream::SignalingMessage parsed;
+    expect(stream::parseSignalingMessage(stream::encodeSignalingMessage(msg), parsed), "envelope parses");
+    expect(parsed.type == stream::SignalingMessage::Type::Candidates && parsed.session == "abc", "type and session");
+    expect(parsed.candidates.size() == 2 && parsed.candidates[0].mid == "video" && parsed.candidates[0].mlineIndex == 1, "candidate fields");
+
+    expect(stream::parseSignalingMessage("answer:v=0", parsed) && parsed.type == stream::SignalingMessage::Type::Answer &&
+           parsed.sdp == "v=0" && parsed.version == 0, "legacy answer");
+    expect(stream::parseSignalingMessage("candidate:foo", parsed) && parsed.candidates.size() == 1 &&
+           parsed.candidates[0].candidate == "foo", "legacy candidate");
+    expect(!stream::parseSignalingMessage(R"({"v":99,"type":"offer","sdp":"x"})", parsed), "newer version rejected");
+    expect(!stream::parseSignalingMessage(R"({"v":1,"type":"offer"})", parsed), "offer without sdp rejected");
+    expect(!stream::parseSignalingMessage("{not json", parsed), "garbage rejected");
+
+    // Candidates added within one window come out as a single batch.
+    std::vector<size_t> batches;
+    {
+        stream::CandidateBatcher batcher(std::chrono::milliseconds(20), [&](std::vector<stream::IceCandidateInfo>&& list) {
+            batches.push_back(list.size());
+        });
+        for (int i = 0; i < 5; ++i) batcher.add({"candidate:" + std::to_string(i), "0", 0});
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        batcher.add({"candidate:late", "0", 0});
+    }
+    expect(batches.size() == 2 && batches[0] == 5 && batches[1] == 1, "batched by window and flushed on destroy");
+
+    int legacyFrames = 0, batchedFrames = 0;
+    double legacyMs = measureSetup(false, 40, legacyFrames);
+    double batchedMs = measureSetup(true, 40, batchedFrames);
+    std::cout << "[TEST] Setup with 40 candidates: legacy " << legacyFrames << " frames " << legacyMs
+              << "ms, batched " << batchedFrames << " frames " << batchedMs << "ms" << std::endl;
+    expect(batchedFrames < legacyFrames, "batching reduces frame count");
+
+    return report("Signaling protocol test");
+}
@@ -0,0 +1,84 @@
+#include "../include/Startup.h"
+#include "../include/PipelineStats.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+static const stream::StartupOrchestrator::StepResult* find(const stream::StartupOrchestrator& s, const char* name) {
+    for (const auto& r : s.results())
+        if (r.name == name) return &r;
+    return nullptr;
+}
+
+int main() {
+    std::cout << "[TEST] Independent steps run concurrently" << std::endl;
+    {
+        stream::StartupOrchestrator startup;
+        for (const char* name : {"a", "b", "c", "d"})
+            startup.add(name, [] { std::this_thread::sleep_for(40ms); return true; });
+        auto t0 = std::chrono::steady_clock::now();
+        expect(startup.run(), "all steps succeed");
+        auto took = std::chrono::steady_clock::now() - t0;
+        expect(took < 100ms, "4 x 40 ms steps overlap");
+        expect(startup.results().size() == 4 && find(startup, "c")->elapsed >= 40ms, "timings recorded");
+    }
+
+    std::cout << "[TEST] Dependencies are ordered" << std::endl;
+    {
+        stream::StartupOrchestrator startup;
+        std::atomic<bool> encoderReady{false};
+        bool captureSawEncoder = false;
+        startup.add("encoder", [&] {
+            std::this_thread::sleep_for(20ms);
+            encoderReady = true;
+            return true;
+        });
+        startup.add("capture", [&] { captureSawEncoder = encoderReady; return true; }, {"encoder"});
+        expect(startup.run() && captureSawEncoder, "dependent waited");
+        expect(find(startup, "capture")->startedAt >= find(startup, "encoder")->elapsed, "started after dependency");
+
+        // A later phase may depend on an earlier one.
+        bool ran = false;
+        startup.add("late", [&] { ran = true; return true; }, {"capture"});
+        expect(startup.run() && ran && startup.results().size() == 3, "second phase runs only new steps");
+    }
+
+    std::cout << "[TEST] Failures" << std::endl;
+    {
+        stream::StartupOrchestrator startup;
+        bool dependentRan = false;
+        startup.add("broken", [] { return false; });
+        startup.add("dependent", [&] { dependentRan = true; return true; }, {"broken"});
+        startup.add("optional", [] { return false; }, {}, false);
+        expect(!startup.run(), "required failure fails the run");
+        expect(!dependentRan && find(startup, "dependent")->skipped, "dependents skipped");
+
+        stream::StartupOrchestrator optionalOnly;
+        optionalOnly.add("audio", [] { return false; }, {}, false);
+        optionalOnly.add("orphan", [] { return true; }, {"missing"}, false);
+        expect(optionalOnly.run(), "optional failures tolerated");
+        expect(find(optionalOnly, "orphan")->skipped, "unknown dependency skips");
+    }
+
+    std::cout << "[TEST] Time to first frame" << std::endl;
+    {
+        stream::StartupOrchestrator startup;
+        expect(startup.timeToFirstFrame().count() == 0, "unset before the first frame");
+        std::this_thread::sleep_for(10ms);
+        std::atomic<int> firsts{0};
+        std::thread encoders[4];
+        for (auto& t : encoders)
+            t = std::thread([&] { for (int i = 0; i < 100; ++i) firsts += startup.markFirstFrame() ? 1 : 0; });
+        for (auto& t : encoders) t.join();
+        expect(firsts == 1, "recorded once");
+        expect(startup.timeToFirstFrame() >= 10ms, "measured from construction");
+        expect(stream::pipelineCounters().timeToFirstFrameMicros.load() ==
+               uint64_t(startup.timeToFirstFrame().count()), "published to pipeline counters");
+    }
+
+    return report("Startup test");
+}
@@ -0,0 +1,102 @@
+#include "../include/ThreadTopology.h"
+#include "TestUtil.h"
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+static bool listed(const std::string& name, stream::ThreadUsage* out = nullptr) {
+    for (const auto& t : stream::threadTopology().usage()) {
+        if (t.name != name) continue;
+        if (out) *out = t;
+        return true;
+    }
+    return false;
+}
+
+static void spin(std::chrono::milliseconds d) {
+    auto end = std::chrono::steady_clock::now() + d;
+    volatile uint64_t x = 0;
+    while (std::chrono::steady_clock::now() < end) x = x + 1;
+}
+
+int main() {
+    auto& topology = stream::threadTopology();
+
+    std::cout << "[TEST] Names and CPU time" << std::endl;
+    {
+        stream::ThreadUsage before{}, after{};
+        {
+            stream::ThreadScope scope(stream::ThreadRole::Capture, "capture-test-thread");
+            char name[16] = {};
+            pthread_getname_np(pthread_self(), name, sizeof(name));
+            expect(strcmp(name, "capture-test-th") == 0, "name cut to 15 characters");
+            expect(listed("capture-test-thread", &before) && before.role == stream::ThreadRole::Capture,
+                   "thread registered");
+            spin(std::chrono::milliseconds(50));
+            listed("capture-test-thread", &after);
+            expect(after.cpuMicros >= before.cpuMicros + 20000, "CPU time accumulates");
+        }
+        expect(!listed("capture-test-thread"), "scope unregisters");
+
+        std::thread([] { stream::threadTopology().enter(stream::ThreadRole::Control, "no-leave"); })
+            .join();
+        expect(!listed("no-leave"), "exited thread dropped");
+    }
+
+    std::cout << "[TEST] Affinity follows the policy" << std::endl;
+    {
+        cpu_set_t original;
+        sched_getaffinity(0, sizeof(original), &original);
+        int first = 0;
+        while (first < CPU_SETSIZE && !CPU_ISSET(first, &original)) ++first;
+
+        std::atomic<int> phase{0};
+        std::atomic<bool> pinned{false}, restored{false};
+        std::thread worker([&] {
+            stream::ThreadScope scope(stream::ThreadRole::Network, "net-test");
+            phase = 1;
+            while (phase != 2) std::this_thread::yield();
+            cpu_set_t now;
+            sched_getaffinity(0, sizeof(now), &now);
+            pinned = CPU_COUNT(&now) == 1 && CPU_ISSET(first, &now);
+            phase = 3;
+            while (phase != 4) std::this_thread::yield();
+            sched_getaffinity(0, sizeof(now), &now);
+            restored = CPU_EQUAL(&now, &original);
+        });
+        while (phase != 1) std::this_thread::yield();
+        stream::ThreadPolicy policy;
+        policy.cpus = {first};
+        topology.setPolicy(stream::ThreadRole::Network, policy); // applied to the running thread
+        phase = 2;
+        while (phase != 3) std::this_thread::yield();
+        topology.setPolicy(stream::ThreadRole::Network, {});
+        phase = 4;
+        worker.join();
+        expect(pinned, "running thread pinned");
+        expect(restored, "unpinned when the CPU list is removed");
+        expect(topology.numaNode(stream::ThreadRole::Network) == -1, "no node without pinning");
+    }
+
+    std::cout << "[TEST] Realtime where permitted" << std::endl;
+    {
+        stream::ThreadPolicy policy;
+        policy.scheduler = "fifo";
+        policy.priority = 5;
+        topology.setPolicy(stream::ThreadRole::Audio, policy);
+        int scheduler = -1;
+        std::thread([&] {
+            stream::ThreadScope scope(stream::ThreadRole::Audio, "audio-test");
+            scheduler = sched_getscheduler(0);
+        }).join();
+        // Without CAP_SYS_NICE the thread falls back and keeps running.
+        expect(scheduler == SCHED_FIFO || scheduler == SCHED_OTHER, "FIFO or fallback");
+        topology.setPolicy(stream::ThreadRole::Audio, {});
+    }
+
+    return report("ThreadTopology test");
+}
@@ -0,0 +1,79 @@
+#include "../include/UInputInjector.h"
+#include "TestUtil.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+static std::vector<input_event> drain(int fd) {
+    std::vector<input_event> events(64);
+    ssize_t n = read(fd, events.data(), events.size() * sizeof(input_event));
+    events.resize(n > 0 ? n / sizeof(input_event) : 0);
+    return events;
+}
+
+int main() {
+    std::cout << "[TEST] Running uinput injector test..." << std::endl;
+
+    // Pipes stand in for the uinput device fds.
+    int pointer[2], keyboard[2];
+    if (pipe2(pointer, O_NONBLOCK) != 0 || pipe2(keyboard, O_NONBLOCK) != 0) {
+        std::cout << "[TEST] pipe() failed" << std::endl;
+        return 1;
+    }
+    {
+        stream::UInputInjector injector(pointer[1], keyboard[1]);
+
+        stream::InputEvent batch[4] = {};
+        batch[0].type = stream::InputEvent::Type::MouseMove;
+        batch[0].x = 1;
+        batch[0].y = 2;
+        batch[1].type = stream::InputEvent::Type::MouseMove;
+        batch[1].x = 640;
+        batch[1].y = 360;
+        batch[2].type = stream::InputEvent::Type::MouseButton;
+        batch[2].x = 640;
+        batch[2].y = 360;
+        batch[2].code = 1;
+        batch[2].down = true;
+        batch[3].type = stream::InputEvent::Type::Key;
+        batch[3].code = 38; // X keycode for 'a'
+        batch[3].down = true;
+        injector.injectBatch(batch);
+
+        auto events = drain(pointer[0]);
+        // Two moves coalesce into one ABS_X/ABS_Y/SYN frame, then BTN_LEFT/SYN.
+        expect(events.size() == 5, "pointer events written in one batch");
+        if (events.size() == 5) {
+            expect(events[0].type == EV_ABS && events[0].code == ABS_X && events[0].value == 640, "abs x");
+            expect(events[1].type == EV_ABS && events[1].code == ABS_Y && events[1].value == 360, "abs y");
+            expect(events[2].type == EV_SYN, "move synced");
+            expect(events[3].type == EV_KEY && events[3].code == BTN_LEFT && events[3].value == 1, "left button");
+            expect(events[4].type == EV_SYN, "button synced");
+        }
+
+        events = drain(keyboard[0]);
+        expect(events.size() == 2, "keyboard events");
+        if (events.size() == 2)
+            expect(events[0].type == EV_KEY && events[0].code == KEY_A && events[0].value == 1, "X keycode mapped to evdev");
+
+        injector.injectMouse(10, 20, 0, false);
+        events = drain(pointer[0]);
+        expect(events.size() == 3, "plain move has no button event");
+
+        // A click elsewhere moves there first.
+        injector.injectMouse(100, 200, 3, true);
+        events = drain(pointer[0]);
+        expect(events.size() == 5, "click moves then presses");
+        if (events.size() == 5) {
+            expect(events[0].code == ABS_X && events[0].value == 100 && events[1].code == ABS_Y &&
+                       events[1].value == 200,
+                   "click position");
+            expect(events[3].type == EV_KEY && events[3].code == BTN_RIGHT, "right button after the move");
+        }
+    }
+    close(pointer[0]);
+    close(keyboard[0]);
+
+    return report("uinput injector test");
+}